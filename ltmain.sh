@@ -1 +1 @@
-/usr/share/libtool/config/ltmain.sh
\ No newline at end of file
+/usr/share/libtool/build-aux/ltmain.sh
\ No newline at end of file
@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <gtksourceview/gtksourcebuffer.h>
+#include "comments-applier.h"
+
+/*
+ * Applies an edit a slice at a time from idle callbacks, so a change to
+ * tens of thousands of lines does not hold up redraws and input for the
+ * whole of it. Each slice does as many pieces of the edit as fit in the
+ * budget. The whole edit is one user action, so it is undone in one step,
+ * and the view is made read only until it is done so typing cannot land in
+ * the middle of it. Undo and redo on a source buffer are stopped until
+ * then too. Where the next slice starts is kept in a mark.
+ *
+ * That is as far as the buffer is guarded. Another view on the same
+ * buffer stays editable, code that inserts into the buffer directly is
+ * not stopped, and saving the document part way through writes the half
+ * applied text. Anything that changes the lines ahead of the mark can
+ * make the rest of a line edit land on the wrong lines.
+ */
+struct _CommentsApplier
+{
+  GtkTextView             *text_view;
+  GtkTextBuffer           *buffer;
+  GtkTextMark             *mark;
+  gboolean                 editable;
+  gint64                   budget;
+  guint                    idle_id;
+  gulong                   undo_id;
+  gulong                   redo_id;
+  CommentsApplierFunc      func;
+  CommentsApplierDoneFunc  done;
+  gpointer                 user_data;
+};
+
+static gboolean run_slice     (CommentsApplier *applier,
+                               gint64           budget);
+static gboolean run_idle      (CommentsApplier *applier);
+static void     complete      (CommentsApplier *applier,
+                               GtkTextIter     *iter);
+static void     stop_undo     (GtkSourceBuffer *buffer);
+static void     stop_redo     (GtkSourceBuffer *buffer);
+
+CommentsApplier*
+comments_applier_new (GtkTextView             *text_view,
+                      const GtkTextIter       *iter,
+                      CommentsApplierFunc      func,
+                      CommentsApplierDoneFunc  done,
+                      gpointer                 user_data)
+{
+  CommentsApplier *applier;
+
+  applier = g_new0 (CommentsApplier, 1);
+  applier->text_view = g_object_ref (text_view);
+  applier->buffer = g_object_ref (gtk_text_view_get_buffer (text_view));
+  applier->mark = gtk_text_buffer_create_mark (applier->buffer, NULL, iter, TRUE);
+  applier->func = func;
+  applier->done = done;
+  applier->user_data = user_data;
+
+  return applier;
+}
+
+/*
+ * Start the edit and run the first slice straight away, so an edit that
+ * fits in the budget is applied before this returns. A negative budget
+ * applies the edit in one go. Returns TRUE when the edit is complete, in
+ * which case the done function has been called and the applier is gone;
+ * otherwise the rest follows from idle callbacks.
+ */
+gboolean
+comments_applier_run (CommentsApplier *applier,
+                      gint64           budget)
+{
+  applier->budget = budget;
+  applier->editable = gtk_text_view_get_editable (applier->text_view);
+
+  gtk_text_view_set_editable (applier->text_view, FALSE);
+  gtk_text_buffer_begin_user_action (applier->buffer);
+
+  if (GTK_SOURCE_IS_BUFFER (applier->buffer))
+    {
+      applier->undo_id = g_signal_connect (applier->buffer, "undo", 
+                                           G_CALLBACK (stop_undo), NULL);
+      applier->redo_id = g_signal_connect (applier->buffer, "redo", 
+                                           G_CALLBACK (stop_redo), NULL);
+    }
+
+  if (!run_slice (applier, budget))
+    return TRUE;
+
+  applier->idle_id = g_idle_add ((GSourceFunc) run_idle, applier);
+
+  return FALSE;
+}
+
+/*
+ * Apply whatever is left of the edit now, for when the edit cannot be
+ * left to the main loop.
+ */
+void
+comments_applier_finish (CommentsApplier *applier)
+{
+  g_source_remove (applier->idle_id);
+  applier->idle_id = 0;
+  run_slice (applier, -1);
+}
+
+static gboolean
+run_idle (CommentsApplier *applier)
+{
+  return run_slice (applier, applier->budget);
+}
+
+/*
+ * The clock is read after every piece, which costs next to nothing next
+ * to an edit of the buffer.
+ */
+static gboolean
+run_slice (CommentsApplier *applier,
+           gint64           budget)
+{
+  GtkTextIter iter;
+  gint64 deadline;
+  gboolean more;
+
+  deadline = g_get_monotonic_time () + budget;
+
+  gtk_text_buffer_get_iter_at_mark (applier->buffer, &iter, applier->mark);
+
+  do
+    more = applier->func (applier->buffer, &iter, applier->user_data);
+  while (more && (budget < 0 || g_get_monotonic_time () < deadline));
+
+  if (!more)
+    {
+      complete (applier, &iter);
+      return FALSE;
+    }
+
+  gtk_text_buffer_move_mark (applier->buffer, applier->mark, &iter);
+
+  return TRUE;
+}
+
+static void
+complete (CommentsApplier *applier,
+          GtkTextIter     *iter)
+{
+  gtk_text_buffer_move_mark (applier->buffer, applier->mark, iter);
+
+  if (applier->undo_id != 0)
+    {
+      g_signal_handler_disconnect (applier->buffer, applier->undo_id);
+      g_signal_handler_disconnect (applier->buffer, applier->redo_id);
+    }
+
+  gtk_text_buffer_end_user_action (applier->buffer);
+  gtk_text_view_set_editable (applier->text_view, applier->editable);
+
+  gtk_text_buffer_get_iter_at_mark (applier->buffer, iter, applier->mark);
+  gtk_text_buffer_delete_mark (applier->buffer, applier->mark);
+
+  applier->done (applier->buffer, iter, applier->user_data);
+
+  g_object_unref (applier->buffer);
+  g_object_unref (applier->text_view);
+  g_free (applier);
+}
+
+static void
+stop_undo (GtkSourceBuffer *buffer)
+{
+  g_signal_stop_emission_by_name (buffer, "undo");
+}
+
+static void
+stop_redo (GtkSourceBuffer *buffer)
+{
+  g_signal_stop_emission_by_name (buffer, "redo");
+}
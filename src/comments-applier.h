@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __COMMENTS_APPLIER_H__
+#define	__COMMENTS_APPLIER_H__
+
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+/* how long one slice of an edit may hold the main loop, in microseconds */
+#define COMMENTS_APPLIER_BUDGET (8 * 1000)
+
+typedef struct _CommentsApplier CommentsApplier;
+
+/*
+ * Apply the next piece of the edit at iter and leave iter where the piece
+ * after it goes. Returns FALSE once there is nothing left to do.
+ */
+typedef gboolean (*CommentsApplierFunc)     (GtkTextBuffer     *buffer,
+                                             GtkTextIter       *iter,
+                                             gpointer           user_data);
+
+typedef void     (*CommentsApplierDoneFunc) (GtkTextBuffer     *buffer,
+                                             const GtkTextIter *iter,
+                                             gpointer           user_data);
+
+CommentsApplier*  comments_applier_new     (GtkTextView             *text_view,
+                                            const GtkTextIter       *iter,
+                                            CommentsApplierFunc      func,
+                                            CommentsApplierDoneFunc  done,
+                                            gpointer                 user_data);
+gboolean          comments_applier_run     (CommentsApplier         *applier,
+                                            gint64                   budget);
+void              comments_applier_finish  (CommentsApplier         *applier);
+
+G_END_DECLS
+
+#endif /* __COMMENTS_APPLIER_H__ */
@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "comments-arena.h"
+
+/*
+ * Scratch strings that are handed out for the length of one action and
+ * then taken back whole, so an action that is repeated writes its results
+ * into space the last one already grew instead of going to the heap. What
+ * is kept between actions is capped at the limit, and strings that do
+ * not fit under it are let go.
+ */
+struct _CommentsArena
+{
+  GPtrArray *strings;
+  guint      used;
+  gsize      limit;
+};
+
+CommentsArena*
+comments_arena_new (gsize limit)
+{
+  CommentsArena *arena;
+
+  arena = g_new0 (CommentsArena, 1);
+  arena->strings = g_ptr_array_new ();
+  arena->limit = limit;
+
+  return arena;
+}
+
+/*
+ * Returns an empty string that stays the caller's until the next reset.
+ */
+GString*
+comments_arena_take (CommentsArena *arena)
+{
+  GString *string;
+
+  if (arena->used < arena->strings->len)
+    {
+      string = g_ptr_array_index (arena->strings, arena->used);
+      g_string_truncate (string, 0);
+    }
+  else
+    {
+      string = g_string_new (NULL);
+      g_ptr_array_add (arena->strings, string);
+    }
+
+  arena->used++;
+
+  return string;
+}
+
+/*
+ * Where the strings handed out from now on start, for a release.
+ */
+guint
+comments_arena_mark (CommentsArena *arena)
+{
+  return arena->used;
+}
+
+/*
+ * Take back the strings handed out since the mark was made, so a step
+ * that is repeated within one action reuses them rather than taking more.
+ */
+void
+comments_arena_release (CommentsArena *arena,
+                        guint          mark)
+{
+  if (mark < arena->used)
+    arena->used = mark;
+}
+
+/*
+ * Take back every string handed out since the last reset.
+ */
+void
+comments_arena_reset (CommentsArena *arena)
+{
+  gsize retained = 0;
+  guint i = 0;
+
+  arena->used = 0;
+
+  while (i < arena->strings->len)
+    {
+      GString *string = g_ptr_array_index (arena->strings, i);
+
+      if (retained + string->allocated_len > arena->limit)
+        {
+          g_string_free (string, TRUE);
+          g_ptr_array_remove_index_fast (arena->strings, i);
+          continue;
+        }
+
+      retained += string->allocated_len;
+      i++;
+    }
+}
+
+void
+comments_arena_free (CommentsArena *arena)
+{
+  guint i;
+
+  for (i = 0; i < arena->strings->len; i++)
+    g_string_free (g_ptr_array_index (arena->strings, i), TRUE);
+
+  g_ptr_array_free (arena->strings, TRUE);
+  g_free (arena);
+}
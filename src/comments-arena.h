@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __COMMENTS_ARENA_H__
+#define	__COMMENTS_ARENA_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * How much scratch space is kept between actions, in bytes: enough for
+ * the two pass strings and the chunk strings of a selection of a few
+ * megabytes, which is where the allocations cost the most.
+ */
+#define COMMENTS_ARENA_LIMIT (32 * 1024 * 1024)
+
+typedef struct _CommentsArena CommentsArena;
+
+CommentsArena*  comments_arena_new      (gsize          limit);
+GString*        comments_arena_take     (CommentsArena *arena);
+guint           comments_arena_mark     (CommentsArena *arena);
+void            comments_arena_release  (CommentsArena *arena,
+                                         guint          mark);
+void            comments_arena_reset    (CommentsArena *arena);
+void            comments_arena_free     (CommentsArena *arena);
+
+G_END_DECLS
+
+#endif /* __COMMENTS_ARENA_H__ */
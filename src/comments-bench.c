@@ -0,0 +1,808 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Times the comment and uncomment actions end to end on a real
+ * GtkSourceBuffer, from the menu signal to the buffer being updated, with
+ * comments-host.c standing in for the editor.
+ *
+ *   xvfb-run comments-bench [--lines 100000] [--iterations 10] [--type .c]
+ *                           [--bulk-threshold CHARS] [--budget USEC]
+ *                           [--eol lf|crlf|cr|mixed]
+ *                           [--simd-level scalar|sse2|avx2]
+ *
+ * Each run prints one "action<TAB>lines<TAB>microseconds<TAB>allocations"
+ * row to stdout and a min/median/max summary of the times and allocations
+ * to stderr, along with the number of processors the line transforms were
+ * spread over and the instruction set the searches ran on. --simd-level
+ * holds the searches down to a lower one than the CPU has, to compare
+ * them. Allocations are every call made while the action ran, GTK's
+ * included, to malloc, calloc, realloc, reallocarray, posix_memalign,
+ * aligned_alloc, memalign, valloc and pvalloc. g_slice carves most of its
+ * blocks out of pages it got with posix_memalign, so a g_slice_new is only
+ * counted when it needs a fresh page. They are only counted on glibc.
+ *
+ *   xvfb-run comments-bench --replay TRACE [--iterations 1]
+ *
+ * Runs the actions of a trace recorded with COMMENTS_RECORD set instead.
+ * Every action gets a fresh document of the recorded file type holding
+ * generated text of the recorded length and line count, seeded from the
+ * recorded hash so each replay sees the same text, and the latency of each
+ * kind of action is summed up as percentiles next to the recorded median.
+ * Lines and ranges actions are replayed as document actions over the same
+ * number of lines, as the range dialog cannot be answered; matching
+ * actions need a pattern and are skipped.
+ */
+
+#include <stdlib.h>
+#include <glib/gstdio.h>
+#include <gtk/gtk.h>
+#include <gtksourceview/gtksourcebuffer.h>
+#include <gtksourceview/gtksourcelanguagemanager.h>
+#include "comments-host.h"
+#include "comments-config.h"
+#include "comments-engine.h"
+#include "comments-menu.h"
+#include "comments-recorder.h"
+#include "comments-simd.h"
+
+static void         run_bench              (CodeSlayer     *codeslayer,
+                                            GtkWidget      *menu);
+static GList*       create_configs         (void);
+static GList*       create_replay_configs  (GPtrArray      *records);
+static gchar*       create_text            (gint            lines);
+static gchar*       create_replay_text     (CommentsRecord *record);
+static const gchar* get_replay_suffix      (CommentsRecord *record);
+static gchar*       get_replay_path        (CommentsRecord *record);
+static void         replay_trace           (CodeSlayer     *codeslayer,
+                                            GtkWidget      *menu,
+                                            GPtrArray      *records);
+static gint64       run_action             (GtkWidget      *menu,
+                                            const gchar    *action,
+                                            guint           count,
+                                            gint64         *allocated);
+static void         print_summary          (const gchar    *action,
+                                            GArray         *times);
+static void         print_allocations      (const gchar    *action,
+                                            GArray         *counts);
+static void         print_percentiles      (const gchar    *action,
+                                            GArray         *times,
+                                            GArray         *recorded);
+static gint         compare_times          (gconstpointer   a,
+                                            gconstpointer   b);
+static gboolean     set_simd_level         (const gchar    *name);
+
+static gint lines = 100000;
+static gint iterations = 10;
+static gchar *type = NULL;
+static gint bulk_threshold = G_MININT;
+static gint budget = G_MININT;
+static gchar *replay = NULL;
+static gchar *eol = NULL;
+static gchar *simd_level = NULL;
+
+static const gchar *simd_level_names[] = { "scalar", "sse2", "avx2" };
+
+/*
+ * glibc's allocator is also exported under __libc_ names, so the bench can
+ * put its own entry points in front of it, for everything in the process,
+ * and count the calls.
+ */
+static volatile gint allocations = 0;
+
+#ifdef __GLIBC__
+#include <errno.h>
+#include <malloc.h>
+
+extern void *__libc_malloc   (size_t size);
+extern void *__libc_calloc   (size_t n_members, 
+                              size_t size);
+extern void *__libc_realloc  (void  *mem, 
+                              size_t size);
+extern void *__libc_memalign (size_t alignment, 
+                              size_t size);
+extern void *__libc_valloc   (size_t size);
+extern void *__libc_pvalloc  (size_t size);
+
+void*
+malloc (size_t size)
+{
+  g_atomic_int_inc (&allocations);
+  return __libc_malloc (size);
+}
+
+void*
+calloc (size_t n_members, 
+        size_t size)
+{
+  g_atomic_int_inc (&allocations);
+  return __libc_calloc (n_members, size);
+}
+
+void*
+realloc (void  *mem, 
+         size_t size)
+{
+  g_atomic_int_inc (&allocations);
+  return __libc_realloc (mem, size);
+}
+
+void*
+reallocarray (void  *mem, 
+              size_t n_members, 
+              size_t size)
+{
+  if (size != 0 && n_members > G_MAXSIZE / size)
+    {
+      errno = ENOMEM;
+      return NULL;
+    }
+
+  return realloc (mem, n_members * size);
+}
+
+int
+posix_memalign (void  **mem, 
+                size_t  alignment, 
+                size_t  size)
+{
+  void *result;
+
+  if (alignment % sizeof (void *) != 0 || (alignment & (alignment - 1)) != 0)
+    return EINVAL;
+
+  g_atomic_int_inc (&allocations);
+  result = __libc_memalign (alignment, size);
+  if (result == NULL)
+    return ENOMEM;
+
+  *mem = result;
+  return 0;
+}
+
+void*
+aligned_alloc (size_t alignment, 
+               size_t size)
+{
+  g_atomic_int_inc (&allocations);
+  return __libc_memalign (alignment, size);
+}
+
+void*
+memalign (size_t alignment, 
+          size_t size)
+{
+  g_atomic_int_inc (&allocations);
+  return __libc_memalign (alignment, size);
+}
+
+void*
+valloc (size_t size)
+{
+  g_atomic_int_inc (&allocations);
+  return __libc_valloc (size);
+}
+
+void*
+pvalloc (size_t size)
+{
+  g_atomic_int_inc (&allocations);
+  return __libc_pvalloc (size);
+}
+#endif
+
+static GOptionEntry entries[] = 
+{
+  { "lines", 'l', 0, G_OPTION_ARG_INT, &lines, "number of lines in the buffer", "N" },
+  { "iterations", 'i', 0, G_OPTION_ARG_INT, &iterations, "number of comment and uncomment pairs, or of passes over the trace", "N" },
+  { "type", 't', 0, G_OPTION_ARG_STRING, &type, "file suffix of the document, .c by default", "SUFFIX" },
+  { "bulk-threshold", 'b', 0, G_OPTION_ARG_INT, &bulk_threshold, "edit size that switches highlighting off, -1 never", "CHARS" },
+  { "budget", 'u', 0, G_OPTION_ARG_INT, &budget, "time slice for applying large edits, -1 in one go", "USEC" },
+  { "eol", 'e', 0, G_OPTION_ARG_STRING, &eol, "line breaks of the buffer, lf by default or crlf, cr or mixed", "STYLE" },
+  { "simd-level", 's', 0, G_OPTION_ARG_STRING, &simd_level, "highest instruction set for the searches, scalar, sse2 or avx2", "LEVEL" },
+  { "replay", 'r', 0, G_OPTION_ARG_FILENAME, &replay, "run the actions of a recorded trace", "TRACE" },
+  { NULL }
+};
+
+int
+main (int    argc,
+      char **argv)
+{
+  GError *error = NULL;
+  gchar *config_folder;
+  gchar *config_path;
+  GList *configs;
+  CodeSlayer *codeslayer;
+  GtkAccelGroup *accel_group;
+  GtkWidget *menu;
+  CommentsEngine *engine;
+  GPtrArray *records = NULL;
+
+  if (!gtk_init_with_args (&argc, &argv, "- time the comment actions", 
+                           entries, NULL, &error))
+    {
+      g_printerr ("comments-bench: %s\n", error != NULL ? error->message : 
+                  "cannot open the display, try running under xvfb-run");
+      return EXIT_FAILURE;
+    }
+
+  if (simd_level != NULL && !set_simd_level (simd_level))
+    {
+      g_printerr ("comments-bench: unknown simd level %s\n", simd_level);
+      return EXIT_FAILURE;
+    }
+
+  config_folder = g_dir_make_tmp ("comments-bench-XXXXXX", &error);
+  if (config_folder == NULL)
+    {
+      g_printerr ("comments-bench: %s\n", error->message);
+      g_error_free (error);
+      return EXIT_FAILURE;
+    }
+
+  if (replay != NULL)
+    {
+      records = comments_recorder_load (replay, &error);
+      if (records == NULL)
+        {
+          g_printerr ("comments-bench: %s\n", error->message);
+          g_error_free (error);
+          g_rmdir (config_folder);
+          return EXIT_FAILURE;
+        }
+    }
+
+  config_path = g_build_filename (config_folder, "comments.xml", NULL);
+  configs = records != NULL ? create_replay_configs (records) : create_configs ();
+  comments_config_save_list (configs, config_path);
+  g_list_foreach (configs, (GFunc) g_object_unref, NULL);
+  g_list_free (configs);
+
+  codeslayer = comments_host_new (config_folder);
+  accel_group = gtk_accel_group_new ();
+  menu = comments_menu_new (accel_group);
+  g_object_ref_sink (menu);
+
+  engine = comments_engine_new (codeslayer, menu);
+  comments_engine_load_configs (engine);
+  comments_engine_set_repeat_interval (engine, 0);
+  if (bulk_threshold != G_MININT)
+    comments_engine_set_bulk_threshold (engine, bulk_threshold);
+  if (budget != G_MININT)
+    comments_engine_set_apply_budget (engine, budget);
+
+  if (records != NULL)
+    {
+      replay_trace (codeslayer, menu, records);
+      g_ptr_array_free (records, TRUE);
+    }
+  else
+    {
+      run_bench (codeslayer, menu);
+    }
+
+  g_object_unref (engine);
+  g_object_unref (menu);
+  g_object_unref (codeslayer);
+  g_object_unref (accel_group);
+
+  g_unlink (config_path);
+  g_rmdir (config_folder);
+  g_free (config_path);
+  g_free (config_folder);
+  g_free (type);
+  g_free (replay);
+  g_free (eol);
+  g_free (simd_level);
+
+  return EXIT_SUCCESS;
+}
+
+static void
+run_bench (CodeSlayer *codeslayer,
+           GtkWidget  *menu)
+{
+  GtkSourceLanguageManager *manager;
+  GtkSourceBuffer *buffer;
+  GtkTextIter start, end;
+  GArray *comment_times;
+  GArray *uncomment_times;
+  GArray *comment_allocations;
+  GArray *uncomment_allocations;
+  gchar *file_path;
+  gchar *text;
+  gint i;
+
+  file_path = g_strconcat ("/tmp/bench", type != NULL ? type : ".c", NULL);
+
+  manager = gtk_source_language_manager_get_default ();
+  buffer = gtk_source_buffer_new (NULL);
+  gtk_source_buffer_set_language (buffer, 
+                                  gtk_source_language_manager_guess_language (manager, file_path, NULL));
+
+  text = create_text (lines);
+  gtk_text_buffer_set_text (GTK_TEXT_BUFFER (buffer), text, -1);
+  g_free (text);
+
+  comments_host_open_document (codeslayer, file_path, NULL, buffer);
+
+  gtk_text_buffer_get_bounds (GTK_TEXT_BUFFER (buffer), &start, &end);
+  gtk_text_buffer_select_range (GTK_TEXT_BUFFER (buffer), &start, &end);
+
+  comment_times = g_array_new (FALSE, FALSE, sizeof (gint64));
+  uncomment_times = g_array_new (FALSE, FALSE, sizeof (gint64));
+  comment_allocations = g_array_new (FALSE, FALSE, sizeof (gint64));
+  uncomment_allocations = g_array_new (FALSE, FALSE, sizeof (gint64));
+
+  for (i = 0; i < iterations; i++)
+    {
+      gint64 allocated;
+      gint64 time;
+
+      time = run_action (menu, "comment", 1, &allocated);
+      g_array_append_val (comment_times, time);
+      g_array_append_val (comment_allocations, allocated);
+      g_print ("comment\t%d\t%" G_GINT64_FORMAT "\t%" G_GINT64_FORMAT "\n", 
+               lines, time, allocated);
+
+      time = run_action (menu, "uncomment", 1, &allocated);
+      g_array_append_val (uncomment_times, time);
+      g_array_append_val (uncomment_allocations, allocated);
+      g_print ("uncomment\t%d\t%" G_GINT64_FORMAT "\t%" G_GINT64_FORMAT "\n", 
+               lines, time, allocated);
+    }
+
+  g_printerr ("%u processors, %s searches\n", g_get_num_processors (), 
+              simd_level_names[comments_simd_get_level ()]);
+  print_summary ("comment", comment_times);
+  print_summary ("uncomment", uncomment_times);
+  print_allocations ("comment", comment_allocations);
+  print_allocations ("uncomment", uncomment_allocations);
+
+  g_array_free (comment_times, TRUE);
+  g_array_free (uncomment_times, TRUE);
+  g_array_free (comment_allocations, TRUE);
+  g_array_free (uncomment_allocations, TRUE);
+  g_object_unref (buffer);
+  g_free (file_path);
+}
+
+static GList*
+create_configs (void)
+{
+  static const gchar *defaults[][5] = 
+  {
+    { ".c,.h,.cpp,.java,.js", "//", "", "/*", "*/" },
+    { ".sql", "--", "", "/*", "*/" },
+    { ".py,.sh,.rb,.pl", "#", "", "", "" },
+    { ".css", "/*", "*/", "", "" },
+    { ".xml,.html", "<!--", "-->", "", "" }
+  };
+  GList *configs = NULL;
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (defaults); i++)
+    {
+      CommentsConfig *config;
+      config = comments_config_new ();
+      comments_config_set_file_types (config, defaults[i][0]);
+      comments_config_set_start (config, defaults[i][1]);
+      comments_config_set_end (config, defaults[i][2]);
+      comments_config_set_alternate_start (config, defaults[i][3]);
+      comments_config_set_alternate_end (config, defaults[i][4]);
+      configs = g_list_append (configs, config);
+    }
+
+  return configs;
+}
+
+/*
+ * One config per file type in the trace, as it was when the type was first
+ * recorded.
+ */
+static GList*
+create_replay_configs (GPtrArray *records)
+{
+  GHashTable *suffixes;
+  GList *configs = NULL;
+  guint i;
+
+  suffixes = g_hash_table_new (g_str_hash, g_str_equal);
+
+  for (i = 0; i < records->len; i++)
+    {
+      CommentsRecord *record = g_ptr_array_index (records, i);
+      CommentsConfig *config;
+
+      if (g_hash_table_contains (suffixes, record->suffix))
+        continue;
+      g_hash_table_add (suffixes, record->suffix);
+
+      config = comments_config_new ();
+      comments_config_set_file_types (config, get_replay_suffix (record));
+      comments_config_set_start (config, record->start);
+      comments_config_set_end (config, record->end);
+      comments_config_set_indent (config, record->indent);
+      comments_config_set_padding (config, record->padding);
+      configs = g_list_append (configs, config);
+    }
+
+  g_hash_table_destroy (suffixes);
+
+  return configs;
+}
+
+/*
+ * Mixed line breaks take turns at \n, \r\n and \r.
+ */
+static gchar*
+create_text (gint lines)
+{
+  static const gchar *mixed[] = { "\n", "\r\n", "\r" };
+  const gchar *line_break = "\n";
+  GString *string;
+  gint i;
+
+  if (g_strcmp0 (eol, "crlf") == 0)
+    line_break = "\r\n";
+  else if (g_strcmp0 (eol, "cr") == 0)
+    line_break = "\r";
+
+  string = g_string_new (NULL);
+
+  for (i = 0; i < lines; i++)
+    {
+      if (g_strcmp0 (eol, "mixed") == 0)
+        line_break = mixed[i % G_N_ELEMENTS (mixed)];
+      g_string_append_printf (string, "%*svalue = compute (value, %d);%s", 
+                              (i % 4) * 2, "", i, line_break);
+    }
+
+  return g_string_free (string, FALSE);
+}
+
+/*
+ * Text of about the recorded length spread over the recorded number of
+ * lines. What an uncomment works on is commented to begin with, and every
+ * other line carries a comment for strip comments to take out.
+ */
+static gchar*
+create_replay_text (CommentsRecord *record)
+{
+  static const gchar *words[] = 
+  {
+    "value", "=", "compute", "(value,", "index);", "return", "result;", "if", "{", "}"
+  };
+  GString *string;
+  GRand *rand;
+  gboolean block;
+  gboolean commented;
+  gboolean strip;
+  gsize width;
+  guint i;
+
+  if (record->length == 0 || record->lines == 0)
+    return g_strdup ("value = compute (value, 0);");
+
+  block = *record->end != '\0';
+  commented = g_str_has_prefix (record->operation, "uncomment");
+  strip = g_strcmp0 (record->operation, "strip-comments") == 0;
+  width = MAX (record->length / record->lines, 2);
+
+  rand = g_rand_new_with_seed (record->hash);
+  string = g_string_sized_new (record->length + 1);
+
+  if (commented && block)
+    g_string_append (string, record->start);
+
+  for (i = 0; i < record->lines; i++)
+    {
+      gboolean line_comment;
+      gsize line_start;
+      gsize body_start;
+
+      line_comment = (commented && !block) || (strip && i % 2 == 1);
+
+      if (i > 0)
+        g_string_append_c (string, '\n');
+
+      line_start = string->len;
+      g_string_append_printf (string, "%*s", g_rand_int_range (rand, 0, 4) * 2, "");
+
+      if (line_comment)
+        {
+          g_string_append (string, record->start);
+          if (record->padding)
+            g_string_append_c (string, ' ');
+        }
+
+      body_start = string->len;
+      while (string->len - line_start < width)
+        {
+          if (string->len > body_start)
+            g_string_append_c (string, ' ');
+          g_string_append (string, words[g_rand_int_range (rand, 0, G_N_ELEMENTS (words))]);
+        }
+      g_string_truncate (string, MAX (line_start + width - 1, body_start + 1));
+
+      if (line_comment && block)
+        g_string_append (string, record->end);
+    }
+
+  if (commented && block)
+    g_string_append (string, record->end);
+
+  g_rand_free (rand);
+
+  return g_string_free (string, FALSE);
+}
+
+/*
+ * Traces made from documents that had not been saved yet carry no file
+ * type, so they get one of their own.
+ */
+static const gchar*
+get_replay_suffix (CommentsRecord *record)
+{
+  return *record->suffix != '\0' ? record->suffix : ".untitled";
+}
+
+static gchar*
+get_replay_path (CommentsRecord *record)
+{
+  const gchar *suffix;
+
+  suffix = get_replay_suffix (record);
+
+  if (*suffix == '.')
+    return g_strconcat ("/tmp/replay", suffix, NULL);
+
+  return g_build_filename ("/tmp", suffix, NULL);
+}
+
+static void
+replay_trace (CodeSlayer *codeslayer,
+              GtkWidget  *menu,
+              GPtrArray  *records)
+{
+  GtkSourceLanguageManager *manager;
+  GHashTable *times;
+  GHashTable *recorded;
+  GPtrArray *operations;
+  guint skipped = 0;
+  guint j;
+  gint i;
+
+  manager = gtk_source_language_manager_get_default ();
+
+  times = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, 
+                                 (GDestroyNotify) g_array_unref);
+  recorded = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, 
+                                    (GDestroyNotify) g_array_unref);
+  operations = g_ptr_array_new ();
+
+  for (i = 0; i < iterations; i++)
+    {
+      for (j = 0; j < records->len; j++)
+        {
+          CommentsRecord *record = g_ptr_array_index (records, j);
+          const gchar *action = record->operation;
+          GtkSourceBuffer *buffer;
+          GtkTextIter start, end;
+          GArray *operation_times;
+          gchar *file_path;
+          gchar *text;
+          gint64 time;
+
+          if (g_strcmp0 (action, "comment-lines") == 0 ||
+              g_strcmp0 (action, "comment-ranges") == 0)
+            action = "comment-document";
+          else if (g_strcmp0 (action, "uncomment-lines") == 0 ||
+                   g_strcmp0 (action, "uncomment-ranges") == 0)
+            action = "uncomment-document";
+
+          if (g_strcmp0 (action, "comment") != 0 &&
+              g_strcmp0 (action, "uncomment") != 0 &&
+              g_strcmp0 (action, "comment-document") != 0 &&
+              g_strcmp0 (action, "uncomment-document") != 0 &&
+              g_strcmp0 (action, "strip-comments") != 0)
+            {
+              if (i == 0)
+                skipped++;
+              continue;
+            }
+
+          file_path = get_replay_path (record);
+
+          buffer = gtk_source_buffer_new (NULL);
+          gtk_source_buffer_set_language (buffer, 
+                                          gtk_source_language_manager_guess_language (manager, file_path, NULL));
+
+          text = create_replay_text (record);
+          gtk_text_buffer_set_text (GTK_TEXT_BUFFER (buffer), text, -1);
+          g_free (text);
+
+          comments_host_open_document (codeslayer, file_path, NULL, buffer);
+
+          gtk_text_buffer_get_bounds (GTK_TEXT_BUFFER (buffer), &start, &end);
+          if (record->length == 0)
+            end = start;
+          gtk_text_buffer_select_range (GTK_TEXT_BUFFER (buffer), &start, &end);
+
+          time = run_action (menu, action, MAX (record->count, 1), NULL);
+          g_print ("%s\t%u\t%" G_GINT64_FORMAT "\n", record->operation, 
+                   record->lines, time);
+
+          operation_times = g_hash_table_lookup (times, record->operation);
+          if (operation_times == NULL)
+            {
+              operation_times = g_array_new (FALSE, FALSE, sizeof (gint64));
+              g_hash_table_insert (times, record->operation, operation_times);
+              g_hash_table_insert (recorded, record->operation, 
+                                   g_array_new (FALSE, FALSE, sizeof (gint64)));
+              g_ptr_array_add (operations, record->operation);
+            }
+          g_array_append_val (operation_times, time);
+
+          if (i == 0)
+            g_array_append_val (g_hash_table_lookup (recorded, record->operation), 
+                                record->duration);
+
+          g_object_unref (buffer);
+          g_free (file_path);
+        }
+    }
+
+  g_printerr ("%u processors, %s searches\n", g_get_num_processors (), 
+              simd_level_names[comments_simd_get_level ()]);
+
+  for (j = 0; j < operations->len; j++)
+    {
+      const gchar *operation = g_ptr_array_index (operations, j);
+      print_percentiles (operation, g_hash_table_lookup (times, operation),
+                         g_hash_table_lookup (recorded, operation));
+    }
+
+  if (skipped > 0)
+    g_printerr ("skipped %u actions that need a pattern\n", skipped);
+
+  g_ptr_array_free (operations, TRUE);
+  g_hash_table_destroy (times);
+  g_hash_table_destroy (recorded);
+}
+
+/*
+ * The engine applies the action from a main loop source, with no wait for
+ * more repeats here, so the time runs until the main loop has nothing left
+ * to do. Emitting the action more than once stands in for the accelerator
+ * being held down.
+ */
+static gint64
+run_action (GtkWidget   *menu,
+            const gchar *action,
+            guint        count,
+            gint64      *allocated)
+{
+  gint64 start;
+  guint first;
+  guint i;
+
+  first = (guint) g_atomic_int_get (&allocations);
+  start = g_get_monotonic_time ();
+
+  for (i = 0; i < count; i++)
+    g_signal_emit_by_name (menu, action);
+
+  while (gtk_events_pending ())
+    gtk_main_iteration ();
+
+  if (allocated != NULL)
+    *allocated = (guint) g_atomic_int_get (&allocations) - first;
+
+  return g_get_monotonic_time () - start;
+}
+
+static void
+print_summary (const gchar *action,
+               GArray      *times)
+{
+  if (times->len == 0)
+    return;
+
+  g_array_sort (times, compare_times);
+
+  g_printerr ("%s: min %.2f ms, median %.2f ms, max %.2f ms\n", action, 
+              g_array_index (times, gint64, 0) / 1000.0,
+              g_array_index (times, gint64, times->len / 2) / 1000.0,
+              g_array_index (times, gint64, times->len - 1) / 1000.0);
+}
+
+/*
+ * The first run grows the engine's scratch space, so the last shows what
+ * an action costs once it has settled.
+ */
+static void
+print_allocations (const gchar *action,
+                   GArray      *counts)
+{
+  gint64 last;
+
+  if (counts->len == 0)
+    return;
+
+  last = g_array_index (counts, gint64, counts->len - 1);
+  g_array_sort (counts, compare_times);
+
+  g_printerr ("%s: min %" G_GINT64_FORMAT " allocations, median %" G_GINT64_FORMAT 
+              ", max %" G_GINT64_FORMAT ", last run %" G_GINT64_FORMAT "\n", action, 
+              g_array_index (counts, gint64, 0),
+              g_array_index (counts, gint64, counts->len / 2),
+              g_array_index (counts, gint64, counts->len - 1),
+              last);
+}
+
+/*
+ * The recorded median is what the action took in the session the trace
+ * came from, and is only a rough guide when that was another machine.
+ */
+static void
+print_percentiles (const gchar *action,
+                   GArray      *times,
+                   GArray      *recorded)
+{
+  if (times->len == 0)
+    return;
+
+  g_array_sort (times, compare_times);
+  g_array_sort (recorded, compare_times);
+
+  g_printerr ("%s: %u runs, p50 %.2f ms, p90 %.2f ms, p99 %.2f ms, max %.2f ms, "
+              "recorded p50 %.2f ms\n", action, times->len,
+              g_array_index (times, gint64, (times->len - 1) * 50 / 100) / 1000.0,
+              g_array_index (times, gint64, (times->len - 1) * 90 / 100) / 1000.0,
+              g_array_index (times, gint64, (times->len - 1) * 99 / 100) / 1000.0,
+              g_array_index (times, gint64, times->len - 1) / 1000.0,
+              g_array_index (recorded, gint64, (recorded->len - 1) * 50 / 100) / 1000.0);
+}
+
+static gint
+compare_times (gconstpointer a,
+               gconstpointer b)
+{
+  gint64 first = *(const gint64 *) a;
+  gint64 second = *(const gint64 *) b;
+  return first < second ? -1 : first > second;
+}
+
+/* the CPU may not have the level asked for, the searches stop at its own */
+static gboolean
+set_simd_level (const gchar *name)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (simd_level_names); i++)
+    {
+      if (g_strcmp0 (name, simd_level_names[i]) == 0)
+        {
+          comments_simd_set_level ((CommentsSimdLevel) i);
+          return TRUE;
+        }
+    }
+
+  return FALSE;
+}
@@ -0,0 +1,564 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <string.h>
+#include "comments-blocks.h"
+#include "comments-simd.h"
+
+/*
+ * Keeps the comment blocks of a buffer as a sorted list of line intervals,
+ * so whether a line is commented, or where the next block starts, is a
+ * binary search rather than a pass over the text.
+ *
+ * A block is a run of lines that hold nothing but comments, together with
+ * every line that a block comment is open across. The first line of a
+ * block, and any line outside of one, never starts inside a block comment,
+ * which is what lets part of the buffer be scanned again on its own.
+ *
+ * Edits only move the intervals after them and widen a dirty range; the
+ * dirty lines are scanned again the next time the buffer is asked about,
+ * carrying on past them until the scan is back in step with the list.
+ *
+ * A buffer keeps one list for the line comment and one for the block
+ * comment delimiters it was last asked about, so going between the two
+ * does not scan it all again. Asking with other delimiters of the same
+ * kind replaces that list. The edit handlers are connected once per
+ * buffer and move whichever lists it has.
+ */
+
+#define BLOCKS "comments_blocks"
+#define CHUNK_LINES 1024
+
+typedef struct _Block Block;
+typedef struct _Blocks Blocks;
+typedef struct _Lists Lists;
+
+struct _Block
+{
+  gint first;
+  gint last;
+};
+
+struct _Blocks
+{
+  gchar    *start;
+  gchar    *end;
+  GArray   *list;
+  gboolean  dirty;
+  gint      dirty_first;
+  gint      dirty_last;
+};
+
+struct _Lists
+{
+  Blocks *line;
+  Blocks *block;
+  gint    insert_line;
+};
+
+static Blocks*   get_blocks     (GtkTextBuffer     *buffer,
+                                 const gchar       *start,
+                                 const gchar       *end);
+static void      free_blocks    (Blocks            *blocks);
+static void      free_lists     (Lists             *lists);
+static void      set_delimiters (Blocks            *blocks,
+                                 const gchar       *start,
+                                 const gchar       *end);
+static void      mark_dirty     (Blocks            *blocks,
+                                 gint               first,
+                                 gint               last);
+static gint      shift_line     (gint               position,
+                                 gint               line,
+                                 gint               delta);
+static void      move_blocks    (Blocks            *blocks,
+                                 gint               line,
+                                 gint               delta);
+static guint     find_index     (GArray            *list,
+                                 gint               line);
+static void      rescan         (Blocks            *blocks,
+                                 GtkTextBuffer     *buffer);
+static gboolean  scan_line      (const gchar       *pos,
+                                 const gchar       *eol,
+                                 const gchar       *start,
+                                 gsize              start_length,
+                                 const gchar       *end,
+                                 gsize              end_length,
+                                 gboolean          *in_block);
+static void      insert_text    (GtkTextBuffer     *buffer,
+                                 GtkTextIter       *iter,
+                                 gchar             *text,
+                                 gint               length,
+                                 Lists             *lists);
+static void      inserted_text  (GtkTextBuffer     *buffer,
+                                 GtkTextIter       *iter,
+                                 gchar             *text,
+                                 gint               length,
+                                 Lists             *lists);
+static void      delete_range   (GtkTextBuffer     *buffer,
+                                 GtkTextIter       *start,
+                                 GtkTextIter       *end,
+                                 Lists             *lists);
+
+/*
+ * Finds the block at line, the first one after it, or the one before it,
+ * with a line comment start and a block comment end. The previous block
+ * of a line inside a block is the block itself, so going back from the
+ * middle of a block first goes to its top. Lines count from zero.
+ */
+gboolean
+comments_blocks_find (GtkTextBuffer        *buffer,
+                      const gchar          *start,
+                      const gchar          *end,
+                      gint                  line,
+                      CommentsBlocksSearch  search,
+                      gint                 *first,
+                      gint                 *last)
+{
+  Blocks *blocks;
+  Block *block = NULL;
+  guint index;
+
+  if (start == NULL || *start == '\0')
+    return FALSE;
+
+  blocks = get_blocks (buffer, start, end);
+
+  if (blocks->dirty)
+    rescan (blocks, buffer);
+
+  index = find_index (blocks->list, line);
+
+  switch (search)
+    {
+    case COMMENTS_BLOCKS_AT:
+      if (index < blocks->list->len &&
+          g_array_index (blocks->list, Block, index).first <= line)
+        block = &g_array_index (blocks->list, Block, index);
+      break;
+    case COMMENTS_BLOCKS_NEXT:
+      if (index < blocks->list->len &&
+          g_array_index (blocks->list, Block, index).first <= line)
+        index++;
+      if (index < blocks->list->len)
+        block = &g_array_index (blocks->list, Block, index);
+      break;
+    case COMMENTS_BLOCKS_PREVIOUS:
+      if (index < blocks->list->len &&
+          g_array_index (blocks->list, Block, index).first < line)
+        block = &g_array_index (blocks->list, Block, index);
+      else if (index > 0)
+        block = &g_array_index (blocks->list, Block, index - 1);
+      break;
+    }
+
+  if (block == NULL)
+    return FALSE;
+
+  *first = block->first;
+  *last = block->last;
+
+  return TRUE;
+}
+
+static Blocks*
+get_blocks (GtkTextBuffer *buffer,
+            const gchar   *start,
+            const gchar   *end)
+{
+  Lists *lists;
+  Blocks **blocks;
+
+  if (end != NULL && *end == '\0')
+    end = NULL;
+
+  lists = g_object_get_data (G_OBJECT (buffer), BLOCKS);
+  if (lists == NULL)
+    {
+      lists = g_new0 (Lists, 1);
+      g_object_set_data_full (G_OBJECT (buffer), BLOCKS, lists, 
+                              (GDestroyNotify) free_lists);
+
+      g_signal_connect (G_OBJECT (buffer), "insert-text", 
+                        G_CALLBACK (insert_text), lists);
+      g_signal_connect_after (G_OBJECT (buffer), "insert-text", 
+                              G_CALLBACK (inserted_text), lists);
+      g_signal_connect (G_OBJECT (buffer), "delete-range", 
+                        G_CALLBACK (delete_range), lists);
+    }
+
+  blocks = end != NULL ? &lists->block : &lists->line;
+
+  if (*blocks != NULL && 
+      (g_strcmp0 ((*blocks)->start, start) != 0 || 
+       g_strcmp0 ((*blocks)->end, end) != 0))
+    {
+      free_blocks (*blocks);
+      *blocks = NULL;
+    }
+
+  if (*blocks == NULL)
+    {
+      *blocks = g_new0 (Blocks, 1);
+      (*blocks)->list = g_array_new (FALSE, FALSE, sizeof (Block));
+      set_delimiters (*blocks, start, end);
+    }
+
+  return *blocks;
+}
+
+static void
+free_blocks (Blocks *blocks)
+{
+  g_free (blocks->start);
+  g_free (blocks->end);
+  g_array_free (blocks->list, TRUE);
+  g_free (blocks);
+}
+
+static void
+free_lists (Lists *lists)
+{
+  if (lists->line != NULL)
+    free_blocks (lists->line);
+  if (lists->block != NULL)
+    free_blocks (lists->block);
+  g_free (lists);
+}
+
+/* a new list starts out with the whole buffer dirty */
+static void
+set_delimiters (Blocks      *blocks,
+                const gchar *start,
+                const gchar *end)
+{
+  if (end != NULL && *end == '\0')
+    end = NULL;
+
+  blocks->start = g_strdup (start);
+  blocks->end = g_strdup (end);
+
+  blocks->dirty = FALSE;
+  mark_dirty (blocks, 0, G_MAXINT);
+}
+
+static void
+mark_dirty (Blocks *blocks,
+            gint    first,
+            gint    last)
+{
+  if (blocks->dirty)
+    {
+      first = MIN (first, blocks->dirty_first);
+      last = MAX (last, blocks->dirty_last);
+    }
+
+  blocks->dirty = TRUE;
+  blocks->dirty_first = first;
+  blocks->dirty_last = last;
+}
+
+/*
+ * Where a line ends up once delta lines are added after line, or once the
+ * lines after line up to line - delta are taken out.
+ */
+static gint
+shift_line (gint position,
+            gint line,
+            gint delta)
+{
+  if (position <= line || position == G_MAXINT)
+    return position;
+
+  if (delta >= 0)
+    return position + delta;
+
+  if (position <= line - delta)
+    return line;
+
+  return position + delta;
+}
+
+static void
+move_blocks (Blocks *blocks,
+             gint    line,
+             gint    delta)
+{
+  guint i;
+
+  if (delta != 0)
+    {
+      for (i = find_index (blocks->list, line); i < blocks->list->len; i++)
+        {
+          Block *block = &g_array_index (blocks->list, Block, i);
+          block->first = shift_line (block->first, line, delta);
+          block->last = shift_line (block->last, line, delta);
+        }
+
+      if (blocks->dirty)
+        {
+          blocks->dirty_first = shift_line (blocks->dirty_first, line, delta);
+          blocks->dirty_last = shift_line (blocks->dirty_last, line, delta);
+        }
+    }
+
+  mark_dirty (blocks, line, line + MAX (delta, 0));
+}
+
+/* the index of the first block that ends at or after line */
+static guint
+find_index (GArray *list,
+            gint    line)
+{
+  guint low = 0;
+  guint high = list->len;
+
+  while (low < high)
+    {
+      guint middle = low + (high - low) / 2;
+      if (g_array_index (list, Block, middle).last < line)
+        low = middle + 1;
+      else
+        high = middle;
+    }
+
+  return low;
+}
+
+/*
+ * Scans from the top of the block at or just above the dirty lines, and
+ * keeps going until it has passed them and every old block it ran into,
+ * on a line that is not part of a block. The old blocks it passed are
+ * swapped for the ones it found.
+ */
+static void
+rescan (Blocks        *blocks,
+        GtkTextBuffer *buffer)
+{
+  GArray *found;
+  GtkTextIter iter;
+  gchar *text = NULL;
+  const gchar *pos = NULL;
+  gsize start_length;
+  gsize end_length;
+  gint n_lines;
+  gint line;
+  gint limit;
+  gint run = -1;
+  gint chunk = 0;
+  gboolean in_block = FALSE;
+  guint index;
+  guint old;
+
+  blocks->dirty = FALSE;
+
+  n_lines = gtk_text_buffer_get_line_count (buffer);
+  line = MIN (blocks->dirty_first, n_lines - 1);
+  limit = MIN (blocks->dirty_last, n_lines - 1);
+
+  index = find_index (blocks->list, line - 1);
+  if (index < blocks->list->len &&
+      g_array_index (blocks->list, Block, index).first <= line)
+    line = g_array_index (blocks->list, Block, index).first;
+
+  start_length = strlen (blocks->start);
+  end_length = blocks->end != NULL ? strlen (blocks->end) : 0;
+
+  found = g_array_new (FALSE, FALSE, sizeof (Block));
+  old = index;
+
+  gtk_text_buffer_get_iter_at_line (buffer, &iter, line);
+
+  while (line < n_lines)
+    {
+      const gchar *eol;
+      const gchar *next;
+      gboolean part;
+
+      while (old < blocks->list->len &&
+             g_array_index (blocks->list, Block, old).first <= line)
+        {
+          limit = MAX (limit, g_array_index (blocks->list, Block, old).last);
+          old++;
+        }
+
+      if (chunk == 0)
+        {
+          GtkTextIter stop = iter;
+          chunk = MIN (MAX (limit - line + 1, CHUNK_LINES), n_lines - line);
+          gtk_text_iter_forward_lines (&stop, chunk);
+          g_free (text);
+          text = gtk_text_iter_get_slice (&iter, &stop);
+          pos = text;
+        }
+
+      next = pos + gtk_text_iter_get_bytes_in_line (&iter);
+      eol = next;
+      if (eol > pos && eol[-1] == '\n')
+        eol--;
+      if (eol > pos && eol[-1] == '\r')
+        eol--;
+
+      part = scan_line (pos, eol, blocks->start, start_length, 
+                        blocks->end, end_length, &in_block);
+
+      if (part && run < 0)
+        run = line;
+
+      if (!part && run >= 0)
+        {
+          Block block = { run, line - 1 };
+          g_array_append_val (found, block);
+          run = -1;
+        }
+
+      pos = next;
+      chunk--;
+      gtk_text_iter_forward_line (&iter);
+      line++;
+
+      if (!part && line > limit)
+        break;
+    }
+
+  if (run >= 0)
+    {
+      Block block = { run, line - 1 };
+      g_array_append_val (found, block);
+    }
+
+  g_free (text);
+
+  g_array_remove_range (blocks->list, index, old - index);
+  if (found->len > 0)
+    g_array_insert_vals (blocks->list, index, found->data, found->len);
+  g_array_free (found, TRUE);
+}
+
+/*
+ * Whether the line belongs to a block: it holds comments and no code, or a
+ * block comment is open at either end of it. Delimiters in string literals
+ * are taken as delimiters, the same as in the density report.
+ */
+static gboolean
+scan_line (const gchar *pos,
+           const gchar *eol,
+           const gchar *start,
+           gsize        start_length,
+           const gchar *end,
+           gsize        end_length,
+           gboolean    *in_block)
+{
+  gboolean opened = *in_block;
+  gboolean code = FALSE;
+  gboolean comment = FALSE;
+
+  while (pos < eol)
+    {
+      while (pos < eol && g_ascii_isspace (*pos))
+        pos++;
+
+      if (pos == eol)
+        break;
+
+      if (*in_block)
+        {
+          const gchar *close;
+
+          comment = TRUE;
+          close = comments_simd_find_delimiter (pos, eol, end, end_length);
+          if (close == eol)
+            break;
+
+          *in_block = FALSE;
+          pos = close + end_length;
+        }
+      else if ((gsize) (eol - pos) >= start_length &&
+               memcmp (pos, start, start_length) == 0)
+        {
+          comment = TRUE;
+          if (end_length == 0)
+            break;
+
+          *in_block = TRUE;
+          pos += start_length;
+        }
+      else
+        {
+          code = TRUE;
+          if (end_length == 0)
+            break;
+
+          pos = comments_simd_find_delimiter (pos, eol, start, start_length);
+        }
+    }
+
+  return opened || *in_block || (comment && !code);
+}
+
+static void
+insert_text (GtkTextBuffer *buffer,
+             GtkTextIter   *iter,
+             gchar         *text,
+             gint           length,
+             Lists         *lists)
+{
+  lists->insert_line = gtk_text_iter_get_line (iter);
+}
+
+/* by now iter has been moved to the end of the text that went in */
+static void
+inserted_text (GtkTextBuffer *buffer,
+               GtkTextIter   *iter,
+               gchar         *text,
+               gint           length,
+               Lists         *lists)
+{
+  gint delta;
+
+  delta = gtk_text_iter_get_line (iter) - lists->insert_line;
+
+  if (lists->line != NULL)
+    move_blocks (lists->line, lists->insert_line, delta);
+  if (lists->block != NULL)
+    move_blocks (lists->block, lists->insert_line, delta);
+}
+
+static void
+delete_range (GtkTextBuffer *buffer,
+              GtkTextIter   *start,
+              GtkTextIter   *end,
+              Lists         *lists)
+{
+  gint first;
+  gint last;
+
+  first = gtk_text_iter_get_line (start);
+  last = gtk_text_iter_get_line (end);
+
+  if (first > last)
+    {
+      gint swap = first;
+      first = last;
+      last = swap;
+    }
+
+  if (lists->line != NULL)
+    move_blocks (lists->line, first, first - last);
+  if (lists->block != NULL)
+    move_blocks (lists->block, first, first - last);
+}
@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __COMMENTS_BLOCKS_H__
+#define	__COMMENTS_BLOCKS_H__
+
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+  COMMENTS_BLOCKS_AT,
+  COMMENTS_BLOCKS_NEXT,
+  COMMENTS_BLOCKS_PREVIOUS
+} CommentsBlocksSearch;
+
+gboolean  comments_blocks_find  (GtkTextBuffer        *buffer,
+                                 const gchar          *start,
+                                 const gchar          *end,
+                                 gint                  line,
+                                 CommentsBlocksSearch  search,
+                                 gint                 *first,
+                                 gint                 *last);
+
+G_END_DECLS
+
+#endif /* __COMMENTS_BLOCKS_H__ */
@@ -0,0 +1,623 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Checks that the fast paths give the same bytes as the plain ones they
+ * stand in for, over generated text.
+ *
+ *   comments-check [--seed N] [--size MB]
+ *
+ * parallel: the line transforms run through comments_parallel_transform
+ * against one call over the whole text, for every kind of line break. The
+ * text is only split on two or more processors, so on one the check
+ * passes trivially and says so.
+ *
+ * simd: comments_simd_find_newline and comments_simd_find_delimiter at
+ * every level the CPU has, from the scalar loops up, against the plain
+ * loops below, from every start and to every end of short texts at every
+ * alignment, so the tails the vector loops leave to smaller ones are
+ * covered as well as the blocks.
+ *
+ * eol: the line transforms, and the block comment that appends a break,
+ * over LF text against the same text with each \n turned into CRLF, CR
+ * or any of the three. The result has to be the LF one with the input's
+ * own breaks put back in order, and the style's break for any the
+ * transform added.
+ *
+ * Prints one line per check to stderr and exits with 1 if any of them
+ * differ. make check runs it with the defaults, so every check, eol
+ * included, runs on each make check with a fresh seed; the seed is in
+ * comments-check.log to repeat a failure with --seed.
+ */
+
+#include <string.h>
+#include "comments-transform.h"
+#include "comments-parallel.h"
+#include "comments-simd.h"
+
+#define LINE_START "//"
+
+/* longer than two vector blocks, so every tail length comes up */
+#define SIMD_TEXT_LENGTH 80
+#define SIMD_TEXTS 500
+
+#define EOL_TEXTS 200
+#define EOL_TEXT_SIZE 2048
+
+typedef void (*LineFunc) (GString     *result,
+                          const gchar *text,
+                          gssize       length,
+                          const gchar *start,
+                          CommentsEol  eol);
+
+typedef struct _LineTransform LineTransform;
+
+struct _LineTransform
+{
+  LineFunc     func;
+  CommentsEol  eol;
+};
+
+static gboolean  check_parallel   (GRand         *rand);
+static gboolean  check_simd       (GRand         *rand);
+static gboolean  check_searches   (const gchar   *text,
+                                   gsize          length,
+                                   CommentsSimdLevel level,
+                                   guint         *n_searches);
+static gboolean  check_eol        (GRand         *rand);
+static void      transform_block  (GString       *result,
+                                   const gchar   *text,
+                                   gssize         length,
+                                   const gchar   *start,
+                                   CommentsEol    eol);
+static GString*  convert_breaks   (GRand         *rand,
+                                   GString       *text,
+                                   CommentsEol    eol,
+                                   GPtrArray     *breaks);
+static GString*  restore_breaks   (GString       *text,
+                                   CommentsEol    eol,
+                                   GPtrArray     *breaks);
+static const gchar* pick_break    (GRand         *rand,
+                                   GString       *text,
+                                   CommentsEol    eol);
+static const gchar* find_newline    (const gchar   *text,
+                                     const gchar   *end);
+static const gchar* find_delimiter  (const gchar   *text,
+                                     const gchar   *end,
+                                     const gchar   *delimiter);
+static void      transform_lines  (GString       *result,
+                                   const gchar   *text,
+                                   gsize          length,
+                                   LineTransform *transform);
+static GString*  create_text      (GRand         *rand,
+                                   gsize          size,
+                                   CommentsEol    eol);
+static gboolean  compare_results  (const gchar   *check,
+                                   const gchar   *what,
+                                   GString       *expected,
+                                   GString       *actual);
+
+static const gchar *lines[] =
+{
+  "int main (void)",
+  "{",
+  "  return 0;",
+  "}",
+  "",
+  "\t/* tabbed */",
+  "    // already commented",
+  "//",
+  "  //  padded",
+  "x = \"// not a comment\";",
+  "caf\xc3\xa9 // \xe2\x82\xac",
+  "                                                            long indent",
+};
+
+static const CommentsEol eols[] =
+{
+  COMMENTS_EOL_LF,
+  COMMENTS_EOL_CRLF,
+  COMMENTS_EOL_CR,
+  COMMENTS_EOL_MIXED
+};
+
+/* by CommentsEol */
+static const gchar *eol_names[] = { "no", "lf", "crlf", "cr", "mixed" };
+
+static const gchar *delimiters[] =
+{
+  "#", "/", "//", "--", "/*", "*/", "<!--", "-->", "\r\n"
+};
+
+/* by CommentsSimdLevel */
+static const gchar *level_names[] = { "scalar", "sse2", "avx2" };
+
+static gint seed = 0;
+static gint size = 8;
+
+static GOptionEntry entries[] =
+{
+  { "seed", 's', 0, G_OPTION_ARG_INT, &seed, "seed of the generated text, random by default", "N" },
+  { "size", 'm', 0, G_OPTION_ARG_INT, &size, "megabytes of text for the parallel check", "MB" },
+  { NULL }
+};
+
+int
+main (int    argc,
+      char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  GRand *rand;
+  gboolean passed = TRUE;
+
+  context = g_option_context_new ("- check the fast paths against the plain ones");
+  g_option_context_add_main_entries (context, entries, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("comments-check: %s\n", error->message);
+      return 1;
+    }
+  g_option_context_free (context);
+
+  if (seed == 0)
+    seed = g_random_int_range (1, G_MAXINT);
+  g_printerr ("seed %d\n", seed);
+
+  rand = g_rand_new_with_seed (seed);
+
+  passed &= check_simd (rand);
+  passed &= check_parallel (rand);
+  passed &= check_eol (rand);
+
+  g_rand_free (rand);
+
+  return passed ? 0 : 1;
+}
+
+/*
+ * Big enough that every processor gets chunks. The commented text is
+ * checked as well, so the remove has delimiters to take out. One pool and
+ * one arena serve every transform, the way the engine keeps them, so the
+ * chunk strings are reused with whatever the last transform left in them.
+ */
+static gboolean
+check_parallel (GRand *rand)
+{
+  LineFunc funcs[] = { comments_transform_insert_line,
+                       comments_transform_remove_line };
+  CommentsParallel *parallel;
+  CommentsArena *arena;
+  gboolean passed = TRUE;
+  guint i;
+  guint j;
+  guint k;
+
+  if (g_get_num_processors () < 2)
+    g_printerr ("parallel: one processor, the text is not split\n");
+
+  parallel = comments_parallel_new ();
+  arena = comments_arena_new (COMMENTS_ARENA_LIMIT);
+
+  for (i = 0; i < G_N_ELEMENTS (eols); i++)
+    {
+      LineTransform transform;
+      GString *texts[2];
+
+      transform.func = comments_transform_insert_line;
+      transform.eol = eols[i];
+
+      texts[0] = create_text (rand, (gsize) MAX (size, 1) * 1024 * 1024, eols[i]);
+      texts[1] = g_string_new (NULL);
+      transform_lines (texts[1], texts[0]->str, texts[0]->len, &transform);
+
+      for (j = 0; j < G_N_ELEMENTS (texts); j++)
+        {
+          for (k = 0; k < G_N_ELEMENTS (funcs); k++)
+            {
+              GString *expected;
+              GString *actual;
+              gchar *what;
+
+              transform.func = funcs[k];
+
+              expected = g_string_new (NULL);
+              transform_lines (expected, texts[j]->str, texts[j]->len, &transform);
+
+              actual = g_string_new (NULL);
+              comments_parallel_transform (parallel, arena, actual, 
+                                           texts[j]->str, texts[j]->len,
+                                           (CommentsChunkFunc) transform_lines,
+                                           &transform);
+              comments_arena_reset (arena);
+
+              what = g_strdup_printf ("%s over %s%s text", 
+                                      k == 0 ? "insert" : "remove",
+                                      j == 0 ? "" : "commented ", 
+                                      eol_names[eols[i]]);
+              passed &= compare_results ("parallel", what, expected, actual);
+              g_free (what);
+
+              g_string_free (expected, TRUE);
+              g_string_free (actual, TRUE);
+            }
+        }
+
+      g_string_free (texts[0], TRUE);
+      g_string_free (texts[1], TRUE);
+    }
+
+  comments_parallel_free (parallel);
+  comments_arena_free (arena);
+
+  return passed;
+}
+
+/*
+ * Dense texts find something in the first block, sparse ones mostly run
+ * through whole blocks before they do. The level is put back to the
+ * highest afterwards, for the checks that follow.
+ */
+static gboolean
+check_simd (GRand *rand)
+{
+  const gchar dense[] = "ab/*-#<!>\n\r\xe2";
+  CommentsSimdLevel highest;
+  CommentsSimdLevel level;
+  gboolean passed = TRUE;
+  gchar buffer[SIMD_TEXT_LENGTH + 32];
+
+  highest = comments_simd_get_level ();
+
+  for (level = COMMENTS_SIMD_SCALAR; level <= highest; level++)
+    {
+      guint n_searches = 0;
+      gboolean same = TRUE;
+      guint i;
+
+      comments_simd_set_level (level);
+
+      for (i = 0; i < SIMD_TEXTS && same; i++)
+        {
+          gsize offset;
+          gsize length;
+          gint sparse;
+          gsize j;
+
+          offset = g_rand_int_range (rand, 0, 32);
+          length = g_rand_int_range (rand, 0, SIMD_TEXT_LENGTH + 1);
+          sparse = g_rand_boolean (rand) ? 40 : 1;
+
+          for (j = 0; j < length; j++)
+            {
+              if (g_rand_int_range (rand, 0, sparse) == 0)
+                buffer[offset + j] = dense[g_rand_int_range (rand, 0, sizeof (dense) - 1)];
+              else
+                buffer[offset + j] = 'a';
+            }
+
+          same = check_searches (buffer + offset, length, level, &n_searches);
+        }
+
+      if (same)
+        g_printerr ("simd: %s, %u searches the same\n", level_names[level], 
+                    n_searches);
+
+      passed &= same;
+    }
+
+  comments_simd_set_level (highest);
+
+  return passed;
+}
+
+static gboolean
+check_searches (const gchar       *text,
+                gsize              length,
+                CommentsSimdLevel  level,
+                guint             *n_searches)
+{
+  gsize start;
+  gsize end;
+  guint i;
+
+  for (start = 0; start <= length; start++)
+    {
+      for (end = start; end <= length; end++)
+        {
+          if (comments_simd_find_newline (text + start, text + end) != 
+              find_newline (text + start, text + end))
+            {
+              g_printerr ("simd: %s newline search from %" G_GSIZE_FORMAT 
+                          " to %" G_GSIZE_FORMAT " differs\n", 
+                          level_names[level], start, end);
+              return FALSE;
+            }
+
+          for (i = 0; i < G_N_ELEMENTS (delimiters); i++)
+            {
+              if (comments_simd_find_delimiter (text + start, text + end, 
+                                                delimiters[i], 
+                                                strlen (delimiters[i])) != 
+                  find_delimiter (text + start, text + end, delimiters[i]))
+                {
+                  g_printerr ("simd: %s search for delimiter %u from %" 
+                              G_GSIZE_FORMAT " to %" G_GSIZE_FORMAT " differs\n", 
+                              level_names[level], i, start, end);
+                  return FALSE;
+                }
+            }
+
+          *n_searches += 1 + G_N_ELEMENTS (delimiters);
+        }
+    }
+
+  return TRUE;
+}
+
+static const gchar*
+find_newline (const gchar *text,
+              const gchar *end)
+{
+  for (; text < end; text++)
+    if (*text == '\n' || *text == '\r')
+      return text;
+  return end;
+}
+
+static const gchar*
+find_delimiter (const gchar *text,
+                const gchar *end,
+                const gchar *delimiter)
+{
+  gsize length = strlen (delimiter);
+
+  for (; (gsize) (end - text) >= length; text++)
+    if (memcmp (text, delimiter, length) == 0)
+      return text;
+  return end;
+}
+
+static gboolean
+check_eol (GRand *rand)
+{
+  LineFunc funcs[] = { comments_transform_insert_line,
+                       comments_transform_remove_line,
+                       transform_block };
+  const gchar *names[] = { "insert", "remove", "block" };
+  gboolean passed = TRUE;
+  guint i;
+  guint j;
+  guint k;
+
+  for (i = 1; i < G_N_ELEMENTS (eols); i++)
+    {
+      for (j = 0; j < G_N_ELEMENTS (funcs); j++)
+        {
+          gboolean same = TRUE;
+          gsize bytes = 0;
+
+          for (k = 0; k < EOL_TEXTS && same; k++)
+            {
+              GPtrArray *breaks;
+              GString *text;
+              GString *converted;
+              GString *result;
+              GString *expected;
+              GString *actual;
+              gchar *what;
+
+              text = create_text (rand, g_rand_int_range (rand, 0, EOL_TEXT_SIZE), 
+                                  COMMENTS_EOL_LF);
+
+              /* the remove needs commented lines half of the time */
+              if (j == 1 && g_rand_boolean (rand))
+                {
+                  GString *commented = g_string_new (NULL);
+                  comments_transform_insert_line (commented, text->str, text->len, 
+                                                  LINE_START, COMMENTS_EOL_LF);
+                  g_string_free (text, TRUE);
+                  text = commented;
+                }
+
+              breaks = g_ptr_array_new ();
+              converted = convert_breaks (rand, text, eols[i], breaks);
+
+              result = g_string_new (NULL);
+              funcs[j] (result, text->str, text->len, LINE_START, COMMENTS_EOL_LF);
+              expected = restore_breaks (result, eols[i], breaks);
+
+              actual = g_string_new (NULL);
+              funcs[j] (actual, converted->str, converted->len, LINE_START, eols[i]);
+
+              if (!g_string_equal (expected, actual))
+                {
+                  what = g_strdup_printf ("%s over %s text", names[j], 
+                                          eol_names[eols[i]]);
+                  same = compare_results ("eol", what, expected, actual);
+                  g_free (what);
+                }
+
+              bytes += actual->len;
+
+              g_ptr_array_free (breaks, TRUE);
+              g_string_free (text, TRUE);
+              g_string_free (converted, TRUE);
+              g_string_free (result, TRUE);
+              g_string_free (expected, TRUE);
+              g_string_free (actual, TRUE);
+            }
+
+          if (same)
+            g_printerr ("eol: %s over %s text, %" G_GSIZE_FORMAT 
+                        " bytes the same\n", names[j], eol_names[eols[i]], bytes);
+
+          passed &= same;
+        }
+    }
+
+  return passed;
+}
+
+static void
+transform_block (GString     *result,
+                 const gchar *text,
+                 gssize       length,
+                 const gchar *start,
+                 CommentsEol  eol)
+{
+  comments_transform_insert_block (result, text, length, "/*", "*/", eol);
+}
+
+/* every \n of the LF text becomes a break of the style, noted in breaks */
+static GString*
+convert_breaks (GRand       *rand,
+                GString     *text,
+                CommentsEol  eol,
+                GPtrArray   *breaks)
+{
+  GString *converted;
+  gsize i;
+
+  converted = g_string_sized_new (text->len * 2);
+
+  for (i = 0; i < text->len; i++)
+    {
+      if (text->str[i] == '\n')
+        {
+          const gchar *line_break = pick_break (rand, converted, eol);
+          g_ptr_array_add (breaks, (gpointer) line_break);
+          g_string_append (converted, line_break);
+        }
+      else
+        {
+          g_string_append_c (converted, text->str[i]);
+        }
+    }
+
+  return converted;
+}
+
+/*
+ * Puts the noted breaks back in place of the \n of an LF result, in order,
+ * and the style's own break in place of any the transform added.
+ */
+static GString*
+restore_breaks (GString     *text,
+                CommentsEol  eol,
+                GPtrArray   *breaks)
+{
+  GString *restored;
+  guint n_breaks = 0;
+  gsize i;
+
+  restored = g_string_sized_new (text->len * 2);
+
+  for (i = 0; i < text->len; i++)
+    {
+      if (text->str[i] != '\n')
+        g_string_append_c (restored, text->str[i]);
+      else if (n_breaks < breaks->len)
+        g_string_append (restored, g_ptr_array_index (breaks, n_breaks++));
+      else
+        g_string_append (restored, comments_transform_get_eol_string (eol));
+    }
+
+  return restored;
+}
+
+/*
+ * Any of the three for mixed text, except that a \n straight after a \r
+ * would make the two one break, so it becomes a \r\n there.
+ */
+static const gchar*
+pick_break (GRand       *rand,
+            GString     *text,
+            CommentsEol  eol)
+{
+  const gchar *breaks[] = { "\n", "\r\n", "\r" };
+  const gchar *line_break;
+
+  if (eol != COMMENTS_EOL_MIXED)
+    return comments_transform_get_eol_string (eol);
+
+  line_break = breaks[g_rand_int_range (rand, 0, G_N_ELEMENTS (breaks))];
+
+  if (*line_break == '\n' && text->len > 0 && text->str[text->len - 1] == '\r')
+    line_break = "\r\n";
+
+  return line_break;
+}
+
+static void
+transform_lines (GString       *result,
+                 const gchar   *text,
+                 gsize          length,
+                 LineTransform *transform)
+{
+  transform->func (result, text, length, LINE_START, transform->eol);
+}
+
+/*
+ * Lines picked from the ones above, each ended the way eol says, and the
+ * last left without a break every other time.
+ */
+static GString*
+create_text (GRand       *rand,
+             gsize        size,
+             CommentsEol  eol)
+{
+  GString *text;
+
+  text = g_string_sized_new (size + 256);
+
+  while (text->len < size)
+    {
+      g_string_append (text, lines[g_rand_int_range (rand, 0, G_N_ELEMENTS (lines))]);
+      g_string_append (text, pick_break (rand, text, eol));
+    }
+
+  if (g_rand_boolean (rand))
+    g_string_append (text, lines[0]);
+
+  return text;
+}
+
+static gboolean
+compare_results (const gchar *check,
+                 const gchar *what,
+                 GString     *expected,
+                 GString     *actual)
+{
+  gsize i;
+
+  for (i = 0; i < expected->len && i < actual->len; i++)
+    if (expected->str[i] != actual->str[i])
+      break;
+
+  if (i == expected->len && i == actual->len)
+    {
+      g_printerr ("%s: %s, %" G_GSIZE_FORMAT " bytes the same\n", check, what, i);
+      return TRUE;
+    }
+
+  g_printerr ("%s: %s differs at byte %" G_GSIZE_FORMAT " of %" G_GSIZE_FORMAT
+              " and %" G_GSIZE_FORMAT "\n", check, what, i, expected->len,
+              actual->len);
+  return FALSE;
+}
@@ -30,6 +30,21 @@ static void comments_config_set_property  (GObject             *object,
                                            const GValue        *value,
                                            GParamSpec          *pspec);
 
+static gboolean has_text                  (const gchar         *text);
+static gboolean has_file_type             (const gchar         *file_types,
+                                           const gchar         *file_path);
+static void start_element                 (GMarkupParseContext *context,
+                                           const gchar         *element_name,
+                                           const gchar        **attribute_names,
+                                           const gchar        **attribute_values,
+                                           gpointer             user_data,
+                                           GError             **error);
+static void append_attribute              (GString             *xml,
+                                           const gchar         *name,
+                                           const gchar         *value);
+
+#define COMMENT_ELEMENT "comment"
+
 #define COMMENTS_CONFIG_GET_PRIVATE(obj) \
   (G_TYPE_INSTANCE_GET_PRIVATE ((obj), COMMENTS_CONFIG_TYPE, CommentsConfigPrivate))
 
@@ -37,9 +52,13 @@ typedef struct _CommentsConfigPrivate CommentsConfigPrivate;
 
 struct _CommentsConfigPrivate
 {
-  gchar *file_types;
-  gchar *start;
-  gchar *end;
+  gchar    *file_types;
+  gchar    *start;
+  gchar    *end;
+  gchar    *alternate_start;
+  gchar    *alternate_end;
+  gboolean  indent;
+  gboolean  padding;
 };
 
 enum
@@ -47,7 +66,11 @@ enum
   PROP_0,
   PROP_FILE_TYPES,
   PROP_START,
-  PROP_END
+  PROP_END,
+  PROP_ALTERNATE_START,
+  PROP_ALTERNATE_END,
+  PROP_INDENT,
+  PROP_PADDING
 };
 
 G_DEFINE_TYPE (CommentsConfig, comments_config, G_TYPE_OBJECT)
@@ -87,6 +110,38 @@ comments_config_class_init (CommentsConfigClass *klass)
                                                         "End",
                                                         "",
                                                         G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, 
+                                   PROP_ALTERNATE_START,
+                                   g_param_spec_string ("alternate_start",
+                                                        "Alternate Start",
+                                                        "Alternate Start",
+                                                        "",
+                                                        G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, 
+                                   PROP_ALTERNATE_END,
+                                   g_param_spec_string ("alternate_end",
+                                                        "Alternate End",
+                                                        "Alternate End",
+                                                        "",
+                                                        G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, 
+                                   PROP_INDENT,
+                                   g_param_spec_boolean ("indent",
+                                                         "Indent",
+                                                         "Indent",
+                                                         FALSE,
+                                                         G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, 
+                                   PROP_PADDING,
+                                   g_param_spec_boolean ("padding",
+                                                         "Padding",
+                                                         "Padding",
+                                                         FALSE,
+                                                         G_PARAM_READWRITE));
 }
 
 static void
@@ -97,6 +152,10 @@ comments_config_init (CommentsConfig *config)
   priv->file_types = NULL;
   priv->start = NULL;
   priv->end = NULL;
+  priv->alternate_start = NULL;
+  priv->alternate_end = NULL;
+  priv->indent = FALSE;
+  priv->padding = FALSE;
 }
 
 static void
@@ -119,6 +178,16 @@ comments_config_finalize (CommentsConfig *config)
       g_free (priv->end);
       priv->end = NULL;
     }
+  if (priv->alternate_start)
+    {
+      g_free (priv->alternate_start);
+      priv->alternate_start = NULL;
+    }
+  if (priv->alternate_end)
+    {
+      g_free (priv->alternate_end);
+      priv->alternate_end = NULL;
+    }
   G_OBJECT_CLASS (comments_config_parent_class)->finalize (G_OBJECT (config));
 }
 
@@ -145,6 +214,18 @@ comments_config_get_property (GObject    *object,
     case PROP_END:
       g_value_set_string (value, priv->end);
       break;
+    case PROP_ALTERNATE_START:
+      g_value_set_string (value, priv->alternate_start);
+      break;
+    case PROP_ALTERNATE_END:
+      g_value_set_string (value, priv->alternate_end);
+      break;
+    case PROP_INDENT:
+      g_value_set_boolean (value, priv->indent);
+      break;
+    case PROP_PADDING:
+      g_value_set_boolean (value, priv->padding);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -171,6 +252,18 @@ comments_config_set_property (GObject      *object,
     case PROP_END:
       comments_config_set_end (config, g_value_get_string (value));
       break;
+    case PROP_ALTERNATE_START:
+      comments_config_set_alternate_start (config, g_value_get_string (value));
+      break;
+    case PROP_ALTERNATE_END:
+      comments_config_set_alternate_end (config, g_value_get_string (value));
+      break;
+    case PROP_INDENT:
+      comments_config_set_indent (config, g_value_get_boolean (value));
+      break;
+    case PROP_PADDING:
+      comments_config_set_padding (config, g_value_get_boolean (value));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -242,3 +335,302 @@ comments_config_set_end (CommentsConfig *config,
     }
   priv->end = g_strdup (end);
 }
+
+const gchar*
+comments_config_get_alternate_start (CommentsConfig *config)
+{
+  return COMMENTS_CONFIG_GET_PRIVATE (config)->alternate_start;
+}
+
+void
+comments_config_set_alternate_start (CommentsConfig *config,
+                                     const gchar    *alternate_start)
+{
+  CommentsConfigPrivate *priv;
+  priv = COMMENTS_CONFIG_GET_PRIVATE (config);
+  if (priv->alternate_start)
+    {
+      g_free (priv->alternate_start);
+      priv->alternate_start = NULL;
+    }
+  priv->alternate_start = g_strdup (alternate_start);
+}
+
+const gchar*
+comments_config_get_alternate_end (CommentsConfig *config)
+{
+  return COMMENTS_CONFIG_GET_PRIVATE (config)->alternate_end;
+}
+
+void
+comments_config_set_alternate_end (CommentsConfig *config,
+                                   const gchar    *alternate_end)
+{
+  CommentsConfigPrivate *priv;
+  priv = COMMENTS_CONFIG_GET_PRIVATE (config);
+  if (priv->alternate_end)
+    {
+      g_free (priv->alternate_end);
+      priv->alternate_end = NULL;
+    }
+  priv->alternate_end = g_strdup (alternate_end);
+}
+
+/*
+ * The start and end a config comments with are one style and the alternate
+ * ones can be the other, so a language with both line and block comments
+ * is described by one config. The style with an end is the block style.
+ */
+const gchar*
+comments_config_get_line_style (CommentsConfig *config)
+{
+  CommentsConfigPrivate *priv;
+  priv = COMMENTS_CONFIG_GET_PRIVATE (config);
+
+  if (has_text (priv->start) && !has_text (priv->end))
+    return priv->start;
+
+  if (has_text (priv->alternate_start) && !has_text (priv->alternate_end))
+    return priv->alternate_start;
+
+  return NULL;
+}
+
+gboolean
+comments_config_get_block_style (CommentsConfig  *config,
+                                 const gchar    **start,
+                                 const gchar    **end)
+{
+  CommentsConfigPrivate *priv;
+  priv = COMMENTS_CONFIG_GET_PRIVATE (config);
+
+  if (has_text (priv->start) && has_text (priv->end))
+    {
+      *start = priv->start;
+      *end = priv->end;
+      return TRUE;
+    }
+
+  if (has_text (priv->alternate_start) && has_text (priv->alternate_end))
+    {
+      *start = priv->alternate_start;
+      *end = priv->alternate_end;
+      return TRUE;
+    }
+
+  return FALSE;
+}
+
+gboolean
+comments_config_get_indent (CommentsConfig *config)
+{
+  return COMMENTS_CONFIG_GET_PRIVATE (config)->indent;
+}
+
+void
+comments_config_set_indent (CommentsConfig *config,
+                            gboolean        indent)
+{
+  CommentsConfigPrivate *priv;
+  priv = COMMENTS_CONFIG_GET_PRIVATE (config);
+  priv->indent = indent;
+}
+
+gboolean
+comments_config_get_padding (CommentsConfig *config)
+{
+  return COMMENTS_CONFIG_GET_PRIVATE (config)->padding;
+}
+
+void
+comments_config_set_padding (CommentsConfig *config,
+                             gboolean        padding)
+{
+  CommentsConfigPrivate *priv;
+  priv = COMMENTS_CONFIG_GET_PRIVATE (config);
+  priv->padding = padding;
+}
+
+/*
+ * The list is read and written in the format the editor's utilities used,
+ * one comment element per config with its properties as attributes, so
+ * that the command line tool can share it without linking the editor.
+ */
+GList*
+comments_config_load_list (const gchar *file_path)
+{
+  GMarkupParser parser = { start_element, NULL, NULL, NULL, NULL };
+  GMarkupParseContext *context;
+  GList *configs = NULL;
+  gchar *contents;
+  gsize length;
+
+  if (!g_file_get_contents (file_path, &contents, &length, NULL))
+    return NULL;
+
+  context = g_markup_parse_context_new (&parser, 0, &configs, NULL);
+  if (g_markup_parse_context_parse (context, contents, length, NULL))
+    g_markup_parse_context_end_parse (context, NULL);
+  g_markup_parse_context_free (context);
+  g_free (contents);
+
+  return g_list_reverse (configs);
+}
+
+static void
+start_element (GMarkupParseContext  *context,
+               const gchar          *element_name,
+               const gchar         **attribute_names,
+               const gchar         **attribute_values,
+               gpointer              user_data,
+               GError              **error)
+{
+  GList **configs = user_data;
+  CommentsConfig *config;
+  gint i;
+
+  if (g_strcmp0 (element_name, COMMENT_ELEMENT) != 0)
+    return;
+
+  config = comments_config_new ();
+
+  for (i = 0; attribute_names[i] != NULL; i++)
+    {
+      GParamSpec *pspec;
+
+      pspec = g_object_class_find_property (G_OBJECT_GET_CLASS (config), 
+                                            attribute_names[i]);
+      if (pspec == NULL)
+        continue;
+
+      if (G_PARAM_SPEC_VALUE_TYPE (pspec) == G_TYPE_BOOLEAN)
+        g_object_set (config, attribute_names[i], 
+                      g_ascii_strcasecmp (attribute_values[i], "true") == 0, NULL);
+      else
+        g_object_set (config, attribute_names[i], attribute_values[i], NULL);
+    }
+
+  *configs = g_list_prepend (*configs, config);
+}
+
+void
+comments_config_save_list (GList       *configs,
+                           const gchar *file_path)
+{
+  GString *xml;
+
+  xml = g_string_new ("<gobjects>");
+
+  while (configs != NULL)
+    {
+      CommentsConfig *config = configs->data;
+      CommentsConfigPrivate *priv;
+
+      priv = COMMENTS_CONFIG_GET_PRIVATE (config);
+
+      g_string_append (xml, "\n\t<" COMMENT_ELEMENT);
+      append_attribute (xml, "file_types", priv->file_types);
+      append_attribute (xml, "start", priv->start);
+      append_attribute (xml, "end", priv->end);
+      append_attribute (xml, "alternate_start", priv->alternate_start);
+      append_attribute (xml, "alternate_end", priv->alternate_end);
+      append_attribute (xml, "indent", priv->indent ? "true" : "false");
+      append_attribute (xml, "padding", priv->padding ? "true" : "false");
+      g_string_append (xml, "/>");
+
+      configs = g_list_next (configs);
+    }
+
+  g_string_append (xml, "\n</gobjects>\n");
+
+  g_file_set_contents (file_path, xml->str, xml->len, NULL);
+  g_string_free (xml, TRUE);
+}
+
+static void
+append_attribute (GString     *xml,
+                  const gchar *name,
+                  const gchar *value)
+{
+  gchar *attribute;
+
+  if (value == NULL)
+    return;
+
+  attribute = g_markup_printf_escaped (" %s=\"%s\"", name, value);
+  g_string_append (xml, attribute);
+  g_free (attribute);
+}
+
+GList*
+comments_config_copy_list (GList *configs)
+{
+  GList *results = NULL;
+
+  while (configs != NULL)
+    {
+      CommentsConfig *config = configs->data;
+      CommentsConfig *copy;
+      
+      copy = comments_config_new ();
+      comments_config_set_file_types (copy, comments_config_get_file_types (config));
+      comments_config_set_start (copy, comments_config_get_start (config));
+      comments_config_set_end (copy, comments_config_get_end (config));
+      comments_config_set_alternate_start (copy, comments_config_get_alternate_start (config));
+      comments_config_set_alternate_end (copy, comments_config_get_alternate_end (config));
+      comments_config_set_indent (copy, comments_config_get_indent (config));
+      comments_config_set_padding (copy, comments_config_get_padding (config));
+      results = g_list_prepend (results, copy);
+      
+      configs = g_list_next (configs);
+    }
+    
+  return g_list_reverse (results);    
+}
+
+CommentsConfig*
+comments_config_find_for_path (GList       *configs,
+                               const gchar *file_path)
+{
+  while (configs != NULL)
+    {
+      CommentsConfig *config = configs->data;
+      if (has_file_type (comments_config_get_file_types (config), file_path))
+        return config;
+
+      configs = g_list_next (configs);
+    }
+
+  return NULL;
+}
+
+static gboolean
+has_text (const gchar *text)
+{
+  return text != NULL && *text != '\0';
+}
+
+/* the file types are a comma separated list of suffixes */
+static gboolean
+has_file_type (const gchar *file_types,
+               const gchar *file_path)
+{
+  gchar **suffixes;
+  gboolean found = FALSE;
+  gint i;
+
+  if (!has_text (file_types))
+    return FALSE;
+
+  suffixes = g_strsplit (file_types, ",", -1);
+
+  for (i = 0; suffixes[i] != NULL && !found; i++)
+    {
+      gchar *suffix = g_strstrip (suffixes[i]);
+      found = *suffix != '\0' && g_str_has_suffix (file_path, suffix);
+    }
+
+  g_strfreev (suffixes);
+
+  return found;
+}
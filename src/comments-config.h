@@ -19,7 +19,7 @@
 #ifndef __COMMENTS_CONFIG_H__
 #define	__COMMENTS_CONFIG_H__
 
-#include <gtk/gtk.h>
+#include <glib-object.h>
 
 G_BEGIN_DECLS
 
@@ -44,17 +44,40 @@ struct _CommentsConfigClass
 
 GType comments_config_get_type (void) G_GNUC_CONST;
 
-CommentsConfig*  comments_config_new             (void);
-
-const gchar*     comments_config_get_file_types  (CommentsConfig *config);
-void             comments_config_set_file_types  (CommentsConfig *config,
-                                                  const gchar    *file_types);
-const gchar*     comments_config_get_start       (CommentsConfig *config);
-void             comments_config_set_start       (CommentsConfig *config,
-                                                  const gchar    *start);
-const gchar*     comments_config_get_end         (CommentsConfig *config);
-void             comments_config_set_end         (CommentsConfig *config,
-                                                  const gchar    *end);
+CommentsConfig*  comments_config_new                  (void);
+
+const gchar*     comments_config_get_file_types       (CommentsConfig *config);
+void             comments_config_set_file_types       (CommentsConfig *config,
+                                                       const gchar    *file_types);
+const gchar*     comments_config_get_start            (CommentsConfig *config);
+void             comments_config_set_start            (CommentsConfig *config,
+                                                       const gchar    *start);
+const gchar*     comments_config_get_end              (CommentsConfig *config);
+void             comments_config_set_end              (CommentsConfig *config,
+                                                       const gchar    *end);
+const gchar*     comments_config_get_alternate_start  (CommentsConfig *config);
+void             comments_config_set_alternate_start  (CommentsConfig *config,
+                                                       const gchar    *alternate_start);
+const gchar*     comments_config_get_alternate_end    (CommentsConfig *config);
+void             comments_config_set_alternate_end    (CommentsConfig *config,
+                                                       const gchar    *alternate_end);
+const gchar*     comments_config_get_line_style       (CommentsConfig *config);
+gboolean         comments_config_get_block_style      (CommentsConfig  *config,
+                                                       const gchar    **start,
+                                                       const gchar    **end);
+gboolean         comments_config_get_indent           (CommentsConfig *config);
+void             comments_config_set_indent           (CommentsConfig *config,
+                                                       gboolean        indent);
+gboolean         comments_config_get_padding          (CommentsConfig *config);
+void             comments_config_set_padding          (CommentsConfig *config,
+                                                       gboolean        padding);
+
+GList*           comments_config_load_list            (const gchar    *file_path);
+void             comments_config_save_list            (GList          *configs,
+                                                       const gchar    *file_path);
+GList*           comments_config_copy_list            (GList          *configs);
+CommentsConfig*  comments_config_find_for_path        (GList          *configs,
+                                                       const gchar    *file_path);
 
 G_END_DECLS
 
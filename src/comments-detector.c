@@ -0,0 +1,770 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <string.h>
+#include <glib/gstdio.h>
+#include "comments-detector.h"
+#include "comments-walker.h"
+#include "comments-simd.h"
+
+/*
+ * Finds commented-out code: runs of comment lines, written with the
+ * delimiters of the file's config, whose text reads like code rather than
+ * prose. A line reads like code when it ends the way a statement or block
+ * does, opens with one of the language's keywords in a way prose would
+ * not, or is an assignment or a call. A run is reported when at least half
+ * of its lines read like code and its brackets balance, or three quarters
+ * when they do not, as a run can well hold only part of a block.
+ *
+ * What was found in each file is kept in an index along with the file's
+ * modification time and size and the delimiters it was scanned with, so
+ * another scan of the same tree only reads the files that changed.
+ */
+
+#define PREVIEW_LENGTH 80
+
+typedef struct _Rule Rule;
+typedef struct _Scan Scan;
+typedef struct _Entry Entry;
+typedef struct _Job Job;
+typedef struct _Language Language;
+typedef struct _Run Run;
+
+struct _CommentsDetector
+{
+  GHashTable *index;
+};
+
+struct _Rule
+{
+  gchar *start;
+  gchar *end;
+};
+
+/* the index being built while the tree is walked, next to the old one */
+struct _Scan
+{
+  CommentsDetector *detector;
+  GHashTable       *index;
+};
+
+struct _Entry
+{
+  gchar     *path;
+  gint64     mtime;
+  gint64     size;
+  gchar     *start;
+  gchar     *end;
+  GPtrArray *detections;
+};
+
+struct _Job
+{
+  gchar *file_path;
+  Entry *entry;
+};
+
+/* 
+ * Keywords only count with a bracket on the line or a colon at its end;
+ * statements count on their own.
+ */
+struct _Language
+{
+  const gchar        *suffixes;
+  const gchar * const *keywords;
+  const gchar * const *statements;
+};
+
+struct _Run
+{
+  guint     first_line;
+  guint     last_line;
+  guint     lines;
+  guint     code_lines;
+  gint      depth;
+  gboolean  unbalanced;
+  gchar    *preview;
+};
+
+static const gchar * const c_keywords[] = 
+{
+  "if", "else", "for", "while", "do", "switch", "case", "return", "break", 
+  "continue", "goto", "sizeof", "int", "char", "void", "long", "static", 
+  "struct", "const", "unsigned", "typedef", NULL
+};
+
+static const gchar * const c_statements[] = 
+{
+  "#include", "#define", "#undef", "#if", "#ifdef", "#ifndef", "#else", 
+  "#endif", NULL
+};
+
+static const gchar * const java_keywords[] = 
+{
+  "if", "else", "for", "while", "do", "switch", "case", "return", "break", 
+  "continue", "new", "try", "catch", "finally", "throw", "public", 
+  "private", "protected", "static", "final", "class", "interface", "void", 
+  "int", "boolean", NULL
+};
+
+static const gchar * const script_keywords[] = 
+{
+  "if", "else", "for", "while", "do", "switch", "case", "return", "break", 
+  "continue", "new", "try", "catch", "throw", "var", "let", "const", 
+  "function", "class", "async", "await", "echo", NULL
+};
+
+static const gchar * const python_keywords[] = 
+{
+  "if", "elif", "else", "for", "while", "def", "class", "return", "try", 
+  "except", "finally", "with", "lambda", "yield", "raise", "print", NULL
+};
+
+static const gchar * const python_statements[] = 
+{
+  "import", "from", "return", "pass", "raise", "break", "continue", NULL
+};
+
+static const gchar * const shell_keywords[] = 
+{
+  "if", "then", "elif", "else", "for", "while", "do", "case", "function", 
+  "local", "export", "return", NULL
+};
+
+static const gchar * const shell_statements[] = 
+{
+  "fi", "done", "esac", "export", "echo", NULL
+};
+
+static const gchar * const generic_keywords[] = 
+{
+  "if", "else", "for", "while", "return", NULL
+};
+
+static const Language languages[] =
+{
+  { ".c,.h,.cc,.cpp,.cxx,.hh,.hpp,.m", c_keywords, c_statements },
+  { ".java,.cs,.scala,.kt,.groovy", java_keywords, NULL },
+  { ".js,.jsx,.ts,.tsx,.mjs,.php", script_keywords, NULL },
+  { ".py", python_keywords, python_statements },
+  { ".sh,.bash,.zsh", shell_keywords, shell_statements }
+};
+
+static Rule*        rule_new           (CommentsConfig     *config);
+static void         rule_free          (Rule               *rule);
+static Job*         job_new            (const gchar        *file_path,
+                                        const gchar        *path,
+                                        Rule               *rule,
+                                        Scan               *scan);
+static Entry*       reuse_entry        (CommentsDetector   *detector,
+                                        const gchar        *file_path,
+                                        GStatBuf           *buf,
+                                        Rule               *rule);
+static void         entry_free         (Entry              *entry);
+static void         scan_job           (Job                *job,
+                                        gpointer            user_data);
+static const Language* find_language   (const gchar        *file_name);
+static gboolean     has_suffix         (const gchar        *file_name,
+                                        const gchar        *suffixes);
+static void         add_line           (Run                *run,
+                                        const gchar        *text,
+                                        const gchar        *end,
+                                        const Language     *language);
+static gchar*       make_preview       (const gchar        *text,
+                                        gsize               length);
+static void         finish_run         (Run                *run,
+                                        GPtrArray          *detections);
+static gboolean     looks_like_code    (const gchar        *text,
+                                        gsize               length,
+                                        const Language     *language);
+static gboolean     match_word         (const gchar        *word,
+                                        gsize               length,
+                                        const gchar * const *words);
+static gboolean     is_word_char       (gchar               c);
+static gint         compare_detection  (CommentsDetection **a,
+                                        CommentsDetection **b);
+
+CommentsDetector*
+comments_detector_new (void)
+{
+  CommentsDetector *detector;
+
+  detector = g_new0 (CommentsDetector, 1);
+  detector->index = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                           (GDestroyNotify) entry_free);
+
+  return detector;
+}
+
+void
+comments_detector_free (CommentsDetector *detector)
+{
+  g_hash_table_destroy (detector->index);
+  g_free (detector);
+}
+
+/*
+ * Find the commented-out code in every file under the folder that one of
+ * the configs knows about. Files that changed since the last scan are read
+ * through mmap on a thread pool, one job per file; the rest are answered
+ * from the index. Files that are gone drop out of the index. The result is
+ * sorted by path and line.
+ */
+GPtrArray*
+comments_detector_scan (CommentsDetector *detector,
+                        const gchar      *folder_path,
+                        GList            *configs)
+{
+  GPtrArray *jobs;
+  GPtrArray *results;
+  GHashTable *index;
+  GHashTableIter iter;
+  Entry *entry;
+  Scan scan;
+  guint i;
+
+  index = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                 (GDestroyNotify) entry_free);
+
+  scan.detector = detector;
+  scan.index = index;
+
+  jobs = comments_walker_run (folder_path, configs, 
+                              (CommentsRuleFunc) rule_new, 
+                              (GDestroyNotify) rule_free, 
+                              (CommentsFileFunc) job_new, 
+                              (GFunc) scan_job, &scan);
+
+  g_hash_table_destroy (detector->index);
+  detector->index = index;
+
+  results = g_ptr_array_new_with_free_func ((GDestroyNotify) comments_detection_free);
+
+  g_hash_table_iter_init (&iter, index);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entry))
+    {
+      for (i = 0; i < entry->detections->len; i++)
+        {
+          CommentsDetection *detection = g_ptr_array_index (entry->detections, i);
+          CommentsDetection *copy;
+
+          copy = g_new0 (CommentsDetection, 1);
+          copy->file_path = g_build_filename (folder_path, entry->path, NULL);
+          copy->path = g_strdup (entry->path);
+          copy->first_line = detection->first_line;
+          copy->last_line = detection->last_line;
+          copy->code_lines = detection->code_lines;
+          copy->preview = g_strdup (detection->preview);
+          g_ptr_array_add (results, copy);
+        }
+    }
+
+  for (i = 0; i < jobs->len; i++)
+    {
+      Job *job = g_ptr_array_index (jobs, i);
+      g_free (job->file_path);
+      g_free (job);
+    }
+
+  g_ptr_array_free (jobs, TRUE);
+
+  g_ptr_array_sort (results, (GCompareFunc) compare_detection);
+
+  return results;
+}
+
+/*
+ * Only comments that open a line are looked at; one that follows code on
+ * the same line is a remark about that code. In a run the lines of a block
+ * comment lose the leading * that often lines them up.
+ */
+void
+comments_detector_find (const gchar *text,
+                        gsize        length,
+                        const gchar *start,
+                        const gchar *end,
+                        const gchar *file_name,
+                        GPtrArray   *detections)
+{
+  const Language *language;
+  const gchar *pos = text;
+  const gchar *limit = text + length;
+  gsize start_length;
+  gsize end_length;
+  gboolean block;
+  gboolean in_block = FALSE;
+  gboolean in_run = FALSE;
+  guint line = 0;
+  Run run;
+
+  language = find_language (file_name);
+
+  start_length = start != NULL ? strlen (start) : 0;
+  end_length = end != NULL ? strlen (end) : 0;
+  block = start_length > 0 && end_length > 0;
+
+  if (start_length == 0)
+    return;
+
+  while (pos < limit)
+    {
+      const gchar *eol;
+      const gchar *next;
+      const gchar *content = NULL;
+      const gchar *content_end = NULL;
+
+      eol = comments_simd_find_newline (pos, limit);
+      next = eol < limit ? eol + 1 : limit;
+      if (eol + 1 < limit && eol[0] == '\r' && eol[1] == '\n')
+        next++;
+
+      while (pos < eol && (*pos == ' ' || *pos == '\t'))
+        pos++;
+
+      if (in_block)
+        {
+          content = pos;
+          content_end = comments_simd_find_delimiter (pos, eol, end, end_length);
+          in_block = content_end == eol;
+
+          if (content < content_end && *content == '*')
+            content++;
+        }
+      else if ((gsize) (eol - pos) >= start_length &&
+               memcmp (pos, start, start_length) == 0)
+        {
+          content = pos + start_length;
+          content_end = eol;
+
+          if (block)
+            {
+              content_end = comments_simd_find_delimiter (content, eol, end, 
+                                                          end_length);
+              in_block = content_end == eol;
+            }
+        }
+
+      if (content != NULL)
+        {
+          if (!in_run)
+            {
+              memset (&run, 0, sizeof (Run));
+              run.first_line = line;
+              in_run = TRUE;
+            }
+
+          add_line (&run, content, content_end, language);
+          run.last_line = line;
+        }
+      else if (in_run)
+        {
+          finish_run (&run, detections);
+          in_run = FALSE;
+        }
+
+      line++;
+      pos = next;
+    }
+
+  if (in_run)
+    finish_run (&run, detections);
+}
+
+void
+comments_detection_free (CommentsDetection *detection)
+{
+  g_free (detection->file_path);
+  g_free (detection->path);
+  g_free (detection->preview);
+  g_free (detection);
+}
+
+/* a config without a start delimiter has nothing to look in */
+static Rule*
+rule_new (CommentsConfig *config)
+{
+  Rule *rule;
+
+  if (comments_config_get_start (config) == NULL ||
+      *comments_config_get_start (config) == '\0')
+    return NULL;
+
+  rule = g_new0 (Rule, 1);
+  rule->start = g_strdup (comments_config_get_start (config));
+  rule->end = g_strdup (comments_config_get_end (config));
+
+  return rule;
+}
+
+static void
+rule_free (Rule *rule)
+{
+  g_free (rule->start);
+  g_free (rule->end);
+  g_free (rule);
+}
+
+/*
+ * Every file goes in the new index; only one that changed since the last
+ * scan, or is looked at with other delimiters, gets a job to read it.
+ */
+static Job*
+job_new (const gchar *file_path,
+         const gchar *path,
+         Rule        *rule,
+         Scan        *scan)
+{
+  GStatBuf buf;
+  Entry *entry;
+  Job *job = NULL;
+
+  if (g_stat (file_path, &buf) != 0)
+    return NULL;
+
+  entry = reuse_entry (scan->detector, file_path, &buf, rule);
+
+  if (entry == NULL)
+    {
+      entry = g_new0 (Entry, 1);
+      entry->mtime = buf.st_mtime;
+      entry->size = buf.st_size;
+      entry->start = g_strdup (rule->start);
+      entry->end = g_strdup (rule->end);
+      entry->detections = g_ptr_array_new_with_free_func ((GDestroyNotify) comments_detection_free);
+
+      job = g_new0 (Job, 1);
+      job->file_path = g_strdup (file_path);
+      job->entry = entry;
+    }
+
+  g_free (entry->path);
+  entry->path = g_strdup (path);
+  g_hash_table_insert (scan->index, g_strdup (file_path), entry);
+
+  return job;
+}
+
+/*
+ * Take the file's entry out of the old index when the file has not
+ * changed since and is still scanned with the same delimiters.
+ */
+static Entry*
+reuse_entry (CommentsDetector *detector,
+             const gchar      *file_path,
+             GStatBuf         *buf,
+             Rule             *rule)
+{
+  gpointer key;
+  Entry *entry;
+
+  if (!g_hash_table_lookup_extended (detector->index, file_path, &key, 
+                                     (gpointer *) &entry))
+    return NULL;
+
+  if (entry->mtime != (gint64) buf->st_mtime ||
+      entry->size != (gint64) buf->st_size ||
+      g_strcmp0 (entry->start, rule->start) != 0 ||
+      g_strcmp0 (entry->end, rule->end) != 0)
+    return NULL;
+
+  g_hash_table_steal (detector->index, file_path);
+  g_free (key);
+
+  return entry;
+}
+
+static void
+entry_free (Entry *entry)
+{
+  g_free (entry->path);
+  g_free (entry->start);
+  g_free (entry->end);
+  g_ptr_array_unref (entry->detections);
+  g_free (entry);
+}
+
+static void
+scan_job (Job      *job,
+          gpointer  user_data)
+{
+  GMappedFile *mapped_file;
+  const gchar *contents;
+  gsize length;
+
+  mapped_file = g_mapped_file_new (job->file_path, FALSE, NULL);
+  if (mapped_file == NULL)
+    return;
+
+  contents = g_mapped_file_get_contents (mapped_file);
+  length = g_mapped_file_get_length (mapped_file);
+
+  if (contents != NULL && length > 0)
+    comments_detector_find (contents, length, job->entry->start, 
+                            job->entry->end, job->file_path, 
+                            job->entry->detections);
+
+  g_mapped_file_unref (mapped_file);
+}
+
+static const Language*
+find_language (const gchar *file_name)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (languages); i++)
+    if (has_suffix (file_name, languages[i].suffixes))
+      return &languages[i];
+
+  return NULL;
+}
+
+static gboolean
+has_suffix (const gchar *file_name,
+            const gchar *suffixes)
+{
+  gsize name_length;
+
+  name_length = strlen (file_name);
+
+  while (*suffixes != '\0')
+    {
+      const gchar *comma;
+      gsize length;
+
+      comma = strchr (suffixes, ',');
+      length = comma != NULL ? (gsize) (comma - suffixes) : strlen (suffixes);
+
+      if (length <= name_length && 
+          strncmp (file_name + name_length - length, suffixes, length) == 0)
+        return TRUE;
+
+      if (comma == NULL)
+        break;
+
+      suffixes = comma + 1;
+    }
+
+  return FALSE;
+}
+
+/*
+ * Brackets inside double quotes are not counted, so a string holding one
+ * does not throw the balance off.
+ */
+static void
+add_line (Run            *run,
+          const gchar    *text,
+          const gchar    *end,
+          const Language *language)
+{
+  const gchar *pos;
+  gboolean quoted = FALSE;
+
+  while (text < end && g_ascii_isspace (*text))
+    text++;
+  while (end > text && g_ascii_isspace (end[-1]))
+    end--;
+
+  if (text == end)
+    return;
+
+  run->lines++;
+
+  for (pos = text; pos < end; pos++)
+    {
+      if (*pos == '"' && (pos == text || pos[-1] != '\\'))
+        quoted = !quoted;
+      else if (quoted)
+        continue;
+      else if (*pos == '(' || *pos == '[' || *pos == '{')
+        run->depth++;
+      else if (*pos == ')' || *pos == ']' || *pos == '}')
+        {
+          run->depth--;
+          if (run->depth < 0)
+            {
+              run->unbalanced = TRUE;
+              run->depth = 0;
+            }
+        }
+    }
+
+  if (looks_like_code (text, end - text, language))
+    {
+      run->code_lines++;
+      if (run->preview == NULL)
+        run->preview = make_preview (text, end - text);
+    }
+}
+
+/*
+ * The preview is cut back to a whole character, and a file that is not
+ * UTF-8 has each byte that is not valid replaced with U+FFFD, so it can
+ * be shown as is.
+ */
+static gchar*
+make_preview (const gchar *text,
+              gsize        length)
+{
+  GString *preview;
+  const gchar *valid_end;
+  const gchar *end;
+
+  if (length > PREVIEW_LENGTH)
+    {
+      const gchar *cut;
+
+      cut = g_utf8_find_prev_char (text, text + PREVIEW_LENGTH + 1);
+      length = cut != NULL ? (gsize) (cut - text) : PREVIEW_LENGTH;
+    }
+
+  preview = g_string_sized_new (length);
+  end = text + length;
+
+  while (!g_utf8_validate (text, end - text, &valid_end))
+    {
+      g_string_append_len (preview, text, valid_end - text);
+      g_string_append (preview, "\357\277\275");
+      text = valid_end + 1;
+    }
+
+  g_string_append_len (preview, text, end - text);
+
+  return g_string_free (preview, FALSE);
+}
+
+static void
+finish_run (Run       *run,
+            GPtrArray *detections)
+{
+  CommentsDetection *detection;
+  gboolean balanced;
+  gboolean found;
+
+  balanced = !run->unbalanced && run->depth == 0;
+
+  if (balanced)
+    found = run->code_lines > 0 && run->code_lines * 2 >= run->lines;
+  else
+    found = run->code_lines > 0 && run->code_lines * 4 >= run->lines * 3;
+
+  if (!found)
+    {
+      g_free (run->preview);
+      return;
+    }
+
+  detection = g_new0 (CommentsDetection, 1);
+  detection->first_line = run->first_line + 1;
+  detection->last_line = run->last_line + 1;
+  detection->code_lines = run->code_lines;
+  detection->preview = run->preview;
+  g_ptr_array_add (detections, detection);
+}
+
+static gboolean
+looks_like_code (const gchar    *text,
+                 gsize           length,
+                 const Language *language)
+{
+  const gchar *end = text + length;
+  const gchar *pos;
+  gchar last;
+  gsize word;
+
+  last = end[-1];
+  if (last == ';' || last == '{' || last == '}')
+    return TRUE;
+
+  for (word = 0; word < length && is_word_char (text[word]); word++);
+
+  if (word == 0)
+    return FALSE;
+
+  if (language != NULL && 
+      (word == length || text[word] == ' ' || text[word] == '('))
+    {
+      if (match_word (text, word, language->statements))
+        return TRUE;
+
+      if (match_word (text, word, language->keywords) &&
+          (memchr (text, '(', length) != NULL || 
+           memchr (text, '[', length) != NULL || last == ':'))
+        return TRUE;
+    }
+  else if (language == NULL && match_word (text, word, generic_keywords) &&
+           memchr (text, '(', length) != NULL)
+    {
+      return TRUE;
+    }
+
+  if (g_ascii_isdigit (text[0]))
+    return FALSE;
+
+  /* a call, with the bracket right after the name */
+  pos = text + word;
+  while (pos < end && (*pos == '.' || is_word_char (*pos)))
+    pos++;
+
+  if (pos < end && *pos == '(' && last == ')')
+    return TRUE;
+
+  /* or an assignment */
+  while (pos < end && *pos == ' ')
+    pos++;
+
+  if (pos < end && strchr ("+-*/|&", *pos) != NULL)
+    pos++;
+
+  return pos + 1 < end && pos[0] == '=' && pos[1] != '=';
+}
+
+static gboolean
+match_word (const gchar         *word,
+            gsize                length,
+            const gchar * const *words)
+{
+  if (words == NULL)
+    return FALSE;
+
+  for (; *words != NULL; words++)
+    if (strlen (*words) == length && strncmp (word, *words, length) == 0)
+      return TRUE;
+
+  return FALSE;
+}
+
+static gboolean
+is_word_char (gchar c)
+{
+  return g_ascii_isalnum (c) || c == '_' || c == '$' || c == '#';
+}
+
+static gint
+compare_detection (CommentsDetection **a,
+                   CommentsDetection **b)
+{
+  gint result;
+
+  result = g_strcmp0 ((*a)->path, (*b)->path);
+  if (result != 0)
+    return result;
+
+  return (*a)->first_line < (*b)->first_line ? -1 : 
+         (*a)->first_line > (*b)->first_line;
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __COMMENTS_DETECTOR_H__
+#define	__COMMENTS_DETECTOR_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _CommentsDetector CommentsDetector;
+typedef struct _CommentsDetection CommentsDetection;
+
+struct _CommentsDetection
+{
+  gchar *file_path;
+  gchar *path;
+  guint  first_line;
+  guint  last_line;
+  guint  code_lines;
+  gchar *preview;
+};
+
+CommentsDetector*  comments_detector_new    (void);
+
+GPtrArray*         comments_detector_scan   (CommentsDetector  *detector,
+                                             const gchar       *folder_path,
+                                             GList             *configs);
+
+void               comments_detector_find   (const gchar       *text,
+                                             gsize              length,
+                                             const gchar       *start,
+                                             const gchar       *end,
+                                             const gchar       *file_name,
+                                             GPtrArray         *detections);
+
+void               comments_detector_free   (CommentsDetector  *detector);
+
+void               comments_detection_free  (CommentsDetection *detection);
+
+G_END_DECLS
+
+#endif /* __COMMENTS_DETECTOR_H__ */
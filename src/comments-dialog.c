@@ -40,6 +40,13 @@ static void start_entry_action          (CommentsDialog       *dialog,
                                          GParamSpec           *spec);
 static void end_entry_action            (CommentsDialog       *dialog,
                                          GParamSpec           *spec);
+static void alternate_start_entry_action (CommentsDialog      *dialog,
+                                          GParamSpec          *spec);
+static void alternate_end_entry_action  (CommentsDialog       *dialog,
+                                         GParamSpec           *spec);
+static void indent_button_action        (CommentsDialog       *dialog);
+static void padding_button_action       (CommentsDialog       *dialog);
+static CommentsConfig* get_selected_config (CommentsDialog    *dialog);
 static gint sort_compare                (GtkTreeModel         *model, 
                                          GtkTreeIter          *a,
                                          GtkTreeIter          *b, 
@@ -58,8 +65,16 @@ struct _CommentsDialogPrivate
   GList        **configs;
   GtkWidget    *start_entry;
   GtkWidget    *end_entry;
+  GtkWidget    *alternate_start_entry;
+  GtkWidget    *alternate_end_entry;
+  GtkWidget    *indent_button;
+  GtkWidget    *padding_button;
   gulong        start_entry_id;
   gulong        end_entry_id;
+  gulong        alternate_start_entry_id;
+  gulong        alternate_end_entry_id;
+  gulong        indent_button_id;
+  gulong        padding_button_id;
 };
 
 enum
@@ -240,6 +255,12 @@ add_syntax_pane (CommentsDialog *dialog,
   GtkWidget *start_entry;
   GtkWidget *end_label;
   GtkWidget *end_entry;
+  GtkWidget *alternate_start_label;
+  GtkWidget *alternate_start_entry;
+  GtkWidget *alternate_end_label;
+  GtkWidget *alternate_end_entry;
+  GtkWidget *indent_button;
+  GtkWidget *padding_button;
 
   priv = COMMENTS_DIALOG_GET_PRIVATE (dialog);
 
@@ -274,6 +295,38 @@ add_syntax_pane (CommentsDialog *dialog,
   gtk_grid_attach_next_to (GTK_GRID (grid), end_entry, end_label, 
                            GTK_POS_RIGHT, 1, 1);
   
+  /* the alternate style, for converting between line and block comments */  
+  
+  alternate_start_label = gtk_label_new ("Alternate Start");
+  alternate_start_entry =  gtk_entry_new ();
+  priv->alternate_start_entry = alternate_start_entry;
+
+  gtk_misc_set_alignment (GTK_MISC (alternate_start_label), 1, .5);
+  gtk_misc_set_padding (GTK_MISC (alternate_start_label), 4, 0);
+  gtk_grid_attach (GTK_GRID (grid), alternate_start_label, 0, 2, 1, 1);
+  gtk_grid_attach_next_to (GTK_GRID (grid), alternate_start_entry, alternate_start_label, 
+                           GTK_POS_RIGHT, 1, 1);
+  
+  alternate_end_label = gtk_label_new ("Alternate End");
+  alternate_end_entry =  gtk_entry_new ();
+  priv->alternate_end_entry = alternate_end_entry;
+
+  gtk_misc_set_alignment (GTK_MISC (alternate_end_label), 1, .5);
+  gtk_misc_set_padding (GTK_MISC (alternate_end_label), 4, 0);
+  gtk_grid_attach (GTK_GRID (grid), alternate_end_label, 0, 3, 1, 1);
+  gtk_grid_attach_next_to (GTK_GRID (grid), alternate_end_entry, alternate_end_label, 
+                           GTK_POS_RIGHT, 1, 1);
+  
+  /* the line comment options */  
+  
+  indent_button = gtk_check_button_new_with_label ("Comment at the indentation");
+  priv->indent_button = indent_button;
+  gtk_grid_attach (GTK_GRID (grid), indent_button, 1, 4, 1, 1);
+
+  padding_button = gtk_check_button_new_with_label ("Space after the start");
+  priv->padding_button = padding_button;
+  gtk_grid_attach (GTK_GRID (grid), padding_button, 1, 5, 1, 1);
+  
   gtk_box_pack_start (GTK_BOX (vbox), label, FALSE, FALSE, 0);
   gtk_box_pack_start (GTK_BOX (vbox), grid, FALSE, FALSE, 0);
   
@@ -284,6 +337,18 @@ add_syntax_pane (CommentsDialog *dialog,
 
   priv->end_entry_id = g_signal_connect_swapped (G_OBJECT (end_entry), "notify::text",
                                                  G_CALLBACK (end_entry_action), dialog);
+
+  priv->alternate_start_entry_id = g_signal_connect_swapped (G_OBJECT (alternate_start_entry), "notify::text",
+                                                             G_CALLBACK (alternate_start_entry_action), dialog);
+
+  priv->alternate_end_entry_id = g_signal_connect_swapped (G_OBJECT (alternate_end_entry), "notify::text",
+                                                           G_CALLBACK (alternate_end_entry_action), dialog);
+
+  priv->indent_button_id = g_signal_connect_swapped (G_OBJECT (indent_button), "toggled",
+                                                     G_CALLBACK (indent_button_action), dialog);
+
+  priv->padding_button_id = g_signal_connect_swapped (G_OBJECT (padding_button), "toggled",
+                                                      G_CALLBACK (padding_button_action), dialog);
 }
 
 static void
@@ -297,6 +362,10 @@ load_configs (CommentsDialog *dialog)
 
   g_signal_handler_block (priv->start_entry, priv->start_entry_id);
   g_signal_handler_block (priv->end_entry, priv->end_entry_id);
+  g_signal_handler_block (priv->alternate_start_entry, priv->alternate_start_entry_id);
+  g_signal_handler_block (priv->alternate_end_entry, priv->alternate_end_entry_id);
+  g_signal_handler_block (priv->indent_button, priv->indent_button_id);
+  g_signal_handler_block (priv->padding_button, priv->padding_button_id);
 
   list = *priv->configs;
   while (list != NULL)
@@ -317,6 +386,10 @@ load_configs (CommentsDialog *dialog)
 
   g_signal_handler_unblock (priv->start_entry, priv->start_entry_id);
   g_signal_handler_unblock (priv->end_entry, priv->end_entry_id);
+  g_signal_handler_unblock (priv->alternate_start_entry, priv->alternate_start_entry_id);
+  g_signal_handler_unblock (priv->alternate_end_entry, priv->alternate_end_entry_id);
+  g_signal_handler_unblock (priv->indent_button, priv->indent_button_id);
+  g_signal_handler_unblock (priv->padding_button, priv->padding_button_id);
 }
 
 static void
@@ -404,6 +477,8 @@ tree_edited_action (CommentsDialog *dialog,
           config = comments_config_new ();
           comments_config_set_start (config, "");
           comments_config_set_end (config, "");
+          comments_config_set_alternate_start (config, "");
+          comments_config_set_alternate_end (config, "");
 
           comments_config_set_file_types (config, file_types);
           
@@ -428,6 +503,10 @@ select_row_action (GtkTreeSelection *selection,
   
   g_signal_handler_block (priv->start_entry, priv->start_entry_id);
   g_signal_handler_block (priv->end_entry, priv->end_entry_id);
+  g_signal_handler_block (priv->alternate_start_entry, priv->alternate_start_entry_id);
+  g_signal_handler_block (priv->alternate_end_entry, priv->alternate_end_entry_id);
+  g_signal_handler_block (priv->indent_button, priv->indent_button_id);
+  g_signal_handler_block (priv->padding_button, priv->padding_button_id);
 
   if (gtk_tree_selection_get_selected (selection, &model, &iter))
     {
@@ -440,9 +519,13 @@ select_row_action (GtkTreeSelection *selection,
         {
           const gchar *start;             
           const gchar *end;             
+          const gchar *alternate_start;             
+          const gchar *alternate_end;             
 
           start = comments_config_get_start (config);
           end = comments_config_get_end (config);
+          alternate_start = comments_config_get_alternate_start (config);
+          alternate_end = comments_config_get_alternate_end (config);
                         
           if (codeslayer_utils_has_text (start))              
             gtk_entry_set_text (GTK_ENTRY (priv->start_entry), start);
@@ -453,16 +536,39 @@ select_row_action (GtkTreeSelection *selection,
             gtk_entry_set_text (GTK_ENTRY (priv->end_entry), end);
           else
             gtk_entry_set_text (GTK_ENTRY (priv->end_entry), "");
+
+          if (codeslayer_utils_has_text (alternate_start))              
+            gtk_entry_set_text (GTK_ENTRY (priv->alternate_start_entry), alternate_start);
+          else
+            gtk_entry_set_text (GTK_ENTRY (priv->alternate_start_entry), "");
+
+          if (codeslayer_utils_has_text (alternate_end))              
+            gtk_entry_set_text (GTK_ENTRY (priv->alternate_end_entry), alternate_end);
+          else
+            gtk_entry_set_text (GTK_ENTRY (priv->alternate_end_entry), "");
+
+          gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (priv->indent_button), 
+                                        comments_config_get_indent (config));
+          gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (priv->padding_button), 
+                                        comments_config_get_padding (config));
         }
       else
         {
           gtk_entry_set_text (GTK_ENTRY (priv->start_entry), "");
           gtk_entry_set_text (GTK_ENTRY (priv->end_entry), "");
+          gtk_entry_set_text (GTK_ENTRY (priv->alternate_start_entry), "");
+          gtk_entry_set_text (GTK_ENTRY (priv->alternate_end_entry), "");
+          gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (priv->indent_button), FALSE);
+          gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (priv->padding_button), FALSE);
         }                  
     }
 
   g_signal_handler_unblock (priv->start_entry, priv->start_entry_id);
   g_signal_handler_unblock (priv->end_entry, priv->end_entry_id);
+  g_signal_handler_unblock (priv->alternate_start_entry, priv->alternate_start_entry_id);
+  g_signal_handler_unblock (priv->alternate_end_entry, priv->alternate_end_entry_id);
+  g_signal_handler_unblock (priv->indent_button, priv->indent_button_id);
+  g_signal_handler_unblock (priv->padding_button, priv->padding_button_id);
 }
 
 static void
@@ -521,6 +627,95 @@ end_entry_action (CommentsDialog *dialog,
     }
 }
 
+static void
+alternate_start_entry_action (CommentsDialog *dialog,
+                              GParamSpec     *spec)
+{
+  CommentsDialogPrivate *priv;
+  CommentsConfig *config;
+
+  priv = COMMENTS_DIALOG_GET_PRIVATE (dialog);
+  
+  config = get_selected_config (dialog);
+  if (config != NULL)
+    {
+      const gchar *text;
+      text = gtk_entry_get_text (GTK_ENTRY (priv->alternate_start_entry));
+      comments_config_set_alternate_start (config, text);
+    }
+}
+
+static void
+alternate_end_entry_action (CommentsDialog *dialog,
+                            GParamSpec     *spec)
+{
+  CommentsDialogPrivate *priv;
+  CommentsConfig *config;
+
+  priv = COMMENTS_DIALOG_GET_PRIVATE (dialog);
+  
+  config = get_selected_config (dialog);
+  if (config != NULL)
+    {
+      const gchar *text;
+      text = gtk_entry_get_text (GTK_ENTRY (priv->alternate_end_entry));
+      comments_config_set_alternate_end (config, text);
+    }
+}
+
+static void
+indent_button_action (CommentsDialog *dialog)
+{
+  CommentsDialogPrivate *priv;
+  CommentsConfig *config;
+
+  priv = COMMENTS_DIALOG_GET_PRIVATE (dialog);
+  
+  config = get_selected_config (dialog);
+  if (config != NULL)
+    {
+      gboolean active;
+      active = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (priv->indent_button));
+      comments_config_set_indent (config, active);
+    }
+}
+
+static void
+padding_button_action (CommentsDialog *dialog)
+{
+  CommentsDialogPrivate *priv;
+  CommentsConfig *config;
+
+  priv = COMMENTS_DIALOG_GET_PRIVATE (dialog);
+  
+  config = get_selected_config (dialog);
+  if (config != NULL)
+    {
+      gboolean active;
+      active = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (priv->padding_button));
+      comments_config_set_padding (config, active);
+    }
+}
+
+static CommentsConfig*
+get_selected_config (CommentsDialog *dialog)
+{
+  CommentsDialogPrivate *priv;
+  GtkTreeSelection *selection;
+  GtkTreeModel *model;
+  GtkTreeIter iter;
+  CommentsConfig *config = NULL;
+
+  priv = COMMENTS_DIALOG_GET_PRIVATE (dialog);
+  
+  selection = gtk_tree_view_get_selection (GTK_TREE_VIEW (priv->tree));
+  if (gtk_tree_selection_get_selected (selection, &model, &iter))
+    gtk_tree_model_get (GTK_TREE_MODEL (model), &iter, 
+                        CONFIGURATION, &config, -1);
+
+  return config;
+}
+
 static gint
 sort_compare (GtkTreeModel *model, 
               GtkTreeIter  *a,
@@ -16,47 +16,349 @@
  * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
  */
 
+#include <string.h>
+#include <glib/gstdio.h>
 #include <codeslayer/codeslayer-utils.h>
 #include "comments-engine.h"
 #include "comments-dialog.h"
 #include "comments-config.h"
+#include "comments-transform.h"
+#include "comments-trace.h"
+#include "comments-scanner.h"
+#include "comments-report.h"
+#include "comments-stripper.h"
+#include "comments-sniffer.h"
+#include "comments-resolver.h"
+#include "comments-snapshot.h"
+#include "comments-parallel.h"
+#include "comments-recorder.h"
+#include "comments-applier.h"
+#include "comments-regions.h"
+#include "comments-arena.h"
+#include "comments-detector.h"
+#include "comments-findings.h"
+#include "comments-blocks.h"
+#include "comments-license.h"
+
+typedef struct _ReportJob ReportJob;
+typedef struct _FindJob FindJob;
+typedef struct _LicenseJob LicenseJob;
+typedef struct _RangeDialog RangeDialog;
+typedef struct _BulkEdit BulkEdit;
+typedef struct _LineTransform LineTransform;
+typedef struct _EditJob EditJob;
+typedef struct _ResolverEntry ResolverEntry;
+
+struct _ReportJob
+{
+  CommentsEngine   *engine;
+  gchar            *folder_path;
+  CommentsSnapshot *snapshot;
+  GPtrArray        *stats;
+};
+
+struct _FindJob
+{
+  CommentsEngine   *engine;
+  gchar            *folder_path;
+  CommentsSnapshot *snapshot;
+  GPtrArray        *detections;
+};
 
-typedef gchar* (*BlockCommentFunc) (gchar        *selection, 
-                                    const gchar  *start,
-                                    const gchar  *end);
+/*
+ * A project's resolver, and the modification time and size its overlay
+ * had when it was read, or -1 when there was none.
+ */
+struct _ResolverEntry
+{
+  CommentsResolver *resolver;
+  gint64            mtime;
+  goffset           size;
+};
 
-typedef gchar* (*LineCommentFunc)  (gchar        *selection, 
-                                    const gchar  *start);
+struct _LicenseJob
+{
+  CommentsEngine       *engine;
+  gchar                *folder_path;
+  gchar                *cache_path;
+  CommentsSnapshot     *snapshot;
+  CommentsLicense      *license;
+  CommentsLicenseStats  stats;
+};
 
 static void comments_engine_class_init           (CommentsEngineClass  *klass);
 static void comments_engine_init                 (CommentsEngine       *engine);
 static void comments_engine_finalize             (CommentsEngine       *engine);
 
 static void action_callback                      (CommentsEngine       *engine, 
-                                                  BlockCommentFunc      blockCommentFunc, 
-                                                  LineCommentFunc       lineCommentFunc);
+                                                  guint                 uncomments,
+                                                  guint                 comments);
+static void transform_selection                  (CommentsEngine       *engine,
+                                                  GString              *result,
+                                                  CommentsConfig       *config,
+                                                  GtkSourceView        *source_view,
+                                                  const gchar          *selection,
+                                                  gsize                 length,
+                                                  gboolean              comment);
+static void queue_action                         (CommentsEngine       *engine,
+                                                  gboolean              comment);
+static gboolean run_pending_actions              (CommentsEngine       *engine);
+static void schedule_pending_actions             (CommentsEngine       *engine);
 
 static void comment_action                       (CommentsEngine       *engine);
 static void uncomment_action                     (CommentsEngine       *engine);
-
-static CommentsConfig* get_config  (CommentsEngine       *engine);
+static void comment_lines_action                 (CommentsEngine       *engine);
+static void uncomment_lines_action               (CommentsEngine       *engine);
+static void comment_document_action              (CommentsEngine       *engine);
+static void uncomment_document_action            (CommentsEngine       *engine);
+static void range_action                         (CommentsEngine       *engine,
+                                                  gboolean              comment,
+                                                  gboolean              whole);
+static GArray* get_range_lines                   (GtkTextBuffer        *buffer,
+                                                  const CommentsRange  *ranges,
+                                                  guint                 n_ranges);
+static gint compare_intervals                    (gconstpointer         a,
+                                                  gconstpointer         b);
+static gboolean run_range_dialog                 (const gchar          *title,
+                                                  gint                  line_count,
+                                                  gint                 *first,
+                                                  gint                 *last);
+static void range_from_changed                   (RangeDialog          *range);
+static void range_to_changed                     (RangeDialog          *range);
+static void range_count_changed                  (RangeDialog          *range);
+static void comment_matching_action              (CommentsEngine       *engine);
+static void strip_comments_action                (CommentsEngine       *engine);
+static void reflow_comment_action                (CommentsEngine       *engine);
+static void convert_comment_style_action         (CommentsEngine       *engine);
+static void next_comment_block_action            (CommentsEngine       *engine);
+static void previous_comment_block_action        (CommentsEngine       *engine);
+static void select_comment_block_action          (CommentsEngine       *engine);
+static void find_comment_block                   (CommentsEngine       *engine,
+                                                  CommentsBlocksSearch  search);
+static void density_report_action                (CommentsEngine       *engine);
+static gpointer density_report_thread            (ReportJob            *job);
+static gboolean density_report_done              (ReportJob            *job);
+static void find_commented_code_action           (CommentsEngine       *engine);
+static gpointer find_commented_code_thread       (FindJob              *job);
+static gboolean find_commented_code_done         (FindJob              *job);
+static void select_detection_action              (CommentsEngine       *engine,
+                                                  CommentsDetection    *detection);
+static void update_license_header_action         (CommentsEngine       *engine);
+static void update_license_headers_action        (CommentsEngine       *engine);
+static gpointer update_license_headers_thread    (LicenseJob           *job);
+static gboolean update_license_headers_done      (LicenseJob           *job);
+static CommentsLicense* load_license             (CommentsEngine       *engine,
+                                                  const gchar          *title);
+static gchar* get_project_folder_path            (CodeSlayerDocument   *document);
+static gboolean run_pattern_dialog               (gchar               **pattern,
+                                                  gboolean             *regex);
+static void comment_range                        (CommentsArena        *arena,
+                                                  GtkTextBuffer        *buffer,
+                                                  CommentsConfig       *config,
+                                                  gint                  first,
+                                                  gint                  last,
+                                                  guint                 tab_width);
+static void uncomment_range                      (GtkTextBuffer        *buffer,
+                                                  CommentsConfig       *config,
+                                                  gint                  first,
+                                                  gint                  last);
+static void comment_line                         (GtkTextBuffer        *buffer,
+                                                  gint                  line,
+                                                  const gchar          *prefix,
+                                                  const gchar          *end,
+                                                  gboolean              block,
+                                                  gboolean              indent,
+                                                  guint                 column,
+                                                  guint                 tab_width);
+static void uncomment_line                       (GtkTextBuffer        *buffer,
+                                                  gint                  line,
+                                                  const gchar          *start,
+                                                  const gchar          *end,
+                                                  gboolean              block,
+                                                  gboolean              padding);
+static gboolean get_line_content                 (GtkTextBuffer        *buffer,
+                                                  gint                  line,
+                                                  GtkTextIter          *iter);
+static guint get_min_column                      (GtkTextBuffer        *buffer,
+                                                  gint                  first,
+                                                  guint                 n_lines,
+                                                  const guint          *lines,
+                                                  guint                 tab_width);
+static gboolean forward_indent                   (GtkTextIter          *iter,
+                                                  guint                *column,
+                                                  guint                 max_column,
+                                                  guint                 tab_width);
+static gboolean match_at_iter                    (const GtkTextIter    *iter,
+                                                  const gchar          *text,
+                                                  GtkTextIter          *match_end);
+
+static CommentsConfig* get_config                (CommentsEngine       *engine,
+                                                  CodeSlayerDocument   *document);
+static CommentsConfig* get_region_config         (CommentsEngine       *engine,
+                                                  CodeSlayerDocument   *document,
+                                                  const GtkTextIter    *iter);
+static CommentsConfig* sniff_config              (CodeSlayerDocument   *document,
+                                                  CommentsResolver     *resolver);
+static void sniff_insert_text                    (GtkTextBuffer        *buffer,
+                                                  GtkTextIter          *iter,
+                                                  const gchar          *text,
+                                                  gint                  length);
+static void sniff_delete_range                   (GtkTextBuffer        *buffer,
+                                                  GtkTextIter          *start,
+                                                  GtkTextIter          *end);
+static void forget_sniffed_suffix                (GtkTextBuffer        *buffer,
+                                                  const GtkTextIter    *start,
+                                                  const GtkTextIter    *end);
+static CommentsResolver* get_resolver            (CommentsEngine       *engine,
+                                                  CodeSlayerDocument   *document);
+static void resolver_entry_free                  (ResolverEntry        *entry);
 
 static gchar* get_config_file_path               (CommentsEngine       *engine);
 
-static gchar* insert_line_comment                (gchar                *selection, 
-                                                  const gchar          *start);
-static gchar* remove_line_comment                (gchar                *selection,
-                                                  const gchar          *start);
+static void insert_lines                         (GString              *result,
+                                                  const gchar          *text,
+                                                  gsize                 length,
+                                                  LineTransform        *transform);
+static void remove_lines                         (GString              *result,
+                                                  const gchar          *text,
+                                                  gsize                 length,
+                                                  LineTransform        *transform);
+static void insert_line_comment                  (CommentsEngine       *engine,
+                                                  GString              *result,
+                                                  const gchar          *selection, 
+                                                  gsize                 length,
+                                                  const gchar          *start,
+                                                  CommentsEol           eol);
+static void remove_line_comment                  (CommentsEngine       *engine,
+                                                  GString              *result,
+                                                  const gchar          *selection,
+                                                  gsize                 length,
+                                                  const gchar          *start,
+                                                  CommentsEol           eol);
+
+static void insert_indent_comment                (GString              *result,
+                                                  const gchar          *selection, 
+                                                  gsize                 length,
+                                                  const gchar          *start,
+                                                  gboolean              padding,
+                                                  guint                 tab_width);
+static void remove_indent_comment                (GString              *result,
+                                                  const gchar          *selection,
+                                                  gsize                 length,
+                                                  const gchar          *start,
+                                                  gboolean              padding,
+                                                  guint                 tab_width);
 
 static gboolean match_block_comment              (const gchar          *start,
                                                   const gchar          *end);
-static gchar* insert_block_comment               (gchar                *selection,
+static void insert_block_comment                 (GString              *result,
+                                                  const gchar          *selection,
+                                                  gsize                 length,
                                                   const gchar          *start,
-                                                  const gchar          *end);
-static gchar* remove_block_comment               (gchar                *selection, 
+                                                  const gchar          *end,
+                                                  CommentsEol           eol);
+static void remove_block_comment                 (GString              *result,
+                                                  const gchar          *selection, 
+                                                  gsize                 length,
                                                   const gchar          *start,
-                                                  const gchar          *end);
-static GList* get_configs_deep_copy       (CommentsEngine       *engine);
+                                                  const gchar          *end,
+                                                  CommentsEol           eol);
+static const gchar* get_prefix                   (CommentsArena        *arena,
+                                                  const gchar          *start,
+                                                  gboolean              padding);
+static CommentsEol get_eol                       (GtkTextBuffer        *buffer);
+static CommentsEol sample_eol                    (GtkTextBuffer        *buffer,
+                                                  const GtkTextIter    *start,
+                                                  const GtkTextIter    *end);
+static void eol_insert_text                      (GtkTextBuffer        *buffer,
+                                                  GtkTextIter          *iter,
+                                                  const gchar          *text,
+                                                  gint                  length);
+static gint get_config_id                        (CommentsEngine       *engine,
+                                                  CommentsConfig       *config);
+static guint count_lines                         (const gchar          *text);
+static gsize get_range_bytes                     (GtkTextBuffer        *buffer,
+                                                  const GtkTextIter    *start,
+                                                  const GtkTextIter    *end);
+static void begin_bulk_edit                      (CommentsEngine       *engine,
+                                                  GtkTextBuffer        *buffer,
+                                                  GtkTextIter          *start,
+                                                  GtkTextIter          *end,
+                                                  BulkEdit             *bulk);
+static void end_bulk_edit                        (BulkEdit             *bulk,
+                                                  GtkSourceView        *source_view);
+static EditJob* new_edit_job                     (CommentsEngine       *engine,
+                                                  CodeSlayerDocument   *document,
+                                                  CommentsConfig       *config,
+                                                  const gchar          *operation,
+                                                  guint                 count,
+                                                  gint64                start_time);
+static EditJob* new_line_job                     (CommentsEngine       *engine,
+                                                  CodeSlayerDocument   *document,
+                                                  CommentsConfig       *config,
+                                                  const gchar          *operation,
+                                                  gboolean              comment,
+                                                  gint64                start_time);
+static void start_edit_job                       (EditJob              *job,
+                                                  GtkTextIter          *iter,
+                                                  CommentsApplierFunc   func,
+                                                  CommentsApplierDoneFunc done);
+static gboolean replace_job_step                 (GtkTextBuffer        *buffer,
+                                                  GtkTextIter          *iter,
+                                                  EditJob              *job);
+static void replace_job_done                     (GtkTextBuffer        *buffer,
+                                                  const GtkTextIter    *iter,
+                                                  EditJob              *job);
+static gboolean line_job_step                    (GtkTextBuffer        *buffer,
+                                                  GtkTextIter          *iter,
+                                                  EditJob              *job);
+static void line_job_done                        (GtkTextBuffer        *buffer,
+                                                  const GtkTextIter    *iter,
+                                                  EditJob              *job);
+static void finish_edit_job                      (EditJob              *job);
+static void record_action                        (CommentsEngine       *engine,
+                                                  const gchar          *operation,
+                                                  guint                 count,
+                                                  CodeSlayerDocument   *document,
+                                                  CommentsConfig       *config,
+                                                  const gchar          *text,
+                                                  gint64                start_time);
+
+/*
+ * Every action__start is matched by one action__done, fired once the edit
+ * is in the buffer, which is after the applier has finished for the edits
+ * that are spread over slices. An action that gives up before it has its
+ * config and its text fires neither.
+ */
+#define TRACE_ACTION_START(engine, config, bytes, lines) G_STMT_START { \
+  if (COMMENTS_TRACE_ENABLED (action__start)) \
+    COMMENTS_TRACE3 (action__start, bytes, lines, get_config_id (engine, config)); \
+} G_STMT_END
+
+#define TRACE_ACTION_DONE(length) G_STMT_START { \
+  if (COMMENTS_TRACE_ENABLED (action__done)) \
+    COMMENTS_TRACE1 (action__done, length); \
+} G_STMT_END
+
+#define TRACE_TRANSFORM_START(name, length) G_STMT_START { \
+  if (COMMENTS_TRACE_ENABLED (transform__start)) \
+    COMMENTS_TRACE2 (transform__start, name, length); \
+} G_STMT_END
+
+#define TRACE_TRANSFORM_DONE(name, length) G_STMT_START { \
+  if (COMMENTS_TRACE_ENABLED (transform__done)) \
+    COMMENTS_TRACE2 (transform__done, name, length); \
+} G_STMT_END
+
+#define SNIFFED_SUFFIX "comments_sniffed_suffix"
+#define BUFFER_EOL "comments_eol"
+#define EOL_SAMPLE_LENGTH 4096
+#define OVERLAY_FILE ".comments.xml"
+#define BULK_EDIT_THRESHOLD (256 * 1024)
+#define REPLACE_CHUNK_SIZE (16 * 1024)
+#define REFLOW_WIDTH 100
+#define REPEAT_INTERVAL 50
+#define BULK_SYNTAX_SHARE 2
 
 #define COMMENTS_ENGINE_GET_PRIVATE(obj) \
   (G_TYPE_INSTANCE_GET_PRIVATE ((obj), COMMENTS_ENGINE_TYPE, CommentsEnginePrivate))
@@ -67,7 +369,80 @@ struct _CommentsEnginePrivate
 {
   CodeSlayer *codeslayer;
   GtkWidget  *menu;
-  GList      *configs;
+  CommentsPublisher *publisher;
+  GHashTable *resolvers;
+  gboolean    scanning;
+  guint       pending_comments;
+  guint       pending_uncomments;
+  guint       pending_id;
+  guint       repeat_interval;
+  gint        bulk_threshold;
+  CommentsRecorder *recorder;
+  CommentsApplier *applier;
+  gint        apply_budget;
+  CommentsArena *arena;
+  CommentsParallel *parallel;
+  CommentsDetector *detector;
+};
+
+struct _RangeDialog
+{
+  GtkWidget *from;
+  GtkWidget *to;
+  GtkWidget *count;
+};
+
+struct _BulkEdit
+{
+  GtkSourceBuffer *buffer;
+  GtkTextMark     *start;
+  GtkTextMark     *end;
+  gboolean         highlight_brackets;
+  gboolean         highlight_syntax;
+};
+
+struct _LineTransform
+{
+  const gchar *start;
+  CommentsEol  eol;
+};
+
+/*
+ * An edit handed to the applier. A replace job swaps the text between the
+ * marks for replace; a line job comments or uncomments the listed lines,
+ * or first to first + n_lines - 1 when there is no list.
+ */
+struct _EditJob
+{
+  CommentsEngine     *engine;
+  CodeSlayerDocument *document;
+  GtkSourceView      *source_view;
+  CommentsConfig     *config;
+  BulkEdit            bulk;
+  const gchar        *operation;
+  guint               count;
+  gchar              *text;
+  gint64              start_time;
+
+  const gchar        *replace;
+  gsize               length;
+  gsize               pos;
+  GtkTextMark        *start_mark;
+  GtkTextMark        *end_mark;
+
+  gboolean            comment;
+  const gchar        *prefix;
+  const gchar        *start;
+  const gchar        *end;
+  gboolean            block;
+  gboolean            indent;
+  gboolean            padding;
+  guint               column;
+  guint               tab_width;
+  guint              *lines;
+  gint                first;
+  guint               n_lines;
+  guint               index;
 };
 
 G_DEFINE_TYPE (CommentsEngine, comments_engine, G_TYPE_OBJECT)
@@ -85,7 +460,21 @@ comments_engine_init (CommentsEngine *engine)
 {
   CommentsEnginePrivate *priv;
   priv = COMMENTS_ENGINE_GET_PRIVATE (engine);
-  priv->configs = NULL;
+  priv->publisher = comments_publisher_new ();
+  priv->resolvers = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                           (GDestroyNotify) resolver_entry_free);
+  priv->scanning = FALSE;
+  priv->pending_comments = 0;
+  priv->pending_uncomments = 0;
+  priv->pending_id = 0;
+  priv->repeat_interval = REPEAT_INTERVAL;
+  priv->bulk_threshold = BULK_EDIT_THRESHOLD;
+  priv->recorder = NULL;
+  priv->applier = NULL;
+  priv->apply_budget = COMMENTS_APPLIER_BUDGET;
+  priv->arena = comments_arena_new (COMMENTS_ARENA_LIMIT);
+  priv->parallel = comments_parallel_new ();
+  priv->detector = comments_detector_new ();
 }
 
 static void
@@ -93,12 +482,20 @@ comments_engine_finalize (CommentsEngine *engine)
 {
   CommentsEnginePrivate *priv;
   priv = COMMENTS_ENGINE_GET_PRIVATE (engine);
-  if (priv->configs != NULL)
+  if (priv->applier != NULL)
+    comments_applier_finish (priv->applier);
+  if (priv->pending_id != 0)
     {
-      g_list_foreach (priv->configs, (GFunc) g_object_unref, NULL);
-      g_list_free (priv->configs);
-      priv->configs = NULL;    
+      g_source_remove (priv->pending_id);
+      priv->pending_id = 0;
     }
+  if (priv->recorder != NULL)
+    comments_recorder_free (priv->recorder);
+  g_hash_table_destroy (priv->resolvers);
+  comments_publisher_free (priv->publisher);
+  comments_parallel_free (priv->parallel);
+  comments_arena_free (priv->arena);
+  comments_detector_free (priv->detector);
 
   G_OBJECT_CLASS (comments_engine_parent_class)->finalize (G_OBJECT(engine));
 }
@@ -122,6 +519,51 @@ comments_engine_new (CodeSlayer *codeslayer,
   g_signal_connect_swapped (G_OBJECT (menu), "uncomment",
                             G_CALLBACK (uncomment_action), engine);
   
+  g_signal_connect_swapped (G_OBJECT (menu), "comment-lines",
+                            G_CALLBACK (comment_lines_action), engine);
+  
+  g_signal_connect_swapped (G_OBJECT (menu), "uncomment-lines",
+                            G_CALLBACK (uncomment_lines_action), engine);
+  
+  g_signal_connect_swapped (G_OBJECT (menu), "comment-document",
+                            G_CALLBACK (comment_document_action), engine);
+  
+  g_signal_connect_swapped (G_OBJECT (menu), "uncomment-document",
+                            G_CALLBACK (uncomment_document_action), engine);
+  
+  g_signal_connect_swapped (G_OBJECT (menu), "comment-matching",
+                            G_CALLBACK (comment_matching_action), engine);
+  
+  g_signal_connect_swapped (G_OBJECT (menu), "strip-comments",
+                            G_CALLBACK (strip_comments_action), engine);
+  
+  g_signal_connect_swapped (G_OBJECT (menu), "reflow-comment",
+                            G_CALLBACK (reflow_comment_action), engine);
+  
+  g_signal_connect_swapped (G_OBJECT (menu), "convert-comment-style",
+                            G_CALLBACK (convert_comment_style_action), engine);
+  
+  g_signal_connect_swapped (G_OBJECT (menu), "next-comment-block",
+                            G_CALLBACK (next_comment_block_action), engine);
+  
+  g_signal_connect_swapped (G_OBJECT (menu), "previous-comment-block",
+                            G_CALLBACK (previous_comment_block_action), engine);
+  
+  g_signal_connect_swapped (G_OBJECT (menu), "select-comment-block",
+                            G_CALLBACK (select_comment_block_action), engine);
+  
+  g_signal_connect_swapped (G_OBJECT (menu), "density-report",
+                            G_CALLBACK (density_report_action), engine);
+  
+  g_signal_connect_swapped (G_OBJECT (menu), "find-commented-code",
+                            G_CALLBACK (find_commented_code_action), engine);
+  
+  g_signal_connect_swapped (G_OBJECT (menu), "update-license-header",
+                            G_CALLBACK (update_license_header_action), engine);
+  
+  g_signal_connect_swapped (G_OBJECT (menu), "update-license-headers",
+                            G_CALLBACK (update_license_headers_action), engine);
+  
   return engine;
 }
 
@@ -134,30 +576,33 @@ comments_engine_load_configs (CommentsEngine *engine)
 
   priv = COMMENTS_ENGINE_GET_PRIVATE (engine);
   
+  COMMENTS_TRACE (load__start);
+
   file_path = get_config_file_path (engine);
-  configs = codeslayer_utils_get_gobjects (COMMENTS_CONFIG_TYPE,
-                                                  FALSE,
-                                                  file_path, 
-                                                  "comment",
-                                                  "file_types", G_TYPE_STRING, 
-                                                  "start", G_TYPE_STRING, 
-                                                  "end", G_TYPE_STRING, 
-                                                  NULL);
-  priv->configs = configs;
+  configs = comments_config_load_list (file_path);
+  comments_publisher_publish (priv->publisher, comments_snapshot_new (configs));
+  g_hash_table_remove_all (priv->resolvers);
   g_free (file_path);
+
+  COMMENTS_TRACE1 (load__done, g_list_length (configs));
 }
 
 void
 comments_engine_open_dialog (CommentsEngine *engine)
 {
   CommentsEnginePrivate *priv;
+  CommentsSnapshot *snapshot;
   GList *copies;
   GtkWidget *dialog;
   gint response;
 
   priv = COMMENTS_ENGINE_GET_PRIVATE (engine);
 
-  copies = get_configs_deep_copy (engine);
+  /* the dialog edits copies; the snapshot itself is never changed */
+  snapshot = comments_publisher_acquire (priv->publisher);
+  copies = comments_config_copy_list (snapshot->configs);
+  comments_snapshot_unref (snapshot);
+
   dialog = comments_dialog_new (priv->codeslayer, &copies);
     
   response = gtk_dialog_run (GTK_DIALOG (dialog));
@@ -166,20 +611,17 @@ comments_engine_open_dialog (CommentsEngine *engine)
     {
       gchar *file_path;
       
-      g_list_foreach (priv->configs, (GFunc) g_object_unref, NULL);
-      g_list_free (priv->configs);      
-      priv->configs = copies;
+      comments_publisher_publish (priv->publisher, comments_snapshot_new (copies));
+      g_hash_table_remove_all (priv->resolvers);
       
       file_path = get_config_file_path (engine);
       
-      codeslayer_utils_save_gobjects (copies,
-                                      file_path, 
-                                      "comment",
-                                      "file_types", G_TYPE_STRING, 
-                                      "start", G_TYPE_STRING, 
-                                      "end", G_TYPE_STRING, 
-                                      NULL);
+      COMMENTS_TRACE1 (save__start, g_list_length (copies));
+
+      comments_config_save_list (copies, file_path);
       g_free (file_path);
+
+      COMMENTS_TRACE (save__done);
     }
   else
     {
@@ -190,6 +632,183 @@ comments_engine_open_dialog (CommentsEngine *engine)
   gtk_widget_destroy (dialog);
 }
 
+/*
+ * Edits spanning at least this many characters are applied with bracket
+ * highlighting switched off, and with syntax highlighting too when they
+ * cover most of the buffer, and only their visible part re-highlighted at
+ * the end. Zero turns that on for every edit and a negative value turns it
+ * off altogether.
+ */
+void
+comments_engine_set_bulk_threshold (CommentsEngine *engine,
+                                    gint            threshold)
+{
+  CommentsEnginePrivate *priv;
+  priv = COMMENTS_ENGINE_GET_PRIVATE (engine);
+  priv->bulk_threshold = threshold;
+}
+
+/*
+ * Large edits are applied in slices of at most this many microseconds, with
+ * the main loop running in between. A negative budget applies every edit
+ * in one go.
+ */
+void
+comments_engine_set_apply_budget (CommentsEngine *engine,
+                                  gint            budget)
+{
+  CommentsEnginePrivate *priv;
+  priv = COMMENTS_ENGINE_GET_PRIVATE (engine);
+  priv->apply_budget = budget;
+}
+
+/*
+ * Repeated requests are applied together once none has come for this many
+ * milliseconds. Zero applies them as soon as the main loop gets to it.
+ */
+void
+comments_engine_set_repeat_interval (CommentsEngine *engine,
+                                     guint           interval)
+{
+  CommentsEnginePrivate *priv;
+  priv = COMMENTS_ENGINE_GET_PRIVATE (engine);
+  priv->repeat_interval = interval;
+}
+
+/*
+ * Append every action from now on to the trace at file_path: what was done,
+ * the config it was done with, the size and a hash of the text, and how
+ * long it took. The text itself is never written. comments-bench --replay
+ * runs a trace again.
+ */
+gboolean
+comments_engine_start_recording (CommentsEngine  *engine,
+                                 const gchar     *file_path,
+                                 GError         **error)
+{
+  CommentsEnginePrivate *priv;
+  CommentsRecorder *recorder;
+
+  priv = COMMENTS_ENGINE_GET_PRIVATE (engine);
+
+  recorder = comments_recorder_new (file_path, error);
+  if (recorder == NULL)
+    return FALSE;
+
+  comments_engine_stop_recording (engine);
+  priv->recorder = recorder;
+
+  return TRUE;
+}
+
+void
+comments_engine_stop_recording (CommentsEngine *engine)
+{
+  CommentsEnginePrivate *priv;
+  priv = COMMENTS_ENGINE_GET_PRIVATE (engine);
+
+  if (priv->recorder != NULL)
+    {
+      comments_recorder_free (priv->recorder);
+      priv->recorder = NULL;
+    }
+}
+
+/*
+ * Comment or uncomment every line touched by the ranges, in one pass over
+ * the buffer and as one user action, with the delimiters configured for
+ * the document. Overlapping ranges are merged so no line is done twice.
+ * The document does not have to be the active one and nothing is selected.
+ * The edit is complete by the time this returns; an edit still being
+ * applied from the menu is finished first. Returns FALSE when there is no
+ * config for the document. Other plugins get here through
+ * comments_apply_ranges.
+ */
+gboolean
+comments_engine_apply_ranges (CommentsEngine      *engine,
+                              CodeSlayerDocument  *document,
+                              const CommentsRange *ranges,
+                              guint                n_ranges,
+                              CommentsOperation    operation)
+{
+  CommentsEnginePrivate *priv;
+  GtkSourceView *source_view;
+  GtkTextBuffer *buffer;
+  GtkTextIter start, end;
+  CommentsConfig *config;
+  EditJob *job;
+  GArray *lines;
+  gboolean comment;
+  gchar *text = NULL;
+  gint64 start_time;
+
+  priv = COMMENTS_ENGINE_GET_PRIVATE (engine);
+
+  if (priv->applier != NULL)
+    comments_applier_finish (priv->applier);
+
+  source_view = codeslayer_document_get_source_view (document);
+  buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (source_view));
+
+  lines = get_range_lines (buffer, ranges, n_ranges);
+
+  /* like a range of lines, they take the language of the block they start in */
+  if (lines->len > 0)
+    {
+      gtk_text_buffer_get_iter_at_line (buffer, &start, 
+                                        g_array_index (lines, guint, 0));
+      config = get_region_config (engine, document, &start);
+    }
+  else
+    {
+      config = get_config (engine, document);
+    }
+
+  comment = operation == COMMENTS_OPERATION_COMMENT;
+
+  if (config == NULL || 
+      (!comment && !codeslayer_utils_has_text (comments_config_get_start (config))))
+    {
+      g_array_free (lines, TRUE);
+      return FALSE;
+    }
+
+  if (lines->len == 0)
+    {
+      g_array_free (lines, TRUE);
+      return TRUE;
+    }
+
+  gtk_text_buffer_get_iter_at_line (buffer, &end, 
+                                    g_array_index (lines, guint, lines->len - 1));
+  if (!gtk_text_iter_ends_line (&end))
+    gtk_text_iter_forward_to_line_end (&end);
+
+  if (priv->recorder != NULL)
+    text = gtk_text_buffer_get_text (buffer, &start, &end, TRUE);
+
+  TRACE_ACTION_START (engine, config, get_range_bytes (buffer, &start, &end), 
+                      lines->len);
+
+  start_time = g_get_monotonic_time ();
+
+  job = new_line_job (engine, document, config, 
+                      comment ? "comment-ranges" : "uncomment-ranges", 
+                      comment, start_time);
+  job->text = text;
+  job->n_lines = lines->len;
+  job->lines = (guint *) g_array_free (lines, FALSE);
+
+  begin_bulk_edit (engine, buffer, &start, &end, &job->bulk);
+  start_edit_job (job, &start, (CommentsApplierFunc) line_job_step, 
+                  (CommentsApplierDoneFunc) line_job_done);
+
+  if (priv->applier != NULL)
+    comments_applier_finish (priv->applier);
+
+  return TRUE;
+}
+
 static gchar*
 get_config_file_path (CommentsEngine *engine)
 {
@@ -206,57 +825,116 @@ get_config_file_path (CommentsEngine *engine)
   return file_path;
 }
 
-static GList*
-get_configs_deep_copy (CommentsEngine *engine)
+/*
+ * The position of the config in the global list, or -1, for the traces.
+ */
+static gint
+get_config_id (CommentsEngine *engine,
+               CommentsConfig *config)
 {
   CommentsEnginePrivate *priv;
-  GList *results = NULL;
-  GList *list;
+  CommentsSnapshot *snapshot;
+  gint id;
 
   priv = COMMENTS_ENGINE_GET_PRIVATE (engine);
-  
-  list = priv->configs;
 
-  while (list != NULL)
-    {
-      CommentsConfig *config = list->data;
-      CommentsConfig *copy;
-      const gchar *file_types;
-      const gchar *start;
-      const gchar *end;
+  snapshot = comments_publisher_acquire (priv->publisher);
+  id = g_list_index (snapshot->configs, config);
+  comments_snapshot_unref (snapshot);
 
-      file_types = comments_config_get_file_types (config);
-      start = comments_config_get_start (config);
-      end = comments_config_get_end (config);
-      
-      copy = comments_config_new ();
-      comments_config_set_file_types (copy, file_types);
-      comments_config_set_start (copy, start);
-      comments_config_set_end (copy, end);
-      results = g_list_prepend (results, copy);
-      
-      list = g_list_next (list);
-    }
-    
-  return results;    
+  return id;
 }
 
 static void 
 comment_action (CommentsEngine *engine)
 {
-  action_callback (engine, insert_block_comment, insert_line_comment);
+  queue_action (engine, TRUE);
 }
 
 static void 
 uncomment_action (CommentsEngine *engine)
 {
-  action_callback (engine, remove_block_comment, remove_line_comment);
+  queue_action (engine, FALSE);
+}
+
+/*
+ * Holding down the accelerator emits comment or uncomment on every auto
+ * repeat. Rather than rewrite the buffer each time the requests are counted
+ * and applied together once no new one has come for a little longer than
+ * the usual key repeat interval, so a held key costs one selection copy,
+ * one buffer edit and one undo step when it is let go. The main loop goes
+ * idle between repeats, so waiting for idle alone would not merge them. A
+ * comment followed by an uncomment cancels out before any work is done.
+ */
+static void
+queue_action (CommentsEngine *engine,
+              gboolean        comment)
+{
+  CommentsEnginePrivate *priv;
+  priv = COMMENTS_ENGINE_GET_PRIVATE (engine);
+
+  if (comment)
+    priv->pending_comments++;
+  else if (priv->pending_comments > 0)
+    priv->pending_comments--;
+  else
+    priv->pending_uncomments++;
+
+  schedule_pending_actions (engine);
+}
+
+/* every request puts the flush off again */
+static void
+schedule_pending_actions (CommentsEngine *engine)
+{
+  CommentsEnginePrivate *priv;
+  priv = COMMENTS_ENGINE_GET_PRIVATE (engine);
+
+  if (priv->pending_id != 0)
+    g_source_remove (priv->pending_id);
+
+  priv->pending_id = g_timeout_add (priv->repeat_interval, 
+                                    (GSourceFunc) run_pending_actions, engine);
+}
+
+static gboolean
+run_pending_actions (CommentsEngine *engine)
+{
+  CommentsEnginePrivate *priv;
+  guint uncomments;
+  guint comments;
+
+  priv = COMMENTS_ENGINE_GET_PRIVATE (engine);
+
+  /* the requests are kept until the edit being applied is done */
+  if (priv->applier != NULL)
+    {
+      priv->pending_id = 0;
+      return FALSE;
+    }
+
+  uncomments = priv->pending_uncomments;
+  comments = priv->pending_comments;
+  priv->pending_uncomments = 0;
+  priv->pending_comments = 0;
+  priv->pending_id = 0;
+
+  if (uncomments > 0 || comments > 0)
+    action_callback (engine, uncomments, comments);
+
+  return FALSE;
 }
 
+/*
+ * Uncomment the selection the given number of times and then comment it
+ * the given number of times, all in memory, and write the net result back
+ * to the buffer as one user action. The replaced text is left selected so
+ * the next request works on the same lines.
+ */
 static void 
-action_callback (CommentsEngine   *engine, 
-                 BlockCommentFunc  blockCommentFunc, 
-                 LineCommentFunc   lineCommentFunc)
+action_callback (CommentsEngine *engine, 
+                 guint           uncomments,
+                 guint           comments)
 {
   CommentsEnginePrivate *priv;
   CodeSlayerDocument *document;
@@ -265,10 +943,17 @@ action_callback (CommentsEngine   *engine,
   GtkTextMark *insert_mark;
   GtkTextMark *selection_mark;
   GtkTextIter selection_start, selection_end;
+  CommentsConfig *config;
+  const gchar *start;
+  const gchar *end;
+  gboolean block;
   gchar *selection;
+  gint64 start_time;
   
   priv = COMMENTS_ENGINE_GET_PRIVATE (engine);
 
+  start_time = g_get_monotonic_time ();
+
   document = codeslayer_get_active_document (priv->codeslayer);
   
   if (document == NULL)
@@ -282,130 +967,2083 @@ action_callback (CommentsEngine   *engine,
 
   gtk_text_buffer_get_iter_at_mark (buffer, &selection_start, insert_mark);
   gtk_text_buffer_get_iter_at_mark (buffer, &selection_end, selection_mark);
+  gtk_text_iter_order (&selection_start, &selection_end);
+
+  config = get_region_config (engine, document, &selection_start);
+  if (config == NULL)
+    return;
+
+  start = comments_config_get_start (config);
+  end = comments_config_get_end (config);
+  block = match_block_comment (start, end);
+
+  /* the indentation is measured from the start of the first line */
+  if (!block && comments_config_get_indent (config) &&
+      !gtk_text_iter_equal (&selection_start, &selection_end))
+    gtk_text_iter_set_line_offset (&selection_start, 0);
 
   selection = gtk_text_buffer_get_text (buffer, &selection_start, 
                                         &selection_end, FALSE);
 
+  TRACE_ACTION_START (engine, config, strlen (selection), count_lines (selection));
+
   if (codeslayer_utils_has_text (selection))
     {
-      CommentsConfig *config;
-      config = get_config (engine);
-      if (config != NULL)
+      const gchar *replace = selection;
+      gsize length = strlen (selection);
+      GString *results[2];
+      guint i;
+
+      /* each pass reads the last one's result and writes the other string */
+      results[0] = comments_arena_take (priv->arena);
+      results[1] = comments_arena_take (priv->arena);
+
+      for (i = 0; i < uncomments + comments; i++)
         {
-          gchar *replace = NULL;
-          const gchar *start;
-          const gchar *end;
-          
-          start = comments_config_get_start (config);
-          end = comments_config_get_end (config);
-
-          if (match_block_comment (start, end))
-            {
-              g_strchomp (selection);
-              replace = blockCommentFunc (selection, start, end);
-            }
-          else
-            {
-              replace = lineCommentFunc (selection, start);
-            }
-
-          if (replace != NULL)
-            {
-              gtk_text_buffer_begin_user_action (buffer);
-              gtk_text_buffer_delete (buffer, &selection_start, &selection_end);
-              gtk_text_buffer_insert (buffer, &selection_start, replace, -1);
-              gtk_text_buffer_end_user_action (buffer);
-              g_free (replace);
-            }    
+          GString *next = results[i % 2];
+
+          g_string_truncate (next, 0);
+          transform_selection (engine, next, config, source_view, replace, 
+                               length, i >= uncomments);
+
+          replace = next->str;
+          length = next->len;
+        }
+
+      if (replace != selection)
+        {
+          EditJob *job;
+
+          job = new_edit_job (engine, document, config, 
+                              comments > 0 ? "comment" : "uncomment", 
+                              uncomments + comments, start_time);
+          job->text = selection;
+          job->replace = replace;
+          job->length = length;
+          job->start_mark = gtk_text_buffer_create_mark (buffer, NULL, 
+                                                         &selection_start, TRUE);
+          job->end_mark = gtk_text_buffer_create_mark (buffer, NULL, 
+                                                       &selection_end, FALSE);
+
+          begin_bulk_edit (engine, buffer, &selection_start, &selection_end, 
+                           &job->bulk);
+          start_edit_job (job, &selection_start, 
+                          (CommentsApplierFunc) replace_job_step, 
+                          (CommentsApplierDoneFunc) replace_job_done);
+          return;
         }
     }
+  else if (gtk_text_iter_equal (&selection_start, &selection_end))
+    {
+      gint line;
+      guint i;
+
+      /* without a selection work on the line the cursor is on */
+      line = gtk_text_iter_get_line (&selection_start);
+
+      gtk_text_buffer_begin_user_action (buffer);
+      for (i = 0; i < uncomments; i++)
+        uncomment_range (buffer, config, line, line);
+      for (i = 0; i < comments; i++)
+        comment_range (priv->arena, buffer, config, line, line, 
+                       gtk_source_view_get_tab_width (source_view));
+      gtk_text_buffer_end_user_action (buffer);
+    }
+
+  TRACE_ACTION_DONE (0);
+
+  record_action (engine, comments > 0 ? "comment" : "uncomment", 
+                 uncomments + comments, document, config, selection, start_time);
 
   if (selection != NULL)
     g_free (selection);
+
+  comments_arena_reset (priv->arena);
 }
 
-static CommentsConfig*
-get_config (CommentsEngine *engine)
+/*
+ * Write the selection with its delimiters added or taken out to result.
+ */
+static void
+transform_selection (CommentsEngine *engine,
+                     GString        *result,
+                     CommentsConfig *config,
+                     GtkSourceView  *source_view,
+                     const gchar    *selection,
+                     gsize           length,
+                     gboolean        comment)
 {
-  CommentsEnginePrivate *priv;
-  CodeSlayerDocument *document;
-  const gchar *file_path;
-  GList *list;
+  const gchar *start;
+  const gchar *end;
+  CommentsEol eol;
 
-  priv = COMMENTS_ENGINE_GET_PRIVATE (engine);
-  
-  document = codeslayer_get_active_document (priv->codeslayer);
-  file_path = codeslayer_document_get_file_path (document);
-  
-  list = priv->configs;
-  while (list != NULL)
+  start = comments_config_get_start (config);
+  end = comments_config_get_end (config);
+  eol = get_eol (gtk_text_view_get_buffer (GTK_TEXT_VIEW (source_view)));
+
+  if (match_block_comment (start, end))
     {
-      CommentsConfig *config = list->data;
-      const gchar *file_types;
-      GList *elements;
-      
-      file_types = comments_config_get_file_types (config);
-      
-      elements = codeslayer_utils_string_to_list (file_types);
-      
-      if (codeslayer_utils_contains_element_with_suffix (elements, file_path))
-        {
-          g_list_foreach (elements, (GFunc) g_free, NULL);
-          g_list_free (elements);
-          return config;
-        }
+      /* trailing whitespace is dropped, as g_strchomp would */
+      while (length > 0 && g_ascii_isspace (selection[length - 1]))
+        length--;
+
+      if (comment)
+        insert_block_comment (result, selection, length, start, end, eol);
+      else
+        remove_block_comment (result, selection, length, start, end, eol);
+      return;
+    }
 
-      g_list_foreach (elements, (GFunc) g_free, NULL);
-      g_list_free (elements);
-      
-      list = g_list_next (list);
+  if (comments_config_get_indent (config))
+    {
+      gboolean padding;
+      guint tab_width;
+
+      padding = comments_config_get_padding (config);
+      tab_width = gtk_source_view_get_tab_width (source_view);
+
+      if (comment)
+        insert_indent_comment (result, selection, length, start, padding, tab_width);
+      else
+        remove_indent_comment (result, selection, length, start, padding, tab_width);
+      return;
     }
 
-    return NULL;
+  if (comment)
+    insert_line_comment (engine, result, selection, length, start, eol);
+  else
+    remove_line_comment (engine, result, selection, length, start, eol);
 }
 
-static gchar*
-insert_line_comment (gchar       *selection, 
-                     const gchar *start)
+static void 
+comment_lines_action (CommentsEngine *engine)
 {
-  gchar *result;
-  GRegex *regex;
-  gchar *replacement;
+  range_action (engine, TRUE, FALSE);
+}
 
-  regex = g_regex_new ("(.*?)([\r\n])", 0, 0, NULL);
-  
-  replacement = g_strconcat (start, "\\1\\2\\3", NULL);
-  
-  result = g_regex_replace (regex, selection, -1, 0, replacement, 0, NULL);
-  
-  g_regex_unref (regex);
-  g_free (replacement);
+static void 
+uncomment_lines_action (CommentsEngine *engine)
+{
+  range_action (engine, FALSE, FALSE);
+}
 
-  return result;
+static void 
+comment_document_action (CommentsEngine *engine)
+{
+  range_action (engine, TRUE, TRUE);
 }
 
-static gchar*
-remove_line_comment (gchar       *selection, 
-                     const gchar *start)
+static void 
+uncomment_document_action (CommentsEngine *engine)
 {
-  gchar *result;
-  GRegex *regex;
-  gchar *pattern;
-  gchar *escape_start;
-  
-  escape_start = g_regex_escape_string (start, -1);  
+  range_action (engine, FALSE, TRUE);
+}
 
-  pattern = g_strconcat ("(", escape_start, ")(.*?)([\\r\\n])", NULL);
+/*
+ * Comment or uncomment whole lines by number, either the range picked in
+ * the dialog or every line in the buffer. Nothing is selected and nothing
+ * is copied out of the buffer; each line just gets its delimiters edited.
+ */
+static void
+range_action (CommentsEngine *engine,
+              gboolean        comment,
+              gboolean        whole)
+{
+  CommentsEnginePrivate *priv;
+  CodeSlayerDocument *document;
+  GtkSourceView *source_view;
+  GtkTextBuffer *buffer;
+  GtkTextIter iter;
+  GtkTextIter start, end;
+  CommentsConfig *config;
+  gint line_count;
+  gint first;
+  gint last;
+  gchar *text = NULL;
+  gint64 start_time;
+  EditJob *job;
+  
+  priv = COMMENTS_ENGINE_GET_PRIVATE (engine);
 
-  regex = g_regex_new (pattern, 0, 0, NULL);
+  /* an edit that is still being applied has the buffer to itself */
+  if (priv->applier != NULL)
+    return;
 
-  result = g_regex_replace (regex, selection, -1, 0, "\\2\\3", 0, NULL);
+  document = codeslayer_get_active_document (priv->codeslayer);
   
-  g_regex_unref (regex);
+  if (document == NULL)
+    return;
+
+  config = get_config (engine, document);
+  if (config == NULL)
+    return;
+
+  if (!comment && !codeslayer_utils_has_text (comments_config_get_start (config)))
+    return;
+
+  source_view = codeslayer_document_get_source_view (document);
+  buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (source_view));
+  line_count = gtk_text_buffer_get_line_count (buffer);
+
+  if (whole)
+    {
+      first = 0;
+      last = line_count - 1;
+
+      /* leave the empty line after a trailing newline alone */
+      gtk_text_buffer_get_iter_at_line (buffer, &iter, last);
+      if (last > 0 && gtk_text_iter_is_end (&iter))
+        last--;
+    }
+  else
+    {
+      gtk_text_buffer_get_iter_at_mark (buffer, &iter, 
+                                        gtk_text_buffer_get_insert (buffer));
+      first = gtk_text_iter_get_line (&iter);
+      if (!run_range_dialog (comment ? "Comment Lines" : "Uncomment Lines", 
+                             line_count, &first, &last))
+        return;
+    }
+
+  gtk_text_buffer_get_iter_at_line (buffer, &start, first);
+  gtk_text_buffer_get_iter_at_line (buffer, &end, last);
+
+  /* a range of lines takes the language of the block it starts in */
+  if (!whole)
+    {
+      config = get_region_config (engine, document, &start);
+      if (config == NULL)
+        return;
+      if (!comment && !codeslayer_utils_has_text (comments_config_get_start (config)))
+        return;
+    }
+  if (!gtk_text_iter_ends_line (&end))
+    gtk_text_iter_forward_to_line_end (&end);
+
+  /* the lines are only copied out to be measured for the trace */
+  if (priv->recorder != NULL)
+    text = gtk_text_buffer_get_text (buffer, &start, &end, TRUE);
+
+  TRACE_ACTION_START (engine, config, get_range_bytes (buffer, &start, &end), 
+                      last - first + 1);
+
+  start_time = g_get_monotonic_time ();
+
+  if (whole)
+    job = new_line_job (engine, document, config, 
+                        comment ? "comment-document" : "uncomment-document", 
+                        comment, start_time);
+  else
+    job = new_line_job (engine, document, config, 
+                        comment ? "comment-lines" : "uncomment-lines", 
+                        comment, start_time);
+
+  job->text = text;
+  job->first = first;
+  job->n_lines = last - first + 1;
+
+  begin_bulk_edit (engine, buffer, &start, &end, &job->bulk);
+  start_edit_job (job, &start, (CommentsApplierFunc) line_job_step, 
+                  (CommentsApplierDoneFunc) line_job_done);
+}
+
+/*
+ * The line numbers the ranges touch, in order and without duplicates. An
+ * offset range that ends at the start of a line leaves that line out.
+ */
+static GArray*
+get_range_lines (GtkTextBuffer       *buffer,
+                 const CommentsRange *ranges,
+                 guint                n_ranges)
+{
+  GArray *intervals;
+  GArray *lines;
+  gint line_count;
+  gint next = 0;
+  guint i;
+
+  line_count = gtk_text_buffer_get_line_count (buffer);
+
+  intervals = g_array_sized_new (FALSE, FALSE, sizeof (gint) * 2, n_ranges);
+
+  for (i = 0; i < n_ranges; i++)
+    {
+      const CommentsRange *range = &ranges[i];
+      gint interval[2];
+
+      if (range->end < range->start)
+        continue;
+
+      if (range->unit == COMMENTS_RANGE_OFFSETS)
+        {
+          GtkTextIter iter;
+
+          if (range->end <= 0)
+            continue;
+          gtk_text_buffer_get_iter_at_offset (buffer, &iter, MAX (range->start, 0));
+          interval[0] = gtk_text_iter_get_line (&iter);
+          gtk_text_buffer_get_iter_at_offset (buffer, &iter, 
+                                              MAX (range->end - 1, range->start));
+          interval[1] = gtk_text_iter_get_line (&iter);
+        }
+      else
+        {
+          if (range->start >= line_count || range->end < 0)
+            continue;
+          interval[0] = MAX (range->start, 0);
+          interval[1] = MIN (range->end, line_count - 1);
+        }
+
+      g_array_append_val (intervals, interval);
+    }
+
+  g_array_sort (intervals, compare_intervals);
+
+  lines = g_array_new (FALSE, FALSE, sizeof (guint));
+
+  for (i = 0; i < intervals->len; i++)
+    {
+      gint *interval = &g_array_index (intervals, gint, i * 2);
+      guint line;
+
+      for (line = MAX (interval[0], next); line <= (guint) interval[1]; line++)
+        g_array_append_val (lines, line);
+
+      next = MAX (next, interval[1] + 1);
+    }
+
+  g_array_free (intervals, TRUE);
+
+  return lines;
+}
+
+static gint
+compare_intervals (gconstpointer a,
+                   gconstpointer b)
+{
+  return *(const gint *) a - *(const gint *) b;
+}
+
+/*
+ * Ask for a range of lines starting at the line passed in first. The range
+ * can be given either as the last line or as a number of lines; the three
+ * spin buttons are kept in step with each other.
+ */
+static gboolean
+run_range_dialog (const gchar *title,
+                  gint         line_count,
+                  gint        *first,
+                  gint        *last)
+{
+  GtkWidget *dialog;
+  GtkWidget *content_area;
+  GtkWidget *grid;
+  RangeDialog range;
+  gboolean result = FALSE;
+
+  dialog = gtk_dialog_new_with_buttons (title, NULL, 
+                                        GTK_DIALOG_MODAL,
+                                        GTK_STOCK_CANCEL, GTK_RESPONSE_CANCEL,
+                                        GTK_STOCK_OK, GTK_RESPONSE_OK, NULL);
+  gtk_dialog_set_default_response (GTK_DIALOG (dialog), GTK_RESPONSE_OK);
+  gtk_window_set_skip_taskbar_hint (GTK_WINDOW (dialog), TRUE);
+  gtk_window_set_skip_pager_hint (GTK_WINDOW (dialog), TRUE);
+
+  content_area = gtk_dialog_get_content_area (GTK_DIALOG (dialog));
+  grid = gtk_grid_new ();
+  gtk_grid_set_row_spacing (GTK_GRID (grid), 4);
+  gtk_grid_set_column_spacing (GTK_GRID (grid), 4);
+  gtk_container_set_border_width (GTK_CONTAINER (grid), 4);
+
+  range.from = gtk_spin_button_new_with_range (1, line_count, 1);
+  range.to = gtk_spin_button_new_with_range (1, line_count, 1);
+  range.count = gtk_spin_button_new_with_range (1, line_count, 1);
+  gtk_spin_button_set_value (GTK_SPIN_BUTTON (range.from), *first + 1);
+  gtk_spin_button_set_value (GTK_SPIN_BUTTON (range.to), *first + 1);
+  gtk_entry_set_activates_default (GTK_ENTRY (range.from), TRUE);
+  gtk_entry_set_activates_default (GTK_ENTRY (range.to), TRUE);
+  gtk_entry_set_activates_default (GTK_ENTRY (range.count), TRUE);
+
+  gtk_grid_attach (GTK_GRID (grid), gtk_label_new ("From line:"), 0, 0, 1, 1);
+  gtk_grid_attach (GTK_GRID (grid), range.from, 1, 0, 1, 1);
+  gtk_grid_attach (GTK_GRID (grid), gtk_label_new ("To line:"), 0, 1, 1, 1);
+  gtk_grid_attach (GTK_GRID (grid), range.to, 1, 1, 1, 1);
+  gtk_grid_attach (GTK_GRID (grid), gtk_label_new ("Lines:"), 0, 2, 1, 1);
+  gtk_grid_attach (GTK_GRID (grid), range.count, 1, 2, 1, 1);
+
+  g_signal_connect_swapped (G_OBJECT (range.from), "value-changed",
+                            G_CALLBACK (range_from_changed), &range);
+  g_signal_connect_swapped (G_OBJECT (range.to), "value-changed",
+                            G_CALLBACK (range_to_changed), &range);
+  g_signal_connect_swapped (G_OBJECT (range.count), "value-changed",
+                            G_CALLBACK (range_count_changed), &range);
+
+  gtk_container_add (GTK_CONTAINER (content_area), grid);
+  gtk_widget_show_all (content_area);
+
+  if (gtk_dialog_run (GTK_DIALOG (dialog)) == GTK_RESPONSE_OK)
+    {
+      *first = gtk_spin_button_get_value_as_int (GTK_SPIN_BUTTON (range.from)) - 1;
+      *last = gtk_spin_button_get_value_as_int (GTK_SPIN_BUTTON (range.to)) - 1;
+      result = *first <= *last;
+    }
+
+  gtk_widget_destroy (dialog);
+
+  return result;
+}
+
+static void
+range_from_changed (RangeDialog *range)
+{
+  gint from;
+  gint count;
+  from = gtk_spin_button_get_value_as_int (GTK_SPIN_BUTTON (range->from));
+  count = gtk_spin_button_get_value_as_int (GTK_SPIN_BUTTON (range->count));
+  gtk_spin_button_set_value (GTK_SPIN_BUTTON (range->to), from + count - 1);
+}
+
+static void
+range_to_changed (RangeDialog *range)
+{
+  gint from;
+  gint to;
+  from = gtk_spin_button_get_value_as_int (GTK_SPIN_BUTTON (range->from));
+  to = gtk_spin_button_get_value_as_int (GTK_SPIN_BUTTON (range->to));
+  gtk_spin_button_set_value (GTK_SPIN_BUTTON (range->count), to - from + 1);
+}
+
+static void
+range_count_changed (RangeDialog *range)
+{
+  gint from;
+  gint count;
+  from = gtk_spin_button_get_value_as_int (GTK_SPIN_BUTTON (range->from));
+  count = gtk_spin_button_get_value_as_int (GTK_SPIN_BUTTON (range->count));
+  gtk_spin_button_set_value (GTK_SPIN_BUTTON (range->to), from + count - 1);
+}
+
+static void 
+comment_matching_action (CommentsEngine *engine)
+{
+  CommentsEnginePrivate *priv;
+  CodeSlayerDocument *document;
+  GtkSourceView *source_view;
+  GtkTextBuffer *buffer;
+  GtkTextIter buffer_start, buffer_end;
+  CommentsConfig *config;
+  GError *error = NULL;
+  gchar *pattern;
+  gboolean regex;
+  GArray *lines;
+  gchar *text;
+  gint64 start_time;
+  EditJob *job;
+  
+  priv = COMMENTS_ENGINE_GET_PRIVATE (engine);
+
+  if (priv->applier != NULL)
+    return;
+
+  document = codeslayer_get_active_document (priv->codeslayer);
+  
+  if (document == NULL)
+    return;
+
+  config = get_config (engine, document);
+  if (config == NULL)
+    return;
+
+  if (!run_pattern_dialog (&pattern, &regex))
+    return;
+
+  start_time = g_get_monotonic_time ();
+
+  source_view = codeslayer_document_get_source_view (document);
+  buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (source_view));
+
+  gtk_text_buffer_get_bounds (buffer, &buffer_start, &buffer_end);
+  text = gtk_text_buffer_get_text (buffer, &buffer_start, &buffer_end, TRUE);
+
+  TRACE_ACTION_START (engine, config, strlen (text), count_lines (text));
+
+  lines = comments_transform_match_lines (text, -1, pattern, regex, &error);
+
   g_free (pattern);
-  g_free (escape_start);
 
-  return result;
+  if (lines == NULL)
+    {
+      g_warning ("Comment Matching Lines: %s", error->message);
+      g_error_free (error);
+      g_free (text);
+      TRACE_ACTION_DONE (0);
+      return;
+    }
+
+  if (lines->len == 0)
+    {
+      TRACE_ACTION_DONE (0);
+      record_action (engine, "comment-matching", 1, document, config, text, 
+                     start_time);
+      g_array_free (lines, TRUE);
+      g_free (text);
+      return;
+    }
+
+  gtk_text_buffer_get_iter_at_line (buffer, &buffer_start, 
+                                    g_array_index (lines, guint, 0));
+  gtk_text_buffer_get_iter_at_line (buffer, &buffer_end, 
+                                    g_array_index (lines, guint, lines->len - 1));
+  if (!gtk_text_iter_ends_line (&buffer_end))
+    gtk_text_iter_forward_to_line_end (&buffer_end);
+
+  job = new_line_job (engine, document, config, "comment-matching", TRUE, 
+                      start_time);
+  job->text = text;
+  job->n_lines = lines->len;
+  job->lines = (guint *) g_array_free (lines, FALSE);
+
+  begin_bulk_edit (engine, buffer, &buffer_start, &buffer_end, &job->bulk);
+  start_edit_job (job, &buffer_start, (CommentsApplierFunc) line_job_step, 
+                  (CommentsApplierDoneFunc) line_job_done);
+}
+
+static void 
+strip_comments_action (CommentsEngine *engine)
+{
+  CommentsEnginePrivate *priv;
+  CodeSlayerDocument *document;
+  GtkSourceView *source_view;
+  GtkTextBuffer *buffer;
+  GtkTextIter buffer_start, buffer_end;
+  CommentsConfig *config;
+  CommentsStripper *stripper;
+  gchar *text;
+  gchar *stripped;
+  gint64 start_time;
+  
+  priv = COMMENTS_ENGINE_GET_PRIVATE (engine);
+
+  if (priv->applier != NULL)
+    return;
+
+  start_time = g_get_monotonic_time ();
+
+  document = codeslayer_get_active_document (priv->codeslayer);
+  
+  if (document == NULL)
+    return;
+
+  config = get_config (engine, document);
+  if (config == NULL)
+    return;
+
+  source_view = codeslayer_document_get_source_view (document);
+  buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (source_view));
+
+  gtk_text_buffer_get_bounds (buffer, &buffer_start, &buffer_end);
+  text = gtk_text_buffer_get_text (buffer, &buffer_start, &buffer_end, TRUE);
+
+  TRACE_ACTION_START (engine, config, strlen (text), count_lines (text));
+
+  stripper = comments_stripper_new (config);
+  stripped = comments_stripper_strip (stripper, text, -1);
+  g_object_unref (stripper);
+
+  if (g_strcmp0 (text, stripped) != 0)
+    {
+      BulkEdit bulk;
+
+      begin_bulk_edit (engine, buffer, &buffer_start, &buffer_end, &bulk);
+      gtk_text_buffer_begin_user_action (buffer);
+      gtk_text_buffer_delete (buffer, &buffer_start, &buffer_end);
+      gtk_text_buffer_insert (buffer, &buffer_start, stripped, -1);
+      gtk_text_buffer_end_user_action (buffer);
+      end_bulk_edit (&bulk, source_view);
+
+      TRACE_ACTION_DONE (strlen (stripped));
+    }
+  else
+    {
+      TRACE_ACTION_DONE (0);
+    }
+
+  record_action (engine, "strip-comments", 1, document, config, text, start_time);
+
+  g_free (stripped);
+  g_free (text);
+}
+
+/*
+ * Rewraps the comment block at the cursor, or the selected lines, to
+ * REFLOW_WIDTH columns. The new text goes in as one replace edit, so it is
+ * undone in one step however long the comment is.
+ */
+static void 
+reflow_comment_action (CommentsEngine *engine)
+{
+  CommentsEnginePrivate *priv;
+  CodeSlayerDocument *document;
+  GtkSourceView *source_view;
+  GtkTextBuffer *buffer;
+  GtkTextIter selection_start, selection_end;
+  CommentsConfig *config;
+  GString *result;
+  EditJob *job;
+  const gchar *start;
+  const gchar *end;
+  gchar *text;
+  gint first;
+  gint last;
+  gint64 start_time;
+  
+  priv = COMMENTS_ENGINE_GET_PRIVATE (engine);
+
+  if (priv->applier != NULL)
+    return;
+
+  start_time = g_get_monotonic_time ();
+
+  document = codeslayer_get_active_document (priv->codeslayer);
+  
+  if (document == NULL)
+    return;
+
+  source_view = codeslayer_document_get_source_view (document);
+  buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (source_view));
+
+  gtk_text_buffer_get_selection_bounds (buffer, &selection_start, &selection_end);
+
+  config = get_region_config (engine, document, &selection_start);
+  if (config == NULL)
+    return;
+
+  start = comments_config_get_start (config);
+  end = comments_config_get_end (config);
+
+  first = gtk_text_iter_get_line (&selection_start);
+  last = gtk_text_iter_get_line (&selection_end);
+
+  if (first == last && gtk_text_iter_equal (&selection_start, &selection_end))
+    {
+      if (!comments_blocks_find (buffer, start, end, first, COMMENTS_BLOCKS_AT, 
+                                 &first, &last))
+        return;
+    }
+  else if (last > first && gtk_text_iter_starts_line (&selection_end))
+    {
+      last--;
+    }
+
+  gtk_text_buffer_get_iter_at_line (buffer, &selection_start, first);
+  gtk_text_buffer_get_iter_at_line (buffer, &selection_end, last);
+  if (!gtk_text_iter_ends_line (&selection_end))
+    gtk_text_iter_forward_to_line_end (&selection_end);
+
+  text = gtk_text_buffer_get_text (buffer, &selection_start, &selection_end, FALSE);
+
+  TRACE_ACTION_START (engine, config, strlen (text), last - first + 1);
+
+  TRACE_TRANSFORM_START ("reflow_comment", strlen (text));
+
+  result = comments_arena_take (priv->arena);
+  comments_transform_reflow (result, text, -1, start, end, REFLOW_WIDTH, 
+                             gtk_source_view_get_tab_width (source_view), 
+                             get_eol (buffer));
+
+  TRACE_TRANSFORM_DONE ("reflow_comment", result->len);
+
+  if (g_strcmp0 (result->str, text) == 0)
+    {
+      TRACE_ACTION_DONE (0);
+      record_action (engine, "reflow-comment", 1, document, config, text, 
+                     start_time);
+      g_free (text);
+      comments_arena_reset (priv->arena);
+      return;
+    }
+
+  job = new_edit_job (engine, document, config, "reflow-comment", 1, start_time);
+  job->text = text;
+  job->replace = result->str;
+  job->length = result->len;
+  job->start_mark = gtk_text_buffer_create_mark (buffer, NULL, 
+                                                 &selection_start, TRUE);
+  job->end_mark = gtk_text_buffer_create_mark (buffer, NULL, 
+                                               &selection_end, FALSE);
+
+  begin_bulk_edit (engine, buffer, &selection_start, &selection_end, &job->bulk);
+  start_edit_job (job, &selection_start, 
+                  (CommentsApplierFunc) replace_job_step, 
+                  (CommentsApplierDoneFunc) replace_job_done);
+}
+
+/*
+ * Turns the line comments at the cursor, or on the selected lines, into a
+ * block comment, or the block comment there into line comments, using
+ * the two styles the config holds. Like a reflow the new text goes in as
+ * one replace edit.
+ */
+static void 
+convert_comment_style_action (CommentsEngine *engine)
+{
+  CommentsEnginePrivate *priv;
+  CodeSlayerDocument *document;
+  GtkSourceView *source_view;
+  GtkTextBuffer *buffer;
+  GtkTextIter selection_start, selection_end;
+  CommentsConfig *config;
+  GString *result;
+  EditJob *job;
+  const gchar *line;
+  const gchar *start;
+  const gchar *end;
+  gchar *text;
+  gint first;
+  gint last;
+  gint64 start_time;
+  
+  priv = COMMENTS_ENGINE_GET_PRIVATE (engine);
+
+  if (priv->applier != NULL)
+    return;
+
+  start_time = g_get_monotonic_time ();
+
+  document = codeslayer_get_active_document (priv->codeslayer);
+  
+  if (document == NULL)
+    return;
+
+  source_view = codeslayer_document_get_source_view (document);
+  buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (source_view));
+
+  gtk_text_buffer_get_selection_bounds (buffer, &selection_start, &selection_end);
+
+  config = get_region_config (engine, document, &selection_start);
+  if (config == NULL)
+    return;
+
+  line = comments_config_get_line_style (config);
+  if (line == NULL || !comments_config_get_block_style (config, &start, &end))
+    return;
+
+  first = gtk_text_iter_get_line (&selection_start);
+  last = gtk_text_iter_get_line (&selection_end);
+
+  if (first == last && gtk_text_iter_equal (&selection_start, &selection_end))
+    {
+      if (!comments_blocks_find (buffer, line, NULL, first, COMMENTS_BLOCKS_AT, 
+                                 &first, &last) &&
+          !comments_blocks_find (buffer, start, end, first, COMMENTS_BLOCKS_AT, 
+                                 &first, &last))
+        return;
+    }
+  else if (last > first && gtk_text_iter_starts_line (&selection_end))
+    {
+      last--;
+    }
+
+  gtk_text_buffer_get_iter_at_line (buffer, &selection_start, first);
+  gtk_text_buffer_get_iter_at_line (buffer, &selection_end, last);
+  if (!gtk_text_iter_ends_line (&selection_end))
+    gtk_text_iter_forward_to_line_end (&selection_end);
+
+  text = gtk_text_buffer_get_text (buffer, &selection_start, &selection_end, FALSE);
+
+  TRACE_ACTION_START (engine, config, strlen (text), last - first + 1);
+
+  TRACE_TRANSFORM_START ("convert_comment_style", strlen (text));
+
+  result = comments_arena_take (priv->arena);
+  comments_transform_convert (result, text, -1, line, start, end, 
+                              get_eol (buffer));
+
+  TRACE_TRANSFORM_DONE ("convert_comment_style", result->len);
+
+  if (g_strcmp0 (result->str, text) == 0)
+    {
+      TRACE_ACTION_DONE (0);
+      record_action (engine, "convert-comment-style", 1, document, config, 
+                     text, start_time);
+      g_free (text);
+      comments_arena_reset (priv->arena);
+      return;
+    }
+
+  job = new_edit_job (engine, document, config, "convert-comment-style", 1, 
+                      start_time);
+  job->text = text;
+  job->replace = result->str;
+  job->length = result->len;
+  job->start_mark = gtk_text_buffer_create_mark (buffer, NULL, 
+                                                 &selection_start, TRUE);
+  job->end_mark = gtk_text_buffer_create_mark (buffer, NULL, 
+                                               &selection_end, FALSE);
+
+  begin_bulk_edit (engine, buffer, &selection_start, &selection_end, &job->bulk);
+  start_edit_job (job, &selection_start, 
+                  (CommentsApplierFunc) replace_job_step, 
+                  (CommentsApplierDoneFunc) replace_job_done);
+}
+
+static void 
+next_comment_block_action (CommentsEngine *engine)
+{
+  find_comment_block (engine, COMMENTS_BLOCKS_NEXT);
+}
+
+static void 
+previous_comment_block_action (CommentsEngine *engine)
+{
+  find_comment_block (engine, COMMENTS_BLOCKS_PREVIOUS);
+}
+
+static void 
+select_comment_block_action (CommentsEngine *engine)
+{
+  find_comment_block (engine, COMMENTS_BLOCKS_AT);
+}
+
+/*
+ * The blocks come from an index kept on the buffer and brought up to date 
+ * with the edits made since it was last asked, so moving between blocks 
+ * does not read the whole document. The cursor goes to the top of the 
+ * block found, or the block is selected when looking for the one at the 
+ * cursor.
+ */
+static void
+find_comment_block (CommentsEngine       *engine,
+                    CommentsBlocksSearch  search)
+{
+  CommentsEnginePrivate *priv;
+  CodeSlayerDocument *document;
+  GtkSourceView *source_view;
+  GtkTextBuffer *buffer;
+  GtkTextIter iter;
+  GtkTextIter start, end;
+  CommentsConfig *config;
+  gint first;
+  gint last;
+  
+  priv = COMMENTS_ENGINE_GET_PRIVATE (engine);
+
+  document = codeslayer_get_active_document (priv->codeslayer);
+  
+  if (document == NULL)
+    return;
+
+  source_view = codeslayer_document_get_source_view (document);
+  buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (source_view));
+
+  gtk_text_buffer_get_iter_at_mark (buffer, &iter, 
+                                    gtk_text_buffer_get_insert (buffer));
+
+  config = get_region_config (engine, document, &iter);
+  if (config == NULL)
+    return;
+
+  if (!comments_blocks_find (buffer, comments_config_get_start (config), 
+                             comments_config_get_end (config), 
+                             gtk_text_iter_get_line (&iter), search, 
+                             &first, &last))
+    return;
+
+  gtk_text_buffer_get_iter_at_line (buffer, &start, first);
+
+  if (search == COMMENTS_BLOCKS_AT)
+    {
+      gtk_text_buffer_get_iter_at_line (buffer, &end, last);
+      if (!gtk_text_iter_ends_line (&end))
+        gtk_text_iter_forward_to_line_end (&end);
+      gtk_text_buffer_select_range (buffer, &start, &end);
+    }
+  else
+    {
+      gtk_text_buffer_place_cursor (buffer, &start);
+    }
+
+  gtk_text_view_scroll_mark_onscreen (GTK_TEXT_VIEW (source_view), 
+                                      gtk_text_buffer_get_insert (buffer));
+}
+
+/*
+ * The project of the active document is scanned on a thread of its own,
+ * which in turn fans the files out over a thread pool, so the editor stays
+ * usable while a big tree is counted. The thread holds a reference to the
+ * config snapshot that was current when it started.
+ */
+static void 
+density_report_action (CommentsEngine *engine)
+{
+  CommentsEnginePrivate *priv;
+  CodeSlayerDocument *document;
+  ReportJob *job;
+  gchar *folder_path;
+  
+  priv = COMMENTS_ENGINE_GET_PRIVATE (engine);
+
+  if (priv->scanning)
+    return;
+
+  document = codeslayer_get_active_document (priv->codeslayer);
+  if (document == NULL)
+    return;
+
+  folder_path = get_project_folder_path (document);
+  if (folder_path == NULL)
+    return;
+
+  priv->scanning = TRUE;
+
+  job = g_new0 (ReportJob, 1);
+  job->engine = g_object_ref (engine);
+  job->folder_path = folder_path;
+  job->snapshot = comments_publisher_acquire (priv->publisher);
+
+  g_thread_unref (g_thread_new ("comments-report", 
+                                (GThreadFunc) density_report_thread, job));
+}
+
+static gpointer
+density_report_thread (ReportJob *job)
+{
+  job->stats = comments_scanner_scan (job->folder_path, job->snapshot->configs);
+  g_idle_add ((GSourceFunc) density_report_done, job);
+  return NULL;
+}
+
+static gboolean
+density_report_done (ReportJob *job)
+{
+  CommentsEnginePrivate *priv;
+  GtkWidget *report;
+
+  priv = COMMENTS_ENGINE_GET_PRIVATE (job->engine);
+  priv->scanning = FALSE;
+
+  report = comments_report_new (job->folder_path, job->stats);
+
+  while (gtk_dialog_run (GTK_DIALOG (report)) == COMMENTS_REPORT_RESPONSE_SAVE)
+    comments_report_save_csv (COMMENTS_REPORT (report));
+
+  gtk_widget_destroy (report);
+
+  g_ptr_array_unref (job->stats);
+  comments_snapshot_unref (job->snapshot);
+  g_free (job->folder_path);
+  g_object_unref (job->engine);
+  g_free (job);
+
+  return FALSE;
+}
+
+/*
+ * Looks for commented-out code on a worker thread, the same way as the
+ * density report. The detector keeps its index between runs, so only the
+ * files that changed since the last search are read again. The findings
+ * stay open next to the editor so each one can be visited in turn.
+ */
+static void 
+find_commented_code_action (CommentsEngine *engine)
+{
+  CommentsEnginePrivate *priv;
+  CodeSlayerDocument *document;
+  FindJob *job;
+  gchar *folder_path;
+  
+  priv = COMMENTS_ENGINE_GET_PRIVATE (engine);
+
+  if (priv->scanning)
+    return;
+
+  document = codeslayer_get_active_document (priv->codeslayer);
+  if (document == NULL)
+    return;
+
+  folder_path = get_project_folder_path (document);
+  if (folder_path == NULL)
+    return;
+
+  priv->scanning = TRUE;
+
+  job = g_new0 (FindJob, 1);
+  job->engine = g_object_ref (engine);
+  job->folder_path = folder_path;
+  job->snapshot = comments_publisher_acquire (priv->publisher);
+
+  g_thread_unref (g_thread_new ("comments-detector", 
+                                (GThreadFunc) find_commented_code_thread, job));
+}
+
+static gpointer
+find_commented_code_thread (FindJob *job)
+{
+  CommentsEnginePrivate *priv;
+  priv = COMMENTS_ENGINE_GET_PRIVATE (job->engine);
+  job->detections = comments_detector_scan (priv->detector, job->folder_path, 
+                                            job->snapshot->configs);
+  g_idle_add ((GSourceFunc) find_commented_code_done, job);
+  return NULL;
+}
+
+static gboolean
+find_commented_code_done (FindJob *job)
+{
+  CommentsEnginePrivate *priv;
+  GtkWidget *findings;
+
+  priv = COMMENTS_ENGINE_GET_PRIVATE (job->engine);
+  priv->scanning = FALSE;
+
+  findings = comments_findings_new (job->folder_path, job->detections);
+
+  g_signal_connect_swapped (G_OBJECT (findings), "select-detection",
+                            G_CALLBACK (select_detection_action), job->engine);
+  g_signal_connect (G_OBJECT (findings), "response",
+                    G_CALLBACK (gtk_widget_destroy), NULL);
+
+  gtk_widget_show (findings);
+
+  g_ptr_array_unref (job->detections);
+  comments_snapshot_unref (job->snapshot);
+  g_free (job->folder_path);
+  g_object_unref (job->engine);
+  g_free (job);
+
+  return FALSE;
+}
+
+static void
+select_detection_action (CommentsEngine    *engine,
+                         CommentsDetection *detection)
+{
+  CommentsEnginePrivate *priv;
+  CodeSlayerDocument *active;
+  CodeSlayerDocument *document;
+  
+  priv = COMMENTS_ENGINE_GET_PRIVATE (engine);
+
+  document = codeslayer_document_new ();
+  codeslayer_document_set_file_path (document, detection->file_path);
+  codeslayer_document_set_line_number (document, detection->first_line);
+
+  active = codeslayer_get_active_document (priv->codeslayer);
+  if (active != NULL && codeslayer_document_get_project (active) != NULL)
+    codeslayer_document_set_project (document, 
+                                     codeslayer_document_get_project (active));
+
+  codeslayer_select_document (priv->codeslayer, document);
+  g_object_unref (document);
+}
+
+/*
+ * Adds the license header to the active document, or brings its header up
+ * to date. Only the text that changed at the top is replaced, in one edit.
+ */
+static void 
+update_license_header_action (CommentsEngine *engine)
+{
+  CommentsEnginePrivate *priv;
+  CodeSlayerDocument *document;
+  GtkSourceView *source_view;
+  GtkTextBuffer *buffer;
+  GtkTextIter buffer_start, buffer_end;
+  CommentsConfig *config;
+  CommentsLicense *license;
+  CommentsLicenseState state;
+  GString *result;
+  EditJob *job;
+  gchar *text;
+  gsize length;
+  gsize suffix = 0;
+  gint64 start_time;
+  
+  priv = COMMENTS_ENGINE_GET_PRIVATE (engine);
+
+  if (priv->applier != NULL)
+    return;
+
+  start_time = g_get_monotonic_time ();
+
+  document = codeslayer_get_active_document (priv->codeslayer);
+  
+  if (document == NULL)
+    return;
+
+  config = get_config (engine, document);
+  if (config == NULL)
+    return;
+
+  license = load_license (engine, "Update License Header");
+  if (license == NULL)
+    return;
+
+  source_view = codeslayer_document_get_source_view (document);
+  buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (source_view));
+
+  gtk_text_buffer_get_bounds (buffer, &buffer_start, &buffer_end);
+  text = gtk_text_buffer_get_text (buffer, &buffer_start, &buffer_end, TRUE);
+  length = strlen (text);
+
+  TRACE_ACTION_START (engine, config, length, count_lines (text));
+
+  result = comments_arena_take (priv->arena);
+  state = comments_license_apply (license, result, text, length, config, TRUE);
+  comments_license_free (license);
+
+  if (state != COMMENTS_LICENSE_ADDED && state != COMMENTS_LICENSE_REPLACED)
+    {
+      TRACE_ACTION_DONE (0);
+      record_action (engine, "update-license-header", 1, document, config, 
+                     text, start_time);
+      g_free (text);
+      comments_arena_reset (priv->arena);
+      return;
+    }
+
+  /* the end of the text is the same, and is kept, back to a whole character */
+  while (suffix < length && suffix < result->len &&
+         text[length - suffix - 1] == result->str[result->len - suffix - 1])
+    suffix++;
+  while (suffix > 0 && (text[length - suffix] & 0xc0) == 0x80)
+    suffix--;
+
+  gtk_text_buffer_get_iter_at_offset (buffer, &buffer_end, 
+                                      g_utf8_pointer_to_offset (text, text + length - suffix));
+
+  job = new_edit_job (engine, document, config, "update-license-header", 1, 
+                      start_time);
+  job->text = text;
+  job->replace = result->str;
+  job->length = result->len - suffix;
+  job->start_mark = gtk_text_buffer_create_mark (buffer, NULL, 
+                                                 &buffer_start, TRUE);
+  job->end_mark = gtk_text_buffer_create_mark (buffer, NULL, 
+                                               &buffer_end, FALSE);
+
+  begin_bulk_edit (engine, buffer, &buffer_start, &buffer_end, &job->bulk);
+  start_edit_job (job, &buffer_start, 
+                  (CommentsApplierFunc) replace_job_step, 
+                  (CommentsApplierDoneFunc) replace_job_done);
+}
+
+/*
+ * Updates the headers of the whole project on a worker thread, the same
+ * way as the density report, and says what was done when it is finished.
+ * Each project has a cache of its own in the plugin's config folder.
+ */
+static void 
+update_license_headers_action (CommentsEngine *engine)
+{
+  CommentsEnginePrivate *priv;
+  CodeSlayerDocument *document;
+  CommentsLicense *license;
+  LicenseJob *job;
+  gchar *folder_path;
+  gchar *config_folder_path;
+  gchar *cache_name;
+  
+  priv = COMMENTS_ENGINE_GET_PRIVATE (engine);
+
+  if (priv->scanning)
+    return;
+
+  document = codeslayer_get_active_document (priv->codeslayer);
+  if (document == NULL)
+    return;
+
+  folder_path = get_project_folder_path (document);
+  if (folder_path == NULL)
+    return;
+
+  license = load_license (engine, "Update License Headers");
+  if (license == NULL)
+    {
+      g_free (folder_path);
+      return;
+    }
+
+  priv->scanning = TRUE;
+
+  config_folder_path = codeslayer_get_plugins_config_folder_path (priv->codeslayer);  
+  cache_name = g_strdup_printf ("license-%08x.cache", g_str_hash (folder_path));
+
+  job = g_new0 (LicenseJob, 1);
+  job->engine = g_object_ref (engine);
+  job->folder_path = folder_path;
+  job->cache_path = g_build_filename (config_folder_path, cache_name, NULL);
+  job->snapshot = comments_publisher_acquire (priv->publisher);
+  job->license = license;
+
+  g_free (config_folder_path);
+  g_free (cache_name);
+
+  g_thread_unref (g_thread_new ("comments-license", 
+                                (GThreadFunc) update_license_headers_thread, job));
+}
+
+static gpointer
+update_license_headers_thread (LicenseJob *job)
+{
+  comments_license_update (job->license, job->folder_path, job->snapshot->configs, 
+                           job->cache_path, TRUE, FALSE, &job->stats);
+  g_idle_add ((GSourceFunc) update_license_headers_done, job);
+  return NULL;
+}
+
+static gboolean
+update_license_headers_done (LicenseJob *job)
+{
+  CommentsEnginePrivate *priv;
+  GtkWidget *dialog;
+
+  priv = COMMENTS_ENGINE_GET_PRIVATE (job->engine);
+  priv->scanning = FALSE;
+
+  dialog = gtk_message_dialog_new (NULL, GTK_DIALOG_MODAL, 
+                                   job->stats.failed > 0 ? GTK_MESSAGE_WARNING : GTK_MESSAGE_INFO, 
+                                   GTK_BUTTONS_CLOSE, 
+                                   "%u added, %u replaced, %u current, %u failed", 
+                                   job->stats.added, job->stats.replaced, 
+                                   job->stats.current, job->stats.failed);
+  gtk_window_set_title (GTK_WINDOW (dialog), "Update License Headers");
+  gtk_window_set_skip_taskbar_hint (GTK_WINDOW (dialog), TRUE);
+  gtk_window_set_skip_pager_hint (GTK_WINDOW (dialog), TRUE);
+
+  gtk_dialog_run (GTK_DIALOG (dialog));
+  gtk_widget_destroy (dialog);
+
+  comments_license_free (job->license);
+  comments_snapshot_unref (job->snapshot);
+  g_free (job->cache_path);
+  g_free (job->folder_path);
+  g_object_unref (job->engine);
+  g_free (job);
+
+  return FALSE;
+}
+
+/*
+ * The header template is license.txt in the plugin's config folder, next
+ * to comments.xml.
+ */
+static CommentsLicense*
+load_license (CommentsEngine *engine,
+              const gchar    *title)
+{
+  CommentsEnginePrivate *priv;
+  CommentsLicense *license;
+  GError *error = NULL;
+  gchar *folder_path;
+  gchar *file_path;
+  gchar *contents;
+
+  priv = COMMENTS_ENGINE_GET_PRIVATE (engine);
+
+  folder_path = codeslayer_get_plugins_config_folder_path (priv->codeslayer);  
+  file_path = g_build_filename (folder_path, "license.txt", NULL);
+  g_free (folder_path);
+
+  if (!g_file_get_contents (file_path, &contents, NULL, &error))
+    {
+      g_warning ("%s: %s", title, error->message);
+      g_error_free (error);
+      g_free (file_path);
+      return NULL;
+    }
+
+  license = comments_license_new (contents);
+
+  g_free (contents);
+  g_free (file_path);
+
+  return license;
+}
+
+static gchar*
+get_project_folder_path (CodeSlayerDocument *document)
+{
+  CodeSlayerProject *project;
+  const gchar *file_path;
+
+  project = codeslayer_document_get_project (document);
+  if (project != NULL)
+    return g_strdup (codeslayer_project_get_folder_path (project));
+
+  file_path = codeslayer_document_get_file_path (document);
+  if (file_path == NULL)
+    return NULL;
+
+  return g_path_get_dirname (file_path);
+}
+
+static gboolean
+run_pattern_dialog (gchar    **pattern,
+                    gboolean  *regex)
+{
+  GtkWidget *dialog;
+  GtkWidget *content_area;
+  GtkWidget *vbox;
+  GtkWidget *entry;
+  GtkWidget *regex_button;
+  gboolean result = FALSE;
+
+  dialog = gtk_dialog_new_with_buttons ("Comment Matching Lines", NULL, 
+                                        GTK_DIALOG_MODAL,
+                                        GTK_STOCK_CANCEL, GTK_RESPONSE_CANCEL,
+                                        GTK_STOCK_OK, GTK_RESPONSE_OK, NULL);
+  gtk_dialog_set_default_response (GTK_DIALOG (dialog), GTK_RESPONSE_OK);
+  gtk_window_set_skip_taskbar_hint (GTK_WINDOW (dialog), TRUE);
+  gtk_window_set_skip_pager_hint (GTK_WINDOW (dialog), TRUE);
+
+  content_area = gtk_dialog_get_content_area (GTK_DIALOG (dialog));
+  vbox = gtk_box_new (GTK_ORIENTATION_VERTICAL, 4);
+  gtk_container_set_border_width (GTK_CONTAINER (vbox), 4);
+
+  entry = gtk_entry_new ();
+  gtk_entry_set_activates_default (GTK_ENTRY (entry), TRUE);
+  gtk_entry_set_width_chars (GTK_ENTRY (entry), 40);
+  regex_button = gtk_check_button_new_with_label ("Regular expression");
+
+  gtk_box_pack_start (GTK_BOX (vbox), entry, FALSE, FALSE, 0);
+  gtk_box_pack_start (GTK_BOX (vbox), regex_button, FALSE, FALSE, 0);
+  gtk_container_add (GTK_CONTAINER (content_area), vbox);
+  gtk_widget_show_all (content_area);
+
+  if (gtk_dialog_run (GTK_DIALOG (dialog)) == GTK_RESPONSE_OK)
+    {
+      const gchar *text;
+      text = gtk_entry_get_text (GTK_ENTRY (entry));
+      if (codeslayer_utils_has_text (text))
+        {
+          *pattern = g_strdup (text);
+          *regex = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (regex_button));
+          result = TRUE;
+        }
+    }
+
+  gtk_widget_destroy (dialog);
+
+  return result;
+}
+
+static void
+comment_range (CommentsArena  *arena,
+               GtkTextBuffer  *buffer,
+               CommentsConfig *config,
+               gint            first,
+               gint            last,
+               guint           tab_width)
+{
+  const gchar *start;
+  const gchar *end;
+  const gchar *prefix;
+  gboolean block;
+  gboolean indent;
+  guint column = 0;
+  gint line;
+
+  start = comments_config_get_start (config);
+  end = comments_config_get_end (config);
+  block = match_block_comment (start, end);
+  indent = !block && comments_config_get_indent (config);
+
+  prefix = get_prefix (arena, start, !block && comments_config_get_padding (config));
+
+  if (indent)
+    column = get_min_column (buffer, first, last - first + 1, NULL, tab_width);
+
+  gtk_text_buffer_begin_user_action (buffer);
+
+  for (line = first; line <= last; line++)
+    comment_line (buffer, line, prefix, end, block, indent, column, tab_width);
+
+  gtk_text_buffer_end_user_action (buffer);
+}
+
+static void
+uncomment_range (GtkTextBuffer  *buffer,
+                 CommentsConfig *config,
+                 gint            first,
+                 gint            last)
+{
+  const gchar *start;
+  const gchar *end;
+  gboolean block;
+  gboolean padding;
+  gint line;
+
+  start = comments_config_get_start (config);
+  end = comments_config_get_end (config);
+  block = match_block_comment (start, end);
+  padding = !block && comments_config_get_padding (config);
+
+  if (!codeslayer_utils_has_text (start))
+    return;
+
+  gtk_text_buffer_begin_user_action (buffer);
+
+  for (line = first; line <= last; line++)
+    uncomment_line (buffer, line, start, end, block, padding);
+
+  gtk_text_buffer_end_user_action (buffer);
+}
+
+/*
+ * When commenting at the indentation the delimiter goes in at column, the
+ * least indentation of the lines being commented, and blank lines are left
+ * alone, the same as the selection based transform does.
+ */
+static void
+comment_line (GtkTextBuffer *buffer,
+              gint           line,
+              const gchar   *prefix,
+              const gchar   *end,
+              gboolean       block,
+              gboolean       indent,
+              guint          column,
+              guint          tab_width)
+{
+  GtkTextIter iter;
+
+  if (indent)
+    {
+      guint at = 0;
+
+      gtk_text_buffer_get_iter_at_line (buffer, &iter, line);
+      if (!forward_indent (&iter, &at, column, tab_width))
+        return;
+    }
+  else
+    {
+      gtk_text_buffer_get_iter_at_line (buffer, &iter, line);
+    }
+
+  gtk_text_buffer_insert (buffer, &iter, prefix, -1);
+
+  if (block)
+    {
+      if (!gtk_text_iter_ends_line (&iter))
+        gtk_text_iter_forward_to_line_end (&iter);
+      gtk_text_buffer_insert (buffer, &iter, end, -1);
+    }
+}
+
+/*
+ * A line is only touched when its content starts with the start delimiter
+ * and, for block comments, also ends with the end delimiter. The end is
+ * removed first so the iter at the start of the line stays put.
+ */
+static void
+uncomment_line (GtkTextBuffer *buffer,
+                gint           line,
+                const gchar   *start,
+                const gchar   *end,
+                gboolean       block,
+                gboolean       padding)
+{
+  GtkTextIter content;
+  GtkTextIter start_end;
+
+  if (!get_line_content (buffer, line, &content) ||
+      !match_at_iter (&content, start, &start_end))
+    return;
+
+  if (block)
+    {
+      GtkTextIter end_start;
+      GtkTextIter end_end;
+      GtkTextIter line_end;
+
+      line_end = content;
+      if (!gtk_text_iter_ends_line (&line_end))
+        gtk_text_iter_forward_to_line_end (&line_end);
+
+      end_start = line_end;
+      gtk_text_iter_backward_chars (&end_start, g_utf8_strlen (end, -1));
+
+      if (gtk_text_iter_compare (&end_start, &start_end) < 0 ||
+          !match_at_iter (&end_start, end, &end_end) ||
+          !gtk_text_iter_equal (&end_end, &line_end))
+        return;
+
+      gtk_text_buffer_delete (buffer, &end_start, &end_end);
+      get_line_content (buffer, line, &content);
+      match_at_iter (&content, start, &start_end);
+    }
+  else if (padding && gtk_text_iter_get_char (&start_end) == ' ')
+    {
+      gtk_text_iter_forward_char (&start_end);
+    }
+
+  gtk_text_buffer_delete (buffer, &content, &start_end);
+}
+
+/*
+ * Point the iter at the first character on the line that is not a space or
+ * a tab. Returns FALSE when the line is blank.
+ */
+static gboolean
+get_line_content (GtkTextBuffer *buffer,
+                  gint           line,
+                  GtkTextIter   *iter)
+{
+  gtk_text_buffer_get_iter_at_line (buffer, iter, line);
+
+  while (!gtk_text_iter_ends_line (iter) &&
+         (gtk_text_iter_get_char (iter) == ' ' || 
+          gtk_text_iter_get_char (iter) == '\t'))
+    gtk_text_iter_forward_char (iter);
+
+  return !gtk_text_iter_ends_line (iter);
+}
+
+/*
+ * The least indentation, in columns, of the lines that are not blank.
+ */
+static guint
+get_min_column (GtkTextBuffer *buffer,
+                gint           first,
+                guint          n_lines,
+                const guint   *lines,
+                guint          tab_width)
+{
+  GtkTextIter iter;
+  guint min_column = G_MAXUINT;
+  guint i;
+
+  gtk_text_buffer_get_iter_at_line (buffer, &iter, first);
+
+  for (i = 0; i < n_lines; i++)
+    {
+      guint column = 0;
+
+      if (lines != NULL)
+        gtk_text_buffer_get_iter_at_line (buffer, &iter, lines[i]);
+      else if (i > 0)
+        gtk_text_iter_forward_line (&iter);
+
+      if (forward_indent (&iter, &column, G_MAXUINT, tab_width))
+        min_column = MIN (min_column, column);
+    }
+
+  return min_column;
+}
+
+/*
+ * Move the iter over the spaces and tabs at the start of a line, stopping
+ * before one that would take it past max_column. A tab that only partly
+ * fits is not split. Returns FALSE when the line is blank.
+ */
+static gboolean
+forward_indent (GtkTextIter *iter,
+                guint       *column,
+                guint        max_column,
+                guint        tab_width)
+{
+  GtkTextIter content;
+
+  if (tab_width == 0)
+    tab_width = 1;
+
+  while (!gtk_text_iter_ends_line (iter))
+    {
+      gunichar c = gtk_text_iter_get_char (iter);
+      guint next;
+
+      if (c == '\t')
+        next = *column + tab_width - (*column % tab_width);
+      else if (c == ' ')
+        next = *column + 1;
+      else
+        break;
+
+      if (next > max_column)
+        break;
+
+      *column = next;
+      gtk_text_iter_forward_char (iter);
+    }
+
+  content = *iter;
+  while (!gtk_text_iter_ends_line (&content) &&
+         (gtk_text_iter_get_char (&content) == ' ' || 
+          gtk_text_iter_get_char (&content) == '\t'))
+    gtk_text_iter_forward_char (&content);
+
+  return !gtk_text_iter_ends_line (&content);
+}
+
+static gboolean
+match_at_iter (const GtkTextIter *iter,
+               const gchar       *text,
+               GtkTextIter       *match_end)
+{
+  GtkTextIter pos = *iter;
+
+  while (*text != '\0')
+    {
+      if (gtk_text_iter_get_char (&pos) != g_utf8_get_char (text))
+        return FALSE;
+      gtk_text_iter_forward_char (&pos);
+      text = g_utf8_next_char (text);
+    }
+
+  *match_end = pos;
+  return TRUE;
+}
+
+static guint
+count_lines (const gchar *text)
+{
+  guint lines = 0;
+
+  if (text == NULL || *text == '\0')
+    return 0;
+
+  while ((text = strchr (text, '\n')) != NULL)
+    {
+      lines++;
+      text++;
+    }
+
+  return lines + 1;
+}
+
+/*
+ * Only worked out for the trace, so the copy is not worth avoiding.
+ */
+static gsize
+get_range_bytes (GtkTextBuffer     *buffer,
+                 const GtkTextIter *start,
+                 const GtkTextIter *end)
+{
+  gchar *text;
+  gsize length;
+
+  text = gtk_text_buffer_get_text (buffer, start, end, TRUE);
+  length = strlen (text);
+  g_free (text);
+
+  return length;
+}
+
+/*
+ * Large edits are applied with bracket highlighting switched off, so the
+ * matching bracket is not searched for after every piece. Switching syntax
+ * highlighting off and on again has the buffer strip and then invalidate
+ * the tags of all of its text, so it is only suspended when the edit
+ * covers at least 1/BULK_SYNTAX_SHARE of the buffer; a smaller edit is
+ * cheaper to let each piece invalidate just the text it touches. The
+ * affected range is tracked with marks.
+ */
+static void
+begin_bulk_edit (CommentsEngine *engine,
+                 GtkTextBuffer  *buffer,
+                 GtkTextIter    *start,
+                 GtkTextIter    *end,
+                 BulkEdit       *bulk)
+{
+  CommentsEnginePrivate *priv;
+  GtkSourceBuffer *source_buffer;
+
+  priv = COMMENTS_ENGINE_GET_PRIVATE (engine);
+
+  bulk->buffer = NULL;
+
+  if (priv->bulk_threshold < 0 || !GTK_SOURCE_IS_BUFFER (buffer) ||
+      gtk_text_iter_get_offset (end) - gtk_text_iter_get_offset (start) < 
+      priv->bulk_threshold)
+    return;
+
+  source_buffer = GTK_SOURCE_BUFFER (buffer);
+
+  bulk->buffer = source_buffer;
+  bulk->start = gtk_text_buffer_create_mark (buffer, NULL, start, TRUE);
+  bulk->end = gtk_text_buffer_create_mark (buffer, NULL, end, FALSE);
+  bulk->highlight_brackets = gtk_source_buffer_get_highlight_matching_brackets (source_buffer);
+  bulk->highlight_syntax = gtk_source_buffer_get_highlight_syntax (source_buffer);
+
+  gtk_source_buffer_set_highlight_matching_brackets (source_buffer, FALSE);
+
+  if (bulk->highlight_syntax &&
+      (gtk_text_iter_get_offset (end) - gtk_text_iter_get_offset (start)) * 
+      BULK_SYNTAX_SHARE >= gtk_text_buffer_get_char_count (buffer))
+    gtk_source_buffer_set_highlight_syntax (source_buffer, FALSE);
+  else
+    bulk->highlight_syntax = FALSE;
+}
+
+/*
+ * Switch highlighting back on and bring only the part of the edited range
+ * that is on screen up to date right away; the rest of it, and the rest
+ * of the buffer when syntax highlighting was suspended, is picked up
+ * lazily as it is scrolled into view.
+ */
+static void
+end_bulk_edit (BulkEdit      *bulk,
+               GtkSourceView *source_view)
+{
+  GtkTextBuffer *buffer;
+  GtkTextIter start, end;
+  GtkTextIter visible_start, visible_end;
+  GdkRectangle visible;
+
+  if (bulk->buffer == NULL)
+    return;
+
+  buffer = GTK_TEXT_BUFFER (bulk->buffer);
+
+  gtk_source_buffer_set_highlight_matching_brackets (bulk->buffer, 
+                                                     bulk->highlight_brackets);
+  if (bulk->highlight_syntax)
+    gtk_source_buffer_set_highlight_syntax (bulk->buffer, TRUE);
+
+  gtk_text_buffer_get_iter_at_mark (buffer, &start, bulk->start);
+  gtk_text_buffer_get_iter_at_mark (buffer, &end, bulk->end);
+  gtk_text_buffer_delete_mark (buffer, bulk->start);
+  gtk_text_buffer_delete_mark (buffer, bulk->end);
+
+  if (!gtk_source_buffer_get_highlight_syntax (bulk->buffer))
+    return;
+
+  gtk_text_view_get_visible_rect (GTK_TEXT_VIEW (source_view), &visible);
+  gtk_text_view_get_line_at_y (GTK_TEXT_VIEW (source_view), &visible_start, 
+                               visible.y, NULL);
+  gtk_text_view_get_line_at_y (GTK_TEXT_VIEW (source_view), &visible_end, 
+                               visible.y + visible.height, NULL);
+  gtk_text_iter_forward_line (&visible_end);
+
+  if (gtk_text_iter_compare (&start, &visible_start) < 0)
+    start = visible_start;
+  if (gtk_text_iter_compare (&end, &visible_end) > 0)
+    end = visible_end;
+
+  if (gtk_text_iter_compare (&start, &end) < 0)
+    gtk_source_buffer_ensure_highlight (bulk->buffer, &start, &end);
+}
+
+static CommentsConfig*
+get_config (CommentsEngine     *engine,
+            CodeSlayerDocument *document)
+{
+  CommentsResolver *resolver;
+  const gchar *file_path;
+  CommentsConfig *config;
+
+  COMMENTS_TRACE (get_config__start);
+
+  file_path = codeslayer_document_get_file_path (document);
+  
+  resolver = get_resolver (engine, document);
+  config = comments_resolver_lookup (resolver, file_path);
+
+  if (config == NULL)
+    config = sniff_config (document, resolver);
+
+  if (COMMENTS_TRACE_ENABLED (get_config__done))
+    COMMENTS_TRACE1 (get_config__done, 
+                     config != NULL ? get_config_id (engine, config) : -1);
+  return config;
+}
+
+/*
+ * The config for the language the text at iter is written in, which for a
+ * script or style embedded in a page is not the page's own.
+ */
+static CommentsConfig*
+get_region_config (CommentsEngine     *engine,
+                   CodeSlayerDocument *document,
+                   const GtkTextIter  *iter)
+{
+  const gchar *file_type;
+
+  file_type = comments_regions_lookup (gtk_text_iter_get_buffer (iter), 
+                                       codeslayer_document_get_file_path (document), 
+                                       iter);
+  if (file_type != NULL)
+    {
+      CommentsConfig *config;
+      config = comments_resolver_lookup (get_resolver (engine, document), file_type);
+      if (config != NULL)
+        return config;
+    }
+
+  return get_config (engine, document);
+}
+
+/*
+ * Fall back on the shebang or a modeline when the file path does not match
+ * any config. Only the first and last few hundred characters are read, and
+ * what was found is remembered on the buffer so it is sniffed once rather
+ * than on every action, until an edit reaches into either end.
+ */
+static CommentsConfig*
+sniff_config (CodeSlayerDocument *document,
+              CommentsResolver   *resolver)
+{
+  GtkSourceView *source_view;
+  GtkTextBuffer *buffer;
+  const gchar *suffix;
+
+  source_view = codeslayer_document_get_source_view (document);
+  buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (source_view));
+
+  suffix = g_object_get_data (G_OBJECT (buffer), SNIFFED_SUFFIX);
+
+  if (suffix == NULL)
+    {
+      GtkTextIter start, end;
+      gchar *head;
+      gchar *tail;
+
+      gtk_text_buffer_get_start_iter (buffer, &start);
+      gtk_text_buffer_get_iter_at_offset (buffer, &end, COMMENTS_SNIFFER_LENGTH);
+      head = gtk_text_buffer_get_text (buffer, &start, &end, TRUE);
+
+      gtk_text_buffer_get_end_iter (buffer, &end);
+      start = end;
+      gtk_text_iter_backward_chars (&start, COMMENTS_SNIFFER_LENGTH);
+      tail = gtk_text_buffer_get_text (buffer, &start, &end, TRUE);
+
+      suffix = comments_sniffer_sniff (head, strlen (head), tail, strlen (tail));
+
+      g_free (head);
+      g_free (tail);
+
+      /* an empty suffix records that nothing was found */
+      if (suffix == NULL)
+        suffix = "";
+
+      g_object_set_data (G_OBJECT (buffer), SNIFFED_SUFFIX, (gpointer) suffix);
+      g_signal_connect (buffer, "insert-text", 
+                        G_CALLBACK (sniff_insert_text), NULL);
+      g_signal_connect (buffer, "delete-range", 
+                        G_CALLBACK (sniff_delete_range), NULL);
+    }
+
+  if (*suffix == '\0')
+    return NULL;
+
+  return comments_resolver_lookup (resolver, suffix);
+}
+
+static void
+sniff_insert_text (GtkTextBuffer *buffer,
+                   GtkTextIter   *iter,
+                   const gchar   *text,
+                   gint           length)
+{
+  forget_sniffed_suffix (buffer, iter, iter);
+}
+
+static void
+sniff_delete_range (GtkTextBuffer *buffer,
+                    GtkTextIter   *start,
+                    GtkTextIter   *end)
+{
+  forget_sniffed_suffix (buffer, start, end);
+}
+
+/*
+ * An edit in the middle of the buffer leaves what the sniffer reads alone.
+ * One that reaches into the head or the tail drops the suffix, found or
+ * not, and the handlers with it until the buffer is sniffed again.
+ */
+static void
+forget_sniffed_suffix (GtkTextBuffer     *buffer,
+                       const GtkTextIter *start,
+                       const GtkTextIter *end)
+{
+  gint char_count;
+
+  char_count = gtk_text_buffer_get_char_count (buffer);
+
+  if (gtk_text_iter_get_offset (start) >= COMMENTS_SNIFFER_LENGTH &&
+      gtk_text_iter_get_offset (end) + COMMENTS_SNIFFER_LENGTH < char_count)
+    return;
+
+  g_object_set_data (G_OBJECT (buffer), SNIFFED_SUFFIX, NULL);
+  g_signal_handlers_disconnect_by_func (buffer, sniff_insert_text, NULL);
+  g_signal_handlers_disconnect_by_func (buffer, sniff_delete_range, NULL);
+}
+
+/*
+ * A project can keep its own comment configs in a .comments.xml file at
+ * the top of its folder. They are merged ahead of the global configs the
+ * first time a document from the project is acted on, and the compiled
+ * result is kept until the global configs change or the overlay's
+ * modification time or size does.
+ */
+static CommentsResolver*
+get_resolver (CommentsEngine     *engine,
+              CodeSlayerDocument *document)
+{
+  CommentsEnginePrivate *priv;
+  CodeSlayerProject *project;
+  ResolverEntry *entry;
+  CommentsSnapshot *snapshot;
+  const gchar *folder_path = "";
+  gchar *overlay_path = NULL;
+  GList *overlay = NULL;
+  gint64 mtime = -1;
+  goffset size = -1;
+
+  priv = COMMENTS_ENGINE_GET_PRIVATE (engine);
+
+  project = codeslayer_document_get_project (document);
+  if (project != NULL)
+    folder_path = codeslayer_project_get_folder_path (project);
+
+  if (*folder_path != '\0')
+    {
+      GStatBuf buf;
+
+      overlay_path = g_build_filename (folder_path, OVERLAY_FILE, NULL);
+      if (g_stat (overlay_path, &buf) == 0 && S_ISREG (buf.st_mode))
+        {
+          mtime = buf.st_mtime;
+          size = buf.st_size;
+        }
+    }
+
+  entry = g_hash_table_lookup (priv->resolvers, folder_path);
+  if (entry != NULL && entry->mtime == mtime && entry->size == size)
+    {
+      g_free (overlay_path);
+      return entry->resolver;
+    }
+
+  if (mtime != -1)
+    overlay = comments_config_load_list (overlay_path);
+  g_free (overlay_path);
+
+  entry = g_new0 (ResolverEntry, 1);
+  entry->mtime = mtime;
+  entry->size = size;
+
+  snapshot = comments_publisher_acquire (priv->publisher);
+  entry->resolver = comments_resolver_new (overlay, snapshot->configs);
+  comments_snapshot_unref (snapshot);
+  g_hash_table_replace (priv->resolvers, g_strdup (folder_path), entry);
+
+  g_list_foreach (overlay, (GFunc) g_object_unref, NULL);
+  g_list_free (overlay);
+
+  return entry->resolver;
+}
+
+static void
+resolver_entry_free (ResolverEntry *entry)
+{
+  comments_resolver_free (entry->resolver);
+  g_free (entry);
+}
+
+/*
+ * The line transforms only ever look at one line at a time, so the
+ * selection can be cut into chunks after any newline and each chunk
+ * transformed on its own.
+ */
+static void
+insert_lines (GString       *result,
+              const gchar   *text,
+              gsize          length,
+              LineTransform *transform)
+{
+  comments_transform_insert_line (result, text, length, transform->start, 
+                                  transform->eol);
+}
+
+static void
+remove_lines (GString       *result,
+              const gchar   *text,
+              gsize          length,
+              LineTransform *transform)
+{
+  comments_transform_remove_line (result, text, length, transform->start, 
+                                  transform->eol);
+}
+
+static void
+insert_line_comment (CommentsEngine *engine,
+                     GString        *result,
+                     const gchar    *selection, 
+                     gsize           length,
+                     const gchar    *start,
+                     CommentsEol     eol)
+{
+  CommentsEnginePrivate *priv;
+  LineTransform transform;
+
+  priv = COMMENTS_ENGINE_GET_PRIVATE (engine);
+
+  TRACE_TRANSFORM_START ("insert_line_comment", length);
+
+  transform.start = start;
+  transform.eol = eol;
+  comments_parallel_transform (priv->parallel, priv->arena, result, 
+                               selection, length, 
+                               (CommentsChunkFunc) insert_lines, &transform);
+
+  TRACE_TRANSFORM_DONE ("insert_line_comment", result->len);
+}
+
+static void
+remove_line_comment (CommentsEngine *engine,
+                     GString        *result,
+                     const gchar    *selection, 
+                     gsize           length,
+                     const gchar    *start,
+                     CommentsEol     eol)
+{
+  CommentsEnginePrivate *priv;
+  LineTransform transform;
+
+  priv = COMMENTS_ENGINE_GET_PRIVATE (engine);
+
+  TRACE_TRANSFORM_START ("remove_line_comment", length);
+
+  transform.start = start;
+  transform.eol = eol;
+  comments_parallel_transform (priv->parallel, priv->arena, result, 
+                               selection, length, 
+                               (CommentsChunkFunc) remove_lines, &transform);
+
+  TRACE_TRANSFORM_DONE ("remove_line_comment", result->len);
+}
+
+static void
+insert_indent_comment (GString     *result,
+                       const gchar *selection, 
+                       gsize        length,
+                       const gchar *start,
+                       gboolean     padding,
+                       guint        tab_width)
+{
+  TRACE_TRANSFORM_START ("insert_indent_comment", length);
+
+  comments_transform_insert_indented_line (result, selection, length, start, 
+                                           padding, tab_width);
+
+  TRACE_TRANSFORM_DONE ("insert_indent_comment", result->len);
+}
+
+static void
+remove_indent_comment (GString     *result,
+                       const gchar *selection, 
+                       gsize        length,
+                       const gchar *start,
+                       gboolean     padding,
+                       guint        tab_width)
+{
+  TRACE_TRANSFORM_START ("remove_indent_comment", length);
+
+  comments_transform_remove_indented_line (result, selection, length, start, 
+                                           padding);
+
+  TRACE_TRANSFORM_DONE ("remove_indent_comment", result->len);
 }
 
 static gboolean
@@ -419,51 +3057,357 @@ match_block_comment (const gchar *start,
   return FALSE;
 }
 
-static gchar*
-insert_block_comment (gchar       *selection, 
+static void
+insert_block_comment (GString     *result,
+                      const gchar *selection, 
+                      gsize        length,
                       const gchar *start,
-                      const gchar *end)
+                      const gchar *end,
+                      CommentsEol  eol)
 {
-  gchar *result;
-  GRegex *regex;
-  gchar *replacement;
+  TRACE_TRANSFORM_START ("insert_block_comment", length);
 
-  regex = g_regex_new ("^(\\s*)(.{1})((.|[\r\n])*)", 0, 0, NULL);
-  
-  replacement = g_strconcat ("\\1", start, "\\2\\3", end, "\n", NULL);
-  
-  result = g_regex_replace (regex, selection, -1, 0, replacement, 0, NULL);
-  
-  g_regex_unref (regex);
-  g_free (replacement);
+  comments_transform_insert_block (result, selection, length, start, end, eol);
 
-  return result;
+  TRACE_TRANSFORM_DONE ("insert_block_comment", result->len);
 }
 
-static gchar*
-remove_block_comment (gchar       *selection, 
+static void
+remove_block_comment (GString     *result,
+                      const gchar *selection, 
+                      gsize        length,
                       const gchar *start,
-                      const gchar *end)
+                      const gchar *end,
+                      CommentsEol  eol)
 {
-  gchar *result;
-  GRegex *regex;
-  gchar *pattern;
-  gchar *escape_start;
-  gchar *escape_end;
-  
-  escape_start = g_regex_escape_string (start, -1);  
-  escape_end = g_regex_escape_string (end, -1);  
-    
-  pattern = g_strconcat ("^(\\s*)(", escape_start, ")((.|[\\r\\n])*)(", escape_end, ")", NULL);
+  TRACE_TRANSFORM_START ("remove_block_comment", length);
 
-  regex = g_regex_new (pattern, 0, 0, NULL);
-  
-  result = g_regex_replace (regex, selection, -1, 0, "\\1\\3\n", 0, NULL);
-  
-  g_regex_unref (regex);
-  g_free (pattern);
-  g_free (escape_start);
-  g_free (escape_end);
+  comments_transform_remove_block (result, selection, length, start, end, eol);
 
-  return result;
+  TRACE_TRANSFORM_DONE ("remove_block_comment", result->len);
+}
+
+/*
+ * The start delimiter as it goes in front of a line, followed by a space
+ * when the config pads it.
+ */
+static const gchar*
+get_prefix (CommentsArena *arena,
+            const gchar   *start,
+            gboolean       padding)
+{
+  GString *prefix;
+
+  prefix = comments_arena_take (arena);
+  g_string_append (prefix, start);
+  if (padding)
+    g_string_append_c (prefix, ' ');
+
+  return prefix->str;
+}
+
+/*
+ * The line breaks of a buffer are worked out once, from a sample at each
+ * end, and kept on the buffer. Text inserted later is sampled as it comes
+ * in, so a file that starts mixing styles is noticed. Deleting text never
+ * makes the style any less mixed; that only costs a slower transform.
+ */
+static CommentsEol
+get_eol (GtkTextBuffer *buffer)
+{
+  GtkTextIter start, end;
+  GtkTextIter head_end, tail_start;
+  gpointer data;
+  CommentsEol eol;
+
+  data = g_object_get_data (G_OBJECT (buffer), BUFFER_EOL);
+  if (data != NULL)
+    return GPOINTER_TO_INT (data) - 1;
+
+  gtk_text_buffer_get_bounds (buffer, &start, &end);
+
+  head_end = start;
+  gtk_text_iter_forward_chars (&head_end, EOL_SAMPLE_LENGTH);
+
+  tail_start = end;
+  gtk_text_iter_backward_chars (&tail_start, EOL_SAMPLE_LENGTH);
+  if (gtk_text_iter_compare (&tail_start, &head_end) < 0)
+    tail_start = head_end;
+
+  eol = comments_transform_merge_eol (sample_eol (buffer, &start, &head_end), 
+                                      sample_eol (buffer, &tail_start, &end));
+
+  g_object_set_data (G_OBJECT (buffer), BUFFER_EOL, GINT_TO_POINTER (eol + 1));
+  g_signal_connect (buffer, "insert-text", G_CALLBACK (eol_insert_text), NULL);
+
+  return eol;
+}
+
+static CommentsEol
+sample_eol (GtkTextBuffer     *buffer,
+            const GtkTextIter *start,
+            const GtkTextIter *end)
+{
+  CommentsEol eol;
+  gchar *text;
+
+  text = gtk_text_buffer_get_slice (buffer, start, end, TRUE);
+  eol = comments_transform_detect_eol (text, -1);
+  g_free (text);
+
+  return eol;
+}
+
+static void
+eol_insert_text (GtkTextBuffer *buffer,
+                 GtkTextIter   *iter,
+                 const gchar   *text,
+                 gint           length)
+{
+  CommentsEol eol;
+  CommentsEol inserted;
+
+  eol = GPOINTER_TO_INT (g_object_get_data (G_OBJECT (buffer), BUFFER_EOL)) - 1;
+  if (eol == COMMENTS_EOL_MIXED)
+    return;
+
+  inserted = comments_transform_detect_eol (text, MIN (length, EOL_SAMPLE_LENGTH));
+
+  g_object_set_data (G_OBJECT (buffer), BUFFER_EOL, 
+                     GINT_TO_POINTER (comments_transform_merge_eol (eol, inserted) + 1));
+}
+
+static EditJob*
+new_edit_job (CommentsEngine     *engine,
+              CodeSlayerDocument *document,
+              CommentsConfig     *config,
+              const gchar        *operation,
+              guint               count,
+              gint64              start_time)
+{
+  EditJob *job;
+
+  job = g_new0 (EditJob, 1);
+  job->engine = engine;
+  job->document = g_object_ref (document);
+  job->source_view = g_object_ref (codeslayer_document_get_source_view (document));
+  job->config = g_object_ref (config);
+  job->operation = operation;
+  job->count = count;
+  job->start_time = start_time;
+
+  return job;
+}
+
+static EditJob*
+new_line_job (CommentsEngine     *engine,
+              CodeSlayerDocument *document,
+              CommentsConfig     *config,
+              const gchar        *operation,
+              gboolean            comment,
+              gint64              start_time)
+{
+  EditJob *job;
+
+  job = new_edit_job (engine, document, config, operation, 1, start_time);
+  job->comment = comment;
+  job->start = comments_config_get_start (config);
+  job->end = comments_config_get_end (config);
+  job->block = match_block_comment (job->start, job->end);
+  job->indent = !job->block && comments_config_get_indent (config);
+  job->padding = !job->block && comments_config_get_padding (config);
+
+  job->prefix = get_prefix (COMMENTS_ENGINE_GET_PRIVATE (engine)->arena, 
+                            job->start, job->padding);
+
+  return job;
+}
+
+/*
+ * Only one edit is applied at a time. Until it is done the other actions
+ * are turned away, apart from comment and uncomment requests, which are
+ * held and run once it is.
+ */
+static void
+start_edit_job (EditJob                 *job,
+                GtkTextIter             *iter,
+                CommentsApplierFunc      func,
+                CommentsApplierDoneFunc  done)
+{
+  CommentsEnginePrivate *priv;
+  priv = COMMENTS_ENGINE_GET_PRIVATE (job->engine);
+
+  if (COMMENTS_TRACE_ENABLED (edit__start))
+    COMMENTS_TRACE2 (edit__start, job->text != NULL ? strlen (job->text) : 0, 
+                     job->length);
+
+  priv->applier = comments_applier_new (GTK_TEXT_VIEW (job->source_view), 
+                                        iter, func, done, job);
+  comments_applier_run (priv->applier, priv->apply_budget);
+}
+
+/*
+ * The old text goes in the first step and the new text follows in pieces
+ * that end on a line break, so no character is ever split.
+ */
+static gboolean
+replace_job_step (GtkTextBuffer *buffer,
+                  GtkTextIter   *iter,
+                  EditJob       *job)
+{
+  gsize length;
+
+  if (job->end_mark != NULL)
+    {
+      GtkTextIter end;
+
+      gtk_text_buffer_get_iter_at_mark (buffer, &end, job->end_mark);
+      gtk_text_buffer_delete (buffer, iter, &end);
+      gtk_text_buffer_delete_mark (buffer, job->end_mark);
+      job->end_mark = NULL;
+
+      return job->length > 0;
+    }
+
+  length = job->length - job->pos;
+
+  if (length > REPLACE_CHUNK_SIZE)
+    {
+      const gchar *chunk;
+      const gchar *newline;
+
+      chunk = job->replace + job->pos;
+      newline = memchr (chunk + REPLACE_CHUNK_SIZE, '\n', 
+                        length - REPLACE_CHUNK_SIZE);
+      if (newline != NULL)
+        length = newline + 1 - chunk;
+    }
+
+  gtk_text_buffer_insert (buffer, iter, job->replace + job->pos, length);
+  job->pos += length;
+
+  return job->pos < job->length;
+}
+
+/*
+ * The replaced text is left selected so the next request works on the
+ * same lines.
+ */
+static void
+replace_job_done (GtkTextBuffer     *buffer,
+                  const GtkTextIter *iter,
+                  EditJob           *job)
+{
+  GtkTextIter start;
+
+  gtk_text_buffer_get_iter_at_mark (buffer, &start, job->start_mark);
+  gtk_text_buffer_select_range (buffer, &start, iter);
+  gtk_text_buffer_delete_mark (buffer, job->start_mark);
+
+  finish_edit_job (job);
+}
+
+/*
+ * Commenting a line only ever adds or removes delimiters within it, so the
+ * distance to the next line in the job holds however many slices apart the
+ * two are done.
+ */
+static gboolean
+line_job_step (GtkTextBuffer *buffer,
+               GtkTextIter   *iter,
+               EditJob       *job)
+{
+  gint line;
+  gint next;
+
+  line = gtk_text_iter_get_line (iter);
+
+  /* the column is measured before the first line is touched */
+  if (job->index == 0 && job->comment && job->indent)
+    {
+      job->tab_width = gtk_source_view_get_tab_width (job->source_view);
+      job->column = get_min_column (buffer, line, job->n_lines, job->lines, 
+                                    job->tab_width);
+    }
+
+  if (job->comment)
+    comment_line (buffer, line, job->prefix, job->end, job->block, job->indent, 
+                  job->column, job->tab_width);
+  else
+    uncomment_line (buffer, line, job->start, job->end, job->block, job->padding);
+
+  job->index++;
+
+  if (job->index == job->n_lines)
+    next = line;
+  else if (job->lines != NULL)
+    next = line + job->lines[job->index] - job->lines[job->index - 1];
+  else
+    next = line + 1;
+
+  gtk_text_buffer_get_iter_at_line (buffer, iter, next);
+
+  return job->index < job->n_lines;
+}
+
+static void
+line_job_done (GtkTextBuffer     *buffer,
+               const GtkTextIter *iter,
+               EditJob           *job)
+{
+  finish_edit_job (job);
+}
+
+static void
+finish_edit_job (EditJob *job)
+{
+  CommentsEnginePrivate *priv;
+  priv = COMMENTS_ENGINE_GET_PRIVATE (job->engine);
+
+  priv->applier = NULL;
+
+  end_bulk_edit (&job->bulk, job->source_view);
+
+  COMMENTS_TRACE (edit__done);
+  TRACE_ACTION_DONE (job->length);
+
+  record_action (job->engine, job->operation, job->count, job->document, 
+                 job->config, job->text, job->start_time);
+
+  if ((priv->pending_comments > 0 || priv->pending_uncomments > 0) && 
+      priv->pending_id == 0)
+    schedule_pending_actions (job->engine);
+
+  g_object_unref (job->document);
+  g_object_unref (job->source_view);
+  g_object_unref (job->config);
+  g_free (job->text);
+  g_free (job->lines);
+  g_free (job);
+
+  comments_arena_reset (priv->arena);
+}
+
+static void
+record_action (CommentsEngine     *engine,
+               const gchar        *operation,
+               guint               count,
+               CodeSlayerDocument *document,
+               CommentsConfig     *config,
+               const gchar        *text,
+               gint64              start_time)
+{
+  CommentsEnginePrivate *priv;
+  gint64 duration;
+
+  priv = COMMENTS_ENGINE_GET_PRIVATE (engine);
+
+  if (priv->recorder == NULL)
+    return;
+
+  duration = g_get_monotonic_time () - start_time;
+
+  comments_recorder_record (priv->recorder, operation, count,
+                            codeslayer_document_get_file_path (document),
+                            config, text, duration);
 }
@@ -21,6 +21,7 @@
 
 #include <gtk/gtk.h>
 #include <codeslayer/codeslayer.h>
+#include "comments-plugin.h"
 
 G_BEGIN_DECLS
 
@@ -52,6 +53,27 @@ void             comments_engine_load_configs  (CommentsEngine *engine);
 
 void             comments_engine_open_dialog   (CommentsEngine *engine);
 
+void             comments_engine_set_bulk_threshold  (CommentsEngine *engine,
+                                                      gint            threshold);
+
+void             comments_engine_set_apply_budget    (CommentsEngine *engine,
+                                                      gint            budget);
+
+void             comments_engine_set_repeat_interval (CommentsEngine *engine,
+                                                      guint           interval);
+
+gboolean         comments_engine_start_recording  (CommentsEngine  *engine,
+                                                   const gchar     *file_path,
+                                                   GError         **error);
+
+void             comments_engine_stop_recording   (CommentsEngine  *engine);
+
+gboolean         comments_engine_apply_ranges     (CommentsEngine      *engine,
+                                                   CodeSlayerDocument  *document,
+                                                   const CommentsRange *ranges,
+                                                   guint                n_ranges,
+                                                   CommentsOperation    operation);
+
 G_END_DECLS
 
 #endif /* _COMMENTS_ENGINE_H */
@@ -0,0 +1,265 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "comments-findings.h"
+
+static void comments_findings_class_init  (CommentsFindingsClass  *klass);
+static void comments_findings_init        (CommentsFindings       *findings);
+static void comments_findings_finalize    (CommentsFindings       *findings);
+
+static void add_content_area              (CommentsFindings       *findings);
+static void load_detections               (CommentsFindings       *findings);
+static void add_column                    (GtkWidget              *tree,
+                                           const gchar            *title,
+                                           gint                    column);
+static void row_activated                 (CommentsFindings       *findings,
+                                           GtkTreePath            *path,
+                                           GtkTreeViewColumn      *column);
+
+#define COMMENTS_FINDINGS_GET_PRIVATE(obj) \
+  (G_TYPE_INSTANCE_GET_PRIVATE ((obj), COMMENTS_FINDINGS_TYPE, CommentsFindingsPrivate))
+
+typedef struct _CommentsFindingsPrivate CommentsFindingsPrivate;
+
+struct _CommentsFindingsPrivate
+{
+  gchar        *folder_path;
+  GPtrArray    *detections;
+  GtkListStore *store;
+};
+
+enum
+{
+  PATH = 0,
+  LINES,
+  CODE,
+  PREVIEW,
+  DETECTION,
+  COLUMNS
+};
+
+enum
+{
+  SELECT_DETECTION,
+  LAST_SIGNAL
+};
+
+static guint comments_findings_signals[LAST_SIGNAL] = { 0 };
+
+G_DEFINE_TYPE (CommentsFindings, comments_findings, GTK_TYPE_DIALOG)
+
+static void 
+comments_findings_class_init (CommentsFindingsClass *klass)
+{
+  comments_findings_signals[SELECT_DETECTION] =
+    g_signal_new ("select-detection", 
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST | G_SIGNAL_NO_RECURSE | G_SIGNAL_NO_HOOKS,
+                  G_STRUCT_OFFSET (CommentsFindingsClass, select_detection),
+                  NULL, NULL, 
+                  g_cclosure_marshal_VOID__POINTER, G_TYPE_NONE, 1, G_TYPE_POINTER);
+
+  G_OBJECT_CLASS (klass)->finalize = (GObjectFinalizeFunc) comments_findings_finalize;
+  g_type_class_add_private (klass, sizeof (CommentsFindingsPrivate));
+}
+
+static void
+comments_findings_init (CommentsFindings *findings)
+{
+  CommentsFindingsPrivate *priv;
+  priv = COMMENTS_FINDINGS_GET_PRIVATE (findings);
+  priv->folder_path = NULL;
+  priv->detections = NULL;
+
+  gtk_window_set_title (GTK_WINDOW (findings), "Commented-Out Code");
+  gtk_window_set_skip_taskbar_hint (GTK_WINDOW (findings), TRUE);
+  gtk_window_set_skip_pager_hint (GTK_WINDOW (findings), TRUE);
+}
+
+static void
+comments_findings_finalize (CommentsFindings *findings)
+{
+  CommentsFindingsPrivate *priv;
+  priv = COMMENTS_FINDINGS_GET_PRIVATE (findings);
+  if (priv->folder_path)
+    {
+      g_free (priv->folder_path);
+      priv->folder_path = NULL;
+    }
+  if (priv->detections)
+    {
+      g_ptr_array_unref (priv->detections);
+      priv->detections = NULL;
+    }
+  G_OBJECT_CLASS (comments_findings_parent_class)-> finalize (G_OBJECT (findings));
+}
+
+/*
+ * The list is not modal, so the files can be opened one after another
+ * from it; activating a row emits select-detection.
+ */
+GtkWidget*
+comments_findings_new (const gchar *folder_path,
+                       GPtrArray   *detections)
+{
+  CommentsFindingsPrivate *priv;
+  GtkWidget *findings;
+  
+  findings = g_object_new (comments_findings_get_type (), NULL);
+  priv = COMMENTS_FINDINGS_GET_PRIVATE (findings);
+
+  priv->folder_path = g_strdup (folder_path);
+  priv->detections = g_ptr_array_ref (detections);
+  
+  add_content_area (COMMENTS_FINDINGS (findings));
+  load_detections (COMMENTS_FINDINGS (findings));
+  
+  return findings;
+}
+
+static void
+add_content_area (CommentsFindings *findings)
+{
+  CommentsFindingsPrivate *priv;
+  GtkWidget *content_area;
+  GtkWidget *label;
+  GtkWidget *tree;
+  GtkListStore *store;
+  GtkWidget *scrolled_window;
+  gchar *text;
+
+  priv = COMMENTS_FINDINGS_GET_PRIVATE (findings);
+
+  gtk_dialog_add_buttons (GTK_DIALOG (findings), 
+                          GTK_STOCK_CLOSE, GTK_RESPONSE_CLOSE, NULL);
+  gtk_dialog_set_default_response (GTK_DIALOG (findings), GTK_RESPONSE_CLOSE);
+                          
+  content_area = gtk_dialog_get_content_area (GTK_DIALOG (findings));
+  
+  text = g_strdup_printf ("%s: %u found", priv->folder_path, 
+                          priv->detections->len);
+  label = gtk_label_new (text);
+  gtk_misc_set_alignment (GTK_MISC (label), 0, .5);
+  g_free (text);
+
+  /* the tree */
+
+  tree = gtk_tree_view_new ();
+  
+  store = gtk_list_store_new (COLUMNS, G_TYPE_STRING, G_TYPE_STRING, 
+                              G_TYPE_UINT, G_TYPE_STRING, G_TYPE_POINTER);
+  priv->store = store;
+  
+  gtk_tree_view_set_model (GTK_TREE_VIEW (tree), GTK_TREE_MODEL (store));
+  g_object_unref (store);
+  
+  add_column (tree, "Path", PATH);
+  add_column (tree, "Lines", LINES);
+  add_column (tree, "Code", CODE);
+  add_column (tree, "Preview", PREVIEW);
+
+  g_signal_connect_swapped (G_OBJECT (tree), "row-activated",
+                            G_CALLBACK (row_activated), findings);
+
+  scrolled_window = gtk_scrolled_window_new (NULL, NULL);
+  gtk_scrolled_window_set_policy (GTK_SCROLLED_WINDOW (scrolled_window),
+                                  GTK_POLICY_AUTOMATIC, GTK_POLICY_AUTOMATIC);
+  gtk_container_add (GTK_CONTAINER (scrolled_window), GTK_WIDGET (tree));
+  gtk_widget_set_size_request (scrolled_window, 700, 400);
+
+  gtk_box_pack_start (GTK_BOX (content_area), label, FALSE, FALSE, 4);
+  gtk_box_pack_start (GTK_BOX (content_area), scrolled_window, TRUE, TRUE, 0);
+  gtk_widget_show_all (content_area);
+}
+
+static void
+add_column (GtkWidget   *tree,
+            const gchar *title,
+            gint         column)
+{
+  GtkTreeViewColumn *tree_column;
+  GtkCellRenderer *renderer;
+
+  tree_column = gtk_tree_view_column_new ();
+  gtk_tree_view_column_set_title (tree_column, title);
+  gtk_tree_view_column_set_resizable (tree_column, TRUE);
+  if (column != LINES)
+    gtk_tree_view_column_set_sort_column_id (tree_column, column);
+
+  renderer = gtk_cell_renderer_text_new ();
+  gtk_tree_view_column_pack_start (tree_column, renderer, TRUE);
+  gtk_tree_view_column_set_attributes (tree_column, renderer, 
+                                       "text", column, NULL);
+
+  if (column == LINES || column == CODE)
+    g_object_set (renderer, "xalign", 1.0, NULL);
+  if (column == PREVIEW)
+    g_object_set (renderer, "family", "monospace", NULL);
+
+  gtk_tree_view_append_column (GTK_TREE_VIEW (tree), tree_column);
+}
+
+static void
+load_detections (CommentsFindings *findings)
+{
+  CommentsFindingsPrivate *priv;
+  GtkTreeIter iter;
+  guint i;
+
+  priv = COMMENTS_FINDINGS_GET_PRIVATE (findings);
+
+  for (i = 0; i < priv->detections->len; i++)
+    {
+      CommentsDetection *detection = g_ptr_array_index (priv->detections, i);
+      gchar *lines;
+
+      lines = g_strdup_printf ("%u-%u", detection->first_line, detection->last_line);
+      
+      gtk_list_store_append (priv->store, &iter);
+      gtk_list_store_set (priv->store, &iter, 
+                          PATH, detection->path, 
+                          LINES, lines,
+                          CODE, detection->code_lines,
+                          PREVIEW, detection->preview,
+                          DETECTION, detection,
+                          -1);
+
+      g_free (lines);
+    }
+}
+
+static void
+row_activated (CommentsFindings  *findings,
+               GtkTreePath       *path,
+               GtkTreeViewColumn *column)
+{
+  CommentsFindingsPrivate *priv;
+  CommentsDetection *detection;
+  GtkTreeIter iter;
+
+  priv = COMMENTS_FINDINGS_GET_PRIVATE (findings);
+
+  if (!gtk_tree_model_get_iter (GTK_TREE_MODEL (priv->store), &iter, path))
+    return;
+
+  gtk_tree_model_get (GTK_TREE_MODEL (priv->store), &iter, 
+                      DETECTION, &detection, -1);
+
+  g_signal_emit (findings, comments_findings_signals[SELECT_DETECTION], 0, 
+                 detection);
+}
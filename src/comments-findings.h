@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __COMMENTS_FINDINGS_H__
+#define	__COMMENTS_FINDINGS_H__
+
+#include <gtk/gtk.h>
+#include "comments-detector.h"
+
+G_BEGIN_DECLS
+
+#define COMMENTS_FINDINGS_TYPE            (comments_findings_get_type ())
+#define COMMENTS_FINDINGS(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), COMMENTS_FINDINGS_TYPE, CommentsFindings))
+#define COMMENTS_FINDINGS_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), COMMENTS_FINDINGS_TYPE, CommentsFindingsClass))
+#define IS_COMMENTS_FINDINGS(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), COMMENTS_FINDINGS_TYPE))
+#define IS_COMMENTS_FINDINGS_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), COMMENTS_FINDINGS_TYPE))
+
+typedef struct _CommentsFindings CommentsFindings;
+typedef struct _CommentsFindingsClass CommentsFindingsClass;
+
+struct _CommentsFindings
+{
+  GtkDialog parent_instance;
+};
+
+struct _CommentsFindingsClass
+{
+  GtkDialogClass parent_class;
+
+  void (*select_detection) (CommentsFindings  *findings,
+                            CommentsDetection *detection);
+};
+
+GType comments_findings_get_type (void) G_GNUC_CONST;
+     
+GtkWidget*  comments_findings_new  (const gchar *folder_path,
+                                    GPtrArray   *detections);
+
+G_END_DECLS
+
+#endif /* __COMMENTS_FINDINGS_H__ */
@@ -0,0 +1,181 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <gtksourceview/gtksourceview.h>
+#include <codeslayer/codeslayer-utils.h>
+#include "comments-host.h"
+
+#define CONFIG_FOLDER "config_folder"
+#define ACTIVE_DOCUMENT "active_document"
+#define SOURCE_VIEW "source_view"
+#define FILE_PATH "file_path"
+#define PROJECT "project"
+#define FOLDER_PATH "folder_path"
+#define LINE_NUMBER "line_number"
+
+CodeSlayer*
+comments_host_new (const gchar *config_folder)
+{
+  GObject *host;
+  host = g_object_new (G_TYPE_OBJECT, NULL);
+  g_object_set_data_full (host, CONFIG_FOLDER, g_strdup (config_folder), g_free);
+  return (CodeSlayer*) host;
+}
+
+/*
+ * The document becomes the active one and is owned by the host. The source
+ * view is never put in a window, but is a real view over the buffer so the
+ * engine sees the same tab width and buffer signals as in the editor.
+ */
+CodeSlayerDocument*
+comments_host_open_document (CodeSlayer      *codeslayer,
+                             const gchar     *file_path,
+                             const gchar     *project_folder,
+                             GtkSourceBuffer *buffer)
+{
+  GObject *document;
+  GtkWidget *source_view;
+
+  document = g_object_new (G_TYPE_OBJECT, NULL);
+
+  source_view = gtk_source_view_new_with_buffer (buffer);
+  g_object_ref_sink (source_view);
+
+  g_object_set_data_full (document, SOURCE_VIEW, source_view, g_object_unref);
+  g_object_set_data_full (document, FILE_PATH, g_strdup (file_path), g_free);
+
+  if (project_folder != NULL)
+    {
+      GObject *project;
+      project = g_object_new (G_TYPE_OBJECT, NULL);
+      g_object_set_data_full (project, FOLDER_PATH, g_strdup (project_folder), g_free);
+      g_object_set_data_full (document, PROJECT, project, g_object_unref);
+    }
+
+  g_object_set_data_full (G_OBJECT (codeslayer), ACTIVE_DOCUMENT, document, 
+                          g_object_unref);
+
+  return (CodeSlayerDocument*) document;
+}
+
+/*
+ * There is no editor to open a document in, so selecting one never 
+ * succeeds.
+ */
+gboolean
+codeslayer_select_document (CodeSlayer         *codeslayer,
+                            CodeSlayerDocument *document)
+{
+  return FALSE;
+}
+
+CodeSlayerDocument*
+codeslayer_get_active_document (CodeSlayer *codeslayer)
+{
+  return g_object_get_data (G_OBJECT (codeslayer), ACTIVE_DOCUMENT);
+}
+
+gchar*
+codeslayer_get_plugins_config_folder_path (CodeSlayer *codeslayer)
+{
+  return g_strdup (g_object_get_data (G_OBJECT (codeslayer), CONFIG_FOLDER));
+}
+
+CodeSlayerDocument*
+codeslayer_document_new (void)
+{
+  return (CodeSlayerDocument*) g_object_new (G_TYPE_OBJECT, NULL);
+}
+
+void
+codeslayer_document_set_file_path (CodeSlayerDocument *document,
+                                   const gchar        *file_path)
+{
+  g_object_set_data_full (G_OBJECT (document), FILE_PATH, 
+                          g_strdup (file_path), g_free);
+}
+
+void
+codeslayer_document_set_line_number (CodeSlayerDocument *document,
+                                     gint                line_number)
+{
+  g_object_set_data (G_OBJECT (document), LINE_NUMBER, 
+                     GINT_TO_POINTER (line_number));
+}
+
+void
+codeslayer_document_set_project (CodeSlayerDocument *document,
+                                 CodeSlayerProject  *project)
+{
+  g_object_set_data_full (G_OBJECT (document), PROJECT, 
+                          g_object_ref (project), g_object_unref);
+}
+
+GtkSourceView*
+codeslayer_document_get_source_view (CodeSlayerDocument *document)
+{
+  return g_object_get_data (G_OBJECT (document), SOURCE_VIEW);
+}
+
+const gchar*
+codeslayer_document_get_file_path (CodeSlayerDocument *document)
+{
+  return g_object_get_data (G_OBJECT (document), FILE_PATH);
+}
+
+CodeSlayerProject*
+codeslayer_document_get_project (CodeSlayerDocument *document)
+{
+  return g_object_get_data (G_OBJECT (document), PROJECT);
+}
+
+const gchar*
+codeslayer_project_get_folder_path (CodeSlayerProject *project)
+{
+  return g_object_get_data (G_OBJECT (project), FOLDER_PATH);
+}
+
+GtkWidget*
+codeslayer_menu_item_new_with_label (const gchar *label)
+{
+  return gtk_menu_item_new_with_label (label);
+}
+
+gboolean
+codeslayer_utils_has_text (const gchar *text)
+{
+  return text != NULL && *text != '\0';
+}
+
+GList*
+codeslayer_utils_string_to_list (const gchar *string)
+{
+  GList *results = NULL;
+  gchar **split;
+  gint i;
+
+  if (string == NULL)
+    return NULL;
+
+  split = g_strsplit (string, ",", -1);
+  for (i = 0; split[i] != NULL; i++)
+    results = g_list_prepend (results, g_strstrip (g_strdup (split[i])));
+  g_strfreev (split);
+
+  return g_list_reverse (results);
+}
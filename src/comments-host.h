@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __COMMENTS_HOST_H__
+#define	__COMMENTS_HOST_H__
+
+#include <gtksourceview/gtksourcebuffer.h>
+#include <codeslayer/codeslayer.h>
+
+G_BEGIN_DECLS
+
+/*
+ * A stand-in for the parts of the CodeSlayer API that the plugin calls, so
+ * the engine can be driven outside of the editor. The CodeSlayer, document
+ * and project handles it gives out are plain GObjects, and every function
+ * the plugin uses is defined here, so nothing links against libcodeslayer.
+ */
+
+CodeSlayer*          comments_host_new            (const gchar     *config_folder);
+
+CodeSlayerDocument*  comments_host_open_document  (CodeSlayer      *codeslayer,
+                                                   const gchar     *file_path,
+                                                   const gchar     *project_folder,
+                                                   GtkSourceBuffer *buffer);
+
+G_END_DECLS
+
+#endif /* __COMMENTS_HOST_H__ */
@@ -0,0 +1,898 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <string.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+#include "comments-license.h"
+#include "comments-walker.h"
+#include "comments-transform.h"
+#include "comments-simd.h"
+
+/*
+ * Adds a license header to the top of a file, or brings the one there up
+ * to date. The header is rendered from a plain text template with the
+ * delimiters of the file's config: as a block comment when the config has
+ * a block style, and as line comments otherwise.
+ *
+ * The comment a file opens with, after any #! or <?xml line and any
+ * coding cookie or editor modeline on the first two lines, is taken as
+ * its header. It is matched against the template by a hash of its letters
+ * and digits alone, so a header is found to be current whatever its
+ * delimiters, decoration or line breaks. One that does not match but
+ * speaks of a copyright or a license is an older header, and is replaced
+ * or left alone; any other comment stays below the new header.
+ *
+ * A tree is updated on a thread pool, one job per file, and each file that
+ * changes is written to a temporary file that is then renamed over it. The
+ * cache holds the modification time and size of every file that was left
+ * current, as the detector's index does, along with a hash of the
+ * delimiters it was checked with, so the next update only has to stat a
+ * file to know it can skip it.
+ */
+
+#define CACHE_MAGIC "comments-license-2"
+#define HASH_SEED G_GUINT64_CONSTANT (14695981039346656037)
+#define EOL_SAMPLE 4096
+
+typedef struct _Rule Rule;
+typedef struct _Stamp Stamp;
+typedef struct _Update Update;
+typedef struct _Job Job;
+
+struct _CommentsLicense
+{
+  gchar   **lines;
+  guint64   hash;
+};
+
+struct _Rule
+{
+  gchar *line;
+  gchar *start;
+  gchar *end;
+};
+
+struct _Stamp
+{
+  gint64  mtime;
+  gint64  size;
+  guint64 rule;
+};
+
+/* what every job of one update shares */
+struct _Update
+{
+  CommentsLicense *license;
+  GHashTable      *cache;
+  gboolean         replace;
+  gboolean         check;
+};
+
+struct _Job
+{
+  CommentsLicense      *license;
+  gchar                *file_path;
+  gchar                *path;
+  Rule                 *rule;
+  gboolean              replace;
+  gboolean              check;
+  gboolean              cached;
+  gboolean              hit;
+  gboolean              keep;
+  Stamp                 stamp;
+  CommentsLicenseState  state;
+};
+
+static CommentsLicenseState apply_rule (CommentsLicense *license,
+                                        GString         *result,
+                                        const gchar     *text,
+                                        gsize            length,
+                                        Rule            *rule,
+                                        gboolean         replace);
+static const gchar* skip_prolog        (const gchar     *text,
+                                        const gchar     *limit);
+static gboolean     is_directive       (const gchar     *text,
+                                        const gchar     *line_end);
+static gboolean     has_text           (const gchar     *text,
+                                        const gchar     *limit,
+                                        const gchar     *word);
+static gboolean     find_header        (const gchar     *text,
+                                        const gchar     *limit,
+                                        Rule            *rule,
+                                        const gchar    **header,
+                                        const gchar    **header_end);
+static const gchar* skip_line_break    (const gchar     *text,
+                                        const gchar     *limit);
+static void         render_header      (CommentsLicense *license,
+                                        GString         *result,
+                                        Rule            *rule,
+                                        const gchar     *eol);
+static gboolean     is_license         (const gchar     *text,
+                                        gsize            length);
+static gboolean     has_prefix         (const gchar     *text,
+                                        const gchar     *limit,
+                                        const gchar     *prefix);
+static guint64      hash_text          (guint64          hash,
+                                        const gchar     *text,
+                                        gsize            length);
+static guint64      hash_words         (const gchar     *text,
+                                        gsize            length);
+static guint64      hash_rule          (Rule            *rule);
+static gboolean     get_stamp          (const gchar     *file_path,
+                                        Rule            *rule,
+                                        Stamp           *stamp);
+static gchar*       get_cache_header   (CommentsLicense *license,
+                                        gboolean         replace);
+static GHashTable*  load_cache         (const gchar     *cache_path,
+                                        const gchar     *cache_header);
+static void         save_cache         (const gchar     *cache_path,
+                                        const gchar     *cache_header,
+                                        GPtrArray       *jobs);
+static Rule*        rule_new           (CommentsConfig  *config);
+static void         rule_free          (Rule            *rule);
+static Job*         job_new            (const gchar     *file_path,
+                                        const gchar     *path,
+                                        Rule            *rule,
+                                        Update          *update);
+static void         update_job         (Job             *job,
+                                        gpointer         user_data);
+static gboolean     write_file         (const gchar     *file_path,
+                                        const gchar     *contents,
+                                        gsize            length,
+                                        GError         **error);
+
+/*
+ * The template is plain text, one line of the header to a line; the blank
+ * lines at its end are dropped.
+ */
+CommentsLicense*
+comments_license_new (const gchar *template_text)
+{
+  CommentsLicense *license;
+  guint n_lines;
+  guint i;
+
+  license = g_new0 (CommentsLicense, 1);
+  license->lines = g_strsplit (template_text, "\n", -1);
+  license->hash = hash_words (template_text, strlen (template_text));
+
+  n_lines = g_strv_length (license->lines);
+
+  for (i = 0; i < n_lines; i++)
+    {
+      gchar *line = license->lines[i];
+      gsize length = strlen (line);
+      if (length > 0 && line[length - 1] == '\r')
+        line[length - 1] = '\0';
+    }
+
+  while (n_lines > 0 && *g_strchomp (license->lines[n_lines - 1]) == '\0')
+    {
+      n_lines--;
+      g_free (license->lines[n_lines]);
+      license->lines[n_lines] = NULL;
+    }
+
+  return license;
+}
+
+void
+comments_license_free (CommentsLicense *license)
+{
+  g_strfreev (license->lines);
+  g_free (license);
+}
+
+/*
+ * Writes the text with its header added or updated to result, and says
+ * which it was. Nothing is written to result when the header was already
+ * current, or another license was there and replace is off.
+ */
+CommentsLicenseState
+comments_license_apply (CommentsLicense *license,
+                        GString         *result,
+                        const gchar     *text,
+                        gsize            length,
+                        CommentsConfig  *config,
+                        gboolean         replace)
+{
+  CommentsLicenseState state;
+  Rule *rule;
+
+  rule = rule_new (config);
+  if (rule == NULL)
+    return COMMENTS_LICENSE_FAILED;
+
+  state = apply_rule (license, result, text, length, rule, replace);
+  rule_free (rule);
+
+  return state;
+}
+
+/*
+ * Update the header of every file under the folder that one of the configs
+ * knows about, or with check only count the files that would change. The
+ * cache is read from and written back to cache_path when it is given.
+ */
+void
+comments_license_update (CommentsLicense      *license,
+                         const gchar          *folder_path,
+                         GList                *configs,
+                         const gchar          *cache_path,
+                         gboolean              replace,
+                         gboolean              check,
+                         CommentsLicenseStats *stats)
+{
+  GPtrArray *jobs;
+  gchar *cache_header;
+  Update update;
+  guint i;
+
+  cache_header = get_cache_header (license, replace);
+
+  update.license = license;
+  update.cache = load_cache (cache_path, cache_header);
+  update.replace = replace;
+  update.check = check;
+
+  jobs = comments_walker_run (folder_path, configs, 
+                              (CommentsRuleFunc) rule_new, 
+                              (GDestroyNotify) rule_free, 
+                              (CommentsFileFunc) job_new, 
+                              (GFunc) update_job, &update);
+
+  memset (stats, 0, sizeof (CommentsLicenseStats));
+
+  for (i = 0; i < jobs->len; i++)
+    {
+      Job *job = g_ptr_array_index (jobs, i);
+
+      switch (job->state)
+        {
+        case COMMENTS_LICENSE_CURRENT:
+          stats->current++;
+          break;
+        case COMMENTS_LICENSE_ADDED:
+          stats->added++;
+          break;
+        case COMMENTS_LICENSE_REPLACED:
+          stats->replaced++;
+          break;
+        case COMMENTS_LICENSE_SKIPPED:
+          stats->skipped++;
+          break;
+        case COMMENTS_LICENSE_FAILED:
+          stats->failed++;
+          break;
+        }
+
+      if (job->hit)
+        stats->cached++;
+    }
+
+  if (cache_path != NULL)
+    save_cache (cache_path, cache_header, jobs);
+
+  for (i = 0; i < jobs->len; i++)
+    {
+      Job *job = g_ptr_array_index (jobs, i);
+      g_free (job->file_path);
+      g_free (job->path);
+      g_free (job);
+    }
+
+  g_ptr_array_free (jobs, TRUE);
+  g_hash_table_destroy (update.cache);
+  g_free (cache_header);
+}
+
+static CommentsLicenseState
+apply_rule (CommentsLicense *license,
+            GString         *result,
+            const gchar     *text,
+            gsize            length,
+            Rule            *rule,
+            gboolean         replace)
+{
+  const gchar *limit;
+  const gchar *top;
+  const gchar *header;
+  const gchar *header_end;
+  const gchar *eol;
+  CommentsEol style;
+
+  limit = text + length;
+  style = comments_transform_detect_eol (text, MIN (length, EOL_SAMPLE));
+  eol = comments_transform_get_eol_string (style);
+  top = skip_prolog (text, limit);
+
+  if (find_header (top, limit, rule, &header, &header_end))
+    {
+      if (hash_words (header, header_end - header) == license->hash)
+        return COMMENTS_LICENSE_CURRENT;
+
+      if (is_license (header, header_end - header))
+        {
+          if (!replace)
+            return COMMENTS_LICENSE_SKIPPED;
+
+          g_string_append_len (result, text, header - text);
+          render_header (license, result, rule, eol);
+          g_string_append_len (result, header_end, limit - header_end);
+          return COMMENTS_LICENSE_REPLACED;
+        }
+    }
+
+  g_string_append_len (result, text, top - text);
+  if (top > text && top[-1] != '\n' && top[-1] != '\r')
+    g_string_append (result, eol);
+  render_header (license, result, rule, eol);
+  if (top < limit && *top != '\n' && *top != '\r')
+    g_string_append (result, eol);
+  g_string_append_len (result, top, limit - top);
+
+  return COMMENTS_LICENSE_ADDED;
+}
+
+/*
+ * The header goes after an interpreter line or an XML declaration, and
+ * after a coding cookie or a modeline, which only count on the first two
+ * lines (PEP 263) and so must not be pushed down by it.
+ */
+static const gchar*
+skip_prolog (const gchar *text,
+             const gchar *limit)
+{
+  const gchar *line_end;
+  gint line;
+
+  for (line = 0; line < 2 && text < limit; line++)
+    {
+      line_end = comments_simd_find_newline (text, limit);
+
+      if (!(line == 0 && has_prefix (text, limit, "#!")) &&
+          !(line == 0 && has_prefix (text, limit, "<?xml")) &&
+          !is_directive (text, line_end))
+        break;
+
+      text = skip_line_break (line_end, limit);
+    }
+
+  return text;
+}
+
+/*
+ * A comment holding a coding cookie, coding: or coding=, or an Emacs
+ * -*- or vi modeline.
+ */
+static gboolean
+is_directive (const gchar *text,
+              const gchar *line_end)
+{
+  while (text < line_end && g_ascii_isspace (*text))
+    text++;
+
+  /* whatever the language, a comment does not open with a letter */
+  if (text == line_end || g_ascii_isalnum (*text))
+    return FALSE;
+
+  return has_text (text, line_end, "coding:") || 
+         has_text (text, line_end, "coding=") ||
+         has_text (text, line_end, "-*-") ||
+         has_text (text, line_end, "vim:") ||
+         has_text (text, line_end, " vi:") ||
+         has_text (text, line_end, " ex:");
+}
+
+static gboolean
+has_text (const gchar *text,
+          const gchar *limit,
+          const gchar *word)
+{
+  return g_strstr_len (text, limit - text, word) != NULL;
+}
+
+/*
+ * The header runs from the first comment after any blank lines to the line
+ * break after it: the whole of a block comment, or a run of line comments.
+ * Whichever style the text opens with is used, so a header written in the
+ * other one is found all the same.
+ */
+static gboolean
+find_header (const gchar  *text,
+             const gchar  *limit,
+             Rule         *rule,
+             const gchar **header,
+             const gchar **header_end)
+{
+  const gchar *pos = text;
+  const gchar *close;
+
+  while (pos < limit && g_ascii_isspace (*pos))
+    pos++;
+
+  if (rule->start != NULL && has_prefix (pos, limit, rule->start))
+    {
+      gsize end_length = strlen (rule->end);
+
+      close = comments_simd_find_delimiter (pos + strlen (rule->start), limit, 
+                                            rule->end, end_length);
+      if (close == limit)
+        return FALSE;
+
+      close += end_length;
+    }
+  else if (rule->line != NULL && has_prefix (pos, limit, rule->line))
+    {
+      const gchar *next = pos;
+
+      do
+        {
+          close = comments_simd_find_newline (next, limit);
+          next = skip_line_break (close, limit);
+          while (next < limit && (*next == ' ' || *next == '\t'))
+            next++;
+        }
+      while (next > close && has_prefix (next, limit, rule->line));
+    }
+  else
+    {
+      return FALSE;
+    }
+
+  *header = pos;
+
+  while (close < limit && (*close == ' ' || *close == '\t'))
+    close++;
+
+  if (close < limit && (*close == '\n' || *close == '\r'))
+    close = skip_line_break (close, limit);
+
+  *header_end = close;
+
+  return TRUE;
+}
+
+static const gchar*
+skip_line_break (const gchar *text,
+                 const gchar *limit)
+{
+  if (text < limit && *text == '\r')
+    text++;
+  if (text < limit && *text == '\n')
+    text++;
+
+  return text;
+}
+
+/*
+ * A block comment gets its start and end on lines of their own; when they
+ * end and start with a * the lines between are lined up on one, as in C.
+ */
+static void
+render_header (CommentsLicense *license,
+               GString         *result,
+               Rule            *rule,
+               const gchar     *eol)
+{
+  gchar **lines;
+
+  if (rule->start != NULL)
+    {
+      gint width;
+      gboolean decorated;
+
+      width = g_utf8_strlen (rule->start, -1);
+      decorated = g_str_has_suffix (rule->start, "*") && *rule->end == '*';
+
+      g_string_append (result, rule->start);
+      g_string_append (result, eol);
+
+      for (lines = license->lines; *lines != NULL; lines++)
+        {
+          if (decorated)
+            g_string_append_printf (result, "%*s*", width - 1, "");
+
+          if (**lines != '\0')
+            g_string_append_printf (result, decorated ? " %s" : "  %s", *lines);
+
+          g_string_append (result, eol);
+        }
+
+      if (decorated)
+        g_string_append_printf (result, "%*s", width - 1, "");
+
+      g_string_append (result, rule->end);
+      g_string_append (result, eol);
+    }
+  else
+    {
+      for (lines = license->lines; *lines != NULL; lines++)
+        {
+          g_string_append (result, rule->line);
+
+          if (**lines != '\0')
+            g_string_append_printf (result, " %s", *lines);
+
+          g_string_append (result, eol);
+        }
+    }
+}
+
+static gboolean
+is_license (const gchar *text,
+            gsize        length)
+{
+  static const gchar * const words[] = { "copyright", "licen", NULL };
+  gsize i;
+  gint j;
+
+  for (i = 0; i < length; i++)
+    {
+      for (j = 0; words[j] != NULL; j++)
+        {
+          gsize word_length = strlen (words[j]);
+          if (i + word_length <= length &&
+              g_ascii_strncasecmp (text + i, words[j], word_length) == 0)
+            return TRUE;
+        }
+    }
+
+  return FALSE;
+}
+
+static gboolean
+has_prefix (const gchar *text,
+            const gchar *limit,
+            const gchar *prefix)
+{
+  gsize length;
+
+  length = strlen (prefix);
+
+  return length > 0 && (gsize) (limit - text) >= length && 
+         strncmp (text, prefix, length) == 0;
+}
+
+/* 64 bit FNV-1a */
+static guint64
+hash_text (guint64      hash,
+           const gchar *text,
+           gsize        length)
+{
+  gsize i;
+
+  for (i = 0; i < length; i++)
+    {
+      hash ^= (guchar) text[i];
+      hash *= G_GUINT64_CONSTANT (1099511628211);
+    }
+
+  return hash;
+}
+
+/* only the letters and digits, which no choice of delimiters changes */
+static guint64
+hash_words (const gchar *text,
+            gsize        length)
+{
+  guint64 hash = HASH_SEED;
+  gsize i;
+
+  for (i = 0; i < length; i++)
+    {
+      if (g_ascii_isalnum (text[i]) || (guchar) text[i] >= 0x80)
+        {
+          hash ^= (guchar) text[i];
+          hash *= G_GUINT64_CONSTANT (1099511628211);
+        }
+    }
+
+  return hash;
+}
+
+/* other delimiters make for another header, so a file is checked again */
+static guint64
+hash_rule (Rule *rule)
+{
+  guint64 hash = HASH_SEED;
+
+  if (rule->line != NULL)
+    hash = hash_text (hash, rule->line, strlen (rule->line) + 1);
+  if (rule->start != NULL)
+    hash = hash_text (hash, rule->start, strlen (rule->start) + 1);
+  if (rule->end != NULL)
+    hash = hash_text (hash, rule->end, strlen (rule->end) + 1);
+
+  return hash;
+}
+
+static gboolean
+get_stamp (const gchar *file_path,
+           Rule        *rule,
+           Stamp       *stamp)
+{
+  GStatBuf buf;
+
+  if (g_stat (file_path, &buf) != 0)
+    return FALSE;
+
+  stamp->mtime = buf.st_mtime;
+  stamp->size = buf.st_size;
+  stamp->rule = hash_rule (rule);
+
+  return TRUE;
+}
+
+/*
+ * A cache written for another template, or with replacing switched the
+ * other way, says nothing about this update and is not used.
+ */
+static gchar*
+get_cache_header (CommentsLicense *license,
+                  gboolean         replace)
+{
+  return g_strdup_printf ("%s %016" G_GINT64_MODIFIER "x %s", CACHE_MAGIC, 
+                          license->hash, replace ? "replace" : "keep");
+}
+
+static GHashTable*
+load_cache (const gchar *cache_path,
+            const gchar *cache_header)
+{
+  GHashTable *cache;
+  gchar *contents;
+  gchar **lines;
+  gint i;
+
+  cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+  if (cache_path == NULL || 
+      !g_file_get_contents (cache_path, &contents, NULL, NULL))
+    return cache;
+
+  lines = g_strsplit (contents, "\n", -1);
+  g_free (contents);
+
+  if (lines[0] != NULL && g_strcmp0 (lines[0], cache_header) == 0)
+    {
+      for (i = 1; lines[i] != NULL; i++)
+        {
+          Stamp *stamp;
+          gchar *pos;
+          guint64 rule;
+          gint64 mtime;
+          gint64 size;
+
+          /* rule hash, modification time, size and path */
+          rule = g_ascii_strtoull (lines[i], &pos, 16);
+          if (pos == lines[i] || *pos != ' ')
+            continue;
+          mtime = g_ascii_strtoll (pos + 1, &pos, 10);
+          if (*pos != ' ')
+            continue;
+          size = g_ascii_strtoll (pos + 1, &pos, 10);
+          if (*pos != ' ' || pos[1] == '\0')
+            continue;
+
+          stamp = g_new (Stamp, 1);
+          stamp->rule = rule;
+          stamp->mtime = mtime;
+          stamp->size = size;
+          g_hash_table_insert (cache, g_strdup (pos + 1), stamp);
+        }
+    }
+
+  g_strfreev (lines);
+
+  return cache;
+}
+
+/* 
+ * Only the files that were current, or were made so, go in, which leaves
+ * out those that are gone.
+ */
+static void
+save_cache (const gchar *cache_path,
+            const gchar *cache_header,
+            GPtrArray   *jobs)
+{
+  GString *contents;
+  GError *error = NULL;
+  guint i;
+
+  contents = g_string_new (cache_header);
+  g_string_append_c (contents, '\n');
+
+  for (i = 0; i < jobs->len; i++)
+    {
+      Job *job = g_ptr_array_index (jobs, i);
+
+      if (job->keep)
+        g_string_append_printf (contents, "%016" G_GINT64_MODIFIER "x %" 
+                                G_GINT64_FORMAT " %" G_GINT64_FORMAT " %s\n", 
+                                job->stamp.rule, job->stamp.mtime, 
+                                job->stamp.size, job->path);
+    }
+
+  if (!g_file_set_contents (cache_path, contents->str, contents->len, &error))
+    {
+      g_warning ("%s", error->message);
+      g_error_free (error);
+    }
+
+  g_string_free (contents, TRUE);
+}
+
+/* a header is written with the block style of a config when it has one */
+static Rule*
+rule_new (CommentsConfig *config)
+{
+  const gchar *line;
+  const gchar *start;
+  const gchar *end;
+  Rule *rule;
+
+  line = comments_config_get_line_style (config);
+  if (!comments_config_get_block_style (config, &start, &end))
+    start = end = NULL;
+
+  if (line == NULL && start == NULL)
+    return NULL;
+
+  rule = g_new0 (Rule, 1);
+  rule->line = g_strdup (line);
+  rule->start = g_strdup (start);
+  rule->end = g_strdup (end);
+
+  return rule;
+}
+
+static void
+rule_free (Rule *rule)
+{
+  g_free (rule->line);
+  g_free (rule->start);
+  g_free (rule->end);
+  g_free (rule);
+}
+
+static Job*
+job_new (const gchar *file_path,
+         const gchar *path,
+         Rule        *rule,
+         Update      *update)
+{
+  Stamp *stamp;
+  Job *job;
+
+  if (!g_file_test (file_path, G_FILE_TEST_IS_REGULAR))
+    return NULL;
+
+  job = g_new0 (Job, 1);
+  job->license = update->license;
+  job->file_path = g_strdup (file_path);
+  job->path = g_strdup (path);
+  job->rule = rule;
+  job->replace = update->replace;
+  job->check = update->check;
+
+  stamp = g_hash_table_lookup (update->cache, path);
+  if (stamp != NULL)
+    {
+      job->cached = TRUE;
+      job->stamp = *stamp;
+    }
+
+  return job;
+}
+
+/*
+ * A file with the same modification time and size as in the cache, and
+ * the same delimiters, is current without being read. The mapping is let
+ * go before the file is written, as the new content is a copy.
+ */
+static void
+update_job (Job      *job,
+            gpointer  user_data)
+{
+  GMappedFile *mapped_file;
+  GError *error = NULL;
+  const gchar *contents;
+  GString *result;
+  gsize length;
+  Stamp stamp;
+
+  if (!get_stamp (job->file_path, job->rule, &stamp))
+    {
+      job->state = COMMENTS_LICENSE_FAILED;
+      return;
+    }
+
+  if (job->cached && job->stamp.mtime == stamp.mtime && 
+      job->stamp.size == stamp.size && job->stamp.rule == stamp.rule)
+    {
+      job->state = COMMENTS_LICENSE_CURRENT;
+      job->hit = TRUE;
+      job->keep = TRUE;
+      return;
+    }
+
+  mapped_file = g_mapped_file_new (job->file_path, FALSE, &error);
+  if (mapped_file == NULL)
+    {
+      g_warning ("%s", error->message);
+      g_error_free (error);
+      job->state = COMMENTS_LICENSE_FAILED;
+      return;
+    }
+
+  contents = g_mapped_file_get_contents (mapped_file);
+  length = g_mapped_file_get_length (mapped_file);
+  if (contents == NULL)
+    contents = "";
+
+  result = g_string_sized_new (length + 4096);
+  job->state = apply_rule (job->license, result, contents, length, 
+                           job->rule, job->replace);
+  g_mapped_file_unref (mapped_file);
+
+  if (job->state == COMMENTS_LICENSE_CURRENT)
+    {
+      job->stamp = stamp;
+      job->keep = TRUE;
+    }
+  else if ((job->state == COMMENTS_LICENSE_ADDED || 
+            job->state == COMMENTS_LICENSE_REPLACED) && !job->check)
+    {
+      if (write_file (job->file_path, result->str, result->len, &error))
+        {
+          job->keep = get_stamp (job->file_path, job->rule, &job->stamp);
+        }
+      else
+        {
+          g_warning ("%s", error->message);
+          g_error_free (error);
+          job->state = COMMENTS_LICENSE_FAILED;
+        }
+    }
+
+  g_string_free (result, TRUE);
+}
+
+/*
+ * GIO writes the new content next to the file and renames it over the old
+ * one, keeping its permissions, so a file is never left half written.
+ */
+static gboolean
+write_file (const gchar  *file_path,
+            const gchar  *contents,
+            gsize         length,
+            GError      **error)
+{
+  GFile *file;
+  gboolean written;
+
+  file = g_file_new_for_path (file_path);
+  written = g_file_replace_contents (file, contents, length, NULL, FALSE, 
+                                     G_FILE_CREATE_NONE, NULL, NULL, error);
+  g_object_unref (file);
+
+  return written;
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __COMMENTS_LICENSE_H__
+#define	__COMMENTS_LICENSE_H__
+
+#include <glib.h>
+#include "comments-config.h"
+
+G_BEGIN_DECLS
+
+typedef struct _CommentsLicense CommentsLicense;
+typedef struct _CommentsLicenseStats CommentsLicenseStats;
+
+typedef enum
+{
+  COMMENTS_LICENSE_CURRENT,
+  COMMENTS_LICENSE_ADDED,
+  COMMENTS_LICENSE_REPLACED,
+  COMMENTS_LICENSE_SKIPPED,
+  COMMENTS_LICENSE_FAILED
+} CommentsLicenseState;
+
+/*
+ * What an update did. Files that needed a header count as added or
+ * replaced under a check as well, though nothing is written.
+ */
+struct _CommentsLicenseStats
+{
+  guint current;
+  guint cached;
+  guint added;
+  guint replaced;
+  guint skipped;
+  guint failed;
+};
+
+CommentsLicense*      comments_license_new     (const gchar          *template_text);
+
+CommentsLicenseState  comments_license_apply   (CommentsLicense      *license,
+                                                GString              *result,
+                                                const gchar          *text,
+                                                gsize                 length,
+                                                CommentsConfig       *config,
+                                                gboolean              replace);
+
+void                  comments_license_update  (CommentsLicense      *license,
+                                                const gchar          *folder_path,
+                                                GList                *configs,
+                                                const gchar          *cache_path,
+                                                gboolean              replace,
+                                                gboolean              check,
+                                                CommentsLicenseStats *stats);
+
+void                  comments_license_free    (CommentsLicense      *license);
+
+G_END_DECLS
+
+#endif /* __COMMENTS_LICENSE_H__ */
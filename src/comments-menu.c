@@ -19,20 +19,50 @@
 #include <codeslayer/codeslayer.h>
 #include "comments-menu.h"
 
-static void comments_menu_class_init  (CommentsMenuClass *klass);
-static void comments_menu_init        (CommentsMenu      *menu);
-static void comments_menu_finalize    (CommentsMenu      *menu);
+static void comments_menu_class_init      (CommentsMenuClass *klass);
+static void comments_menu_init            (CommentsMenu      *menu);
+static void comments_menu_finalize        (CommentsMenu      *menu);
 
-static void comment_action            (CommentsMenu      *menu);
-static void uncomment_action          (CommentsMenu      *menu);
-static void add_menu_items            (CommentsMenu      *menu,
-                                       GtkWidget         *submenu,
-                                       GtkAccelGroup     *accel_group);
+static void comment_action                (CommentsMenu      *menu);
+static void uncomment_action              (CommentsMenu      *menu);
+static void comment_lines_action          (CommentsMenu      *menu);
+static void uncomment_lines_action        (CommentsMenu      *menu);
+static void comment_document_action       (CommentsMenu      *menu);
+static void uncomment_document_action     (CommentsMenu      *menu);
+static void comment_matching_action       (CommentsMenu      *menu);
+static void strip_comments_action         (CommentsMenu      *menu);
+static void reflow_comment_action         (CommentsMenu      *menu);
+static void convert_comment_style_action  (CommentsMenu      *menu);
+static void density_report_action         (CommentsMenu      *menu);
+static void find_commented_code_action    (CommentsMenu      *menu);
+static void update_license_header_action  (CommentsMenu      *menu);
+static void update_license_headers_action (CommentsMenu      *menu);
+static void next_comment_block_action     (CommentsMenu      *menu);
+static void previous_comment_block_action (CommentsMenu      *menu);
+static void select_comment_block_action   (CommentsMenu      *menu);
+static void add_menu_items                (CommentsMenu      *menu,
+                                           GtkWidget         *submenu,
+                                           GtkAccelGroup     *accel_group);
 
 enum
 {
   COMMENT,
   UNCOMMENT,
+  COMMENT_LINES,
+  UNCOMMENT_LINES,
+  COMMENT_DOCUMENT,
+  UNCOMMENT_DOCUMENT,
+  COMMENT_MATCHING,
+  STRIP_COMMENTS,
+  DENSITY_REPORT,
+  FIND_COMMENTED_CODE,
+  NEXT_COMMENT_BLOCK,
+  PREVIOUS_COMMENT_BLOCK,
+  SELECT_COMMENT_BLOCK,
+  REFLOW_COMMENT,
+  CONVERT_COMMENT_STYLE,
+  UPDATE_LICENSE_HEADER,
+  UPDATE_LICENSE_HEADERS,
   LAST_SIGNAL
 };
 
@@ -59,6 +89,126 @@ comments_menu_class_init (CommentsMenuClass *klass)
                   NULL, NULL, 
                   g_cclosure_marshal_VOID__VOID, G_TYPE_NONE, 0);
 
+  comments_menu_signals[COMMENT_LINES] =
+    g_signal_new ("comment-lines", 
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST | G_SIGNAL_NO_RECURSE | G_SIGNAL_NO_HOOKS,
+                  G_STRUCT_OFFSET (CommentsMenuClass, comment_lines),
+                  NULL, NULL, 
+                  g_cclosure_marshal_VOID__VOID, G_TYPE_NONE, 0);
+
+  comments_menu_signals[UNCOMMENT_LINES] =
+    g_signal_new ("uncomment-lines", 
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST | G_SIGNAL_NO_RECURSE | G_SIGNAL_NO_HOOKS,
+                  G_STRUCT_OFFSET (CommentsMenuClass, uncomment_lines),
+                  NULL, NULL, 
+                  g_cclosure_marshal_VOID__VOID, G_TYPE_NONE, 0);
+
+  comments_menu_signals[COMMENT_DOCUMENT] =
+    g_signal_new ("comment-document", 
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST | G_SIGNAL_NO_RECURSE | G_SIGNAL_NO_HOOKS,
+                  G_STRUCT_OFFSET (CommentsMenuClass, comment_document),
+                  NULL, NULL, 
+                  g_cclosure_marshal_VOID__VOID, G_TYPE_NONE, 0);
+
+  comments_menu_signals[UNCOMMENT_DOCUMENT] =
+    g_signal_new ("uncomment-document", 
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST | G_SIGNAL_NO_RECURSE | G_SIGNAL_NO_HOOKS,
+                  G_STRUCT_OFFSET (CommentsMenuClass, uncomment_document),
+                  NULL, NULL, 
+                  g_cclosure_marshal_VOID__VOID, G_TYPE_NONE, 0);
+
+  comments_menu_signals[COMMENT_MATCHING] =
+    g_signal_new ("comment-matching", 
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST | G_SIGNAL_NO_RECURSE | G_SIGNAL_NO_HOOKS,
+                  G_STRUCT_OFFSET (CommentsMenuClass, comment_matching),
+                  NULL, NULL, 
+                  g_cclosure_marshal_VOID__VOID, G_TYPE_NONE, 0);
+
+  comments_menu_signals[STRIP_COMMENTS] =
+    g_signal_new ("strip-comments", 
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST | G_SIGNAL_NO_RECURSE | G_SIGNAL_NO_HOOKS,
+                  G_STRUCT_OFFSET (CommentsMenuClass, strip_comments),
+                  NULL, NULL, 
+                  g_cclosure_marshal_VOID__VOID, G_TYPE_NONE, 0);
+
+  comments_menu_signals[DENSITY_REPORT] =
+    g_signal_new ("density-report", 
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST | G_SIGNAL_NO_RECURSE | G_SIGNAL_NO_HOOKS,
+                  G_STRUCT_OFFSET (CommentsMenuClass, density_report),
+                  NULL, NULL, 
+                  g_cclosure_marshal_VOID__VOID, G_TYPE_NONE, 0);
+
+  comments_menu_signals[FIND_COMMENTED_CODE] =
+    g_signal_new ("find-commented-code", 
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST | G_SIGNAL_NO_RECURSE | G_SIGNAL_NO_HOOKS,
+                  G_STRUCT_OFFSET (CommentsMenuClass, find_commented_code),
+                  NULL, NULL, 
+                  g_cclosure_marshal_VOID__VOID, G_TYPE_NONE, 0);
+
+  comments_menu_signals[NEXT_COMMENT_BLOCK] =
+    g_signal_new ("next-comment-block", 
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST | G_SIGNAL_NO_RECURSE | G_SIGNAL_NO_HOOKS,
+                  G_STRUCT_OFFSET (CommentsMenuClass, next_comment_block),
+                  NULL, NULL, 
+                  g_cclosure_marshal_VOID__VOID, G_TYPE_NONE, 0);
+
+  comments_menu_signals[PREVIOUS_COMMENT_BLOCK] =
+    g_signal_new ("previous-comment-block", 
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST | G_SIGNAL_NO_RECURSE | G_SIGNAL_NO_HOOKS,
+                  G_STRUCT_OFFSET (CommentsMenuClass, previous_comment_block),
+                  NULL, NULL, 
+                  g_cclosure_marshal_VOID__VOID, G_TYPE_NONE, 0);
+
+  comments_menu_signals[SELECT_COMMENT_BLOCK] =
+    g_signal_new ("select-comment-block", 
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST | G_SIGNAL_NO_RECURSE | G_SIGNAL_NO_HOOKS,
+                  G_STRUCT_OFFSET (CommentsMenuClass, select_comment_block),
+                  NULL, NULL, 
+                  g_cclosure_marshal_VOID__VOID, G_TYPE_NONE, 0);
+
+  comments_menu_signals[REFLOW_COMMENT] =
+    g_signal_new ("reflow-comment", 
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST | G_SIGNAL_NO_RECURSE | G_SIGNAL_NO_HOOKS,
+                  G_STRUCT_OFFSET (CommentsMenuClass, reflow_comment),
+                  NULL, NULL, 
+                  g_cclosure_marshal_VOID__VOID, G_TYPE_NONE, 0);
+
+  comments_menu_signals[CONVERT_COMMENT_STYLE] =
+    g_signal_new ("convert-comment-style", 
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST | G_SIGNAL_NO_RECURSE | G_SIGNAL_NO_HOOKS,
+                  G_STRUCT_OFFSET (CommentsMenuClass, convert_comment_style),
+                  NULL, NULL, 
+                  g_cclosure_marshal_VOID__VOID, G_TYPE_NONE, 0);
+
+  comments_menu_signals[UPDATE_LICENSE_HEADER] =
+    g_signal_new ("update-license-header", 
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST | G_SIGNAL_NO_RECURSE | G_SIGNAL_NO_HOOKS,
+                  G_STRUCT_OFFSET (CommentsMenuClass, update_license_header),
+                  NULL, NULL, 
+                  g_cclosure_marshal_VOID__VOID, G_TYPE_NONE, 0);
+
+  comments_menu_signals[UPDATE_LICENSE_HEADERS] =
+    g_signal_new ("update-license-headers", 
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST | G_SIGNAL_NO_RECURSE | G_SIGNAL_NO_HOOKS,
+                  G_STRUCT_OFFSET (CommentsMenuClass, update_license_headers),
+                  NULL, NULL, 
+                  g_cclosure_marshal_VOID__VOID, G_TYPE_NONE, 0);
+
   G_OBJECT_CLASS (klass)->finalize = (GObjectFinalizeFunc) comments_menu_finalize;
 }
 
@@ -97,6 +247,21 @@ add_menu_items (CommentsMenu  *menu,
 {
   GtkWidget *comment_item;
   GtkWidget *uncomment_item;
+  GtkWidget *comment_lines_item;
+  GtkWidget *uncomment_lines_item;
+  GtkWidget *comment_document_item;
+  GtkWidget *uncomment_document_item;
+  GtkWidget *comment_matching_item;
+  GtkWidget *strip_comments_item;
+  GtkWidget *reflow_comment_item;
+  GtkWidget *convert_comment_style_item;
+  GtkWidget *next_comment_block_item;
+  GtkWidget *previous_comment_block_item;
+  GtkWidget *select_comment_block_item;
+  GtkWidget *density_report_item;
+  GtkWidget *find_commented_code_item;
+  GtkWidget *update_license_header_item;
+  GtkWidget *update_license_headers_item;
 
   comment_item = codeslayer_menu_item_new_with_label ("Comment");
   gtk_widget_add_accelerator (comment_item, "activate", accel_group, 
@@ -109,12 +274,108 @@ add_menu_items (CommentsMenu  *menu,
                               GDK_KEY_backslash, GDK_CONTROL_MASK, 
                               GTK_ACCEL_VISIBLE);  
   gtk_menu_shell_append (GTK_MENU_SHELL (submenu), uncomment_item);
+
+  gtk_menu_shell_append (GTK_MENU_SHELL (submenu), gtk_separator_menu_item_new ());
+
+  comment_lines_item = codeslayer_menu_item_new_with_label ("Comment Lines...");
+  gtk_menu_shell_append (GTK_MENU_SHELL (submenu), comment_lines_item);
+
+  uncomment_lines_item = codeslayer_menu_item_new_with_label ("Uncomment Lines...");
+  gtk_menu_shell_append (GTK_MENU_SHELL (submenu), uncomment_lines_item);
+
+  comment_document_item = codeslayer_menu_item_new_with_label ("Comment Document");
+  gtk_menu_shell_append (GTK_MENU_SHELL (submenu), comment_document_item);
+
+  uncomment_document_item = codeslayer_menu_item_new_with_label ("Uncomment Document");
+  gtk_menu_shell_append (GTK_MENU_SHELL (submenu), uncomment_document_item);
+
+  comment_matching_item = codeslayer_menu_item_new_with_label ("Comment Matching Lines...");
+  gtk_menu_shell_append (GTK_MENU_SHELL (submenu), comment_matching_item);
+
+  strip_comments_item = codeslayer_menu_item_new_with_label ("Strip Comments");
+  gtk_menu_shell_append (GTK_MENU_SHELL (submenu), strip_comments_item);
+
+  reflow_comment_item = codeslayer_menu_item_new_with_label ("Reflow Comment");
+  gtk_menu_shell_append (GTK_MENU_SHELL (submenu), reflow_comment_item);
+
+  convert_comment_style_item = codeslayer_menu_item_new_with_label ("Convert Comment Style");
+  gtk_menu_shell_append (GTK_MENU_SHELL (submenu), convert_comment_style_item);
+
+  update_license_header_item = codeslayer_menu_item_new_with_label ("Update License Header");
+  gtk_menu_shell_append (GTK_MENU_SHELL (submenu), update_license_header_item);
+
+  gtk_menu_shell_append (GTK_MENU_SHELL (submenu), gtk_separator_menu_item_new ());
+
+  next_comment_block_item = codeslayer_menu_item_new_with_label ("Next Comment Block");
+  gtk_menu_shell_append (GTK_MENU_SHELL (submenu), next_comment_block_item);
+
+  previous_comment_block_item = codeslayer_menu_item_new_with_label ("Previous Comment Block");
+  gtk_menu_shell_append (GTK_MENU_SHELL (submenu), previous_comment_block_item);
+
+  select_comment_block_item = codeslayer_menu_item_new_with_label ("Select Comment Block");
+  gtk_menu_shell_append (GTK_MENU_SHELL (submenu), select_comment_block_item);
+
+  gtk_menu_shell_append (GTK_MENU_SHELL (submenu), gtk_separator_menu_item_new ());
+
+  density_report_item = codeslayer_menu_item_new_with_label ("Comment Density Report");
+  gtk_menu_shell_append (GTK_MENU_SHELL (submenu), density_report_item);
+
+  find_commented_code_item = codeslayer_menu_item_new_with_label ("Find Commented-Out Code");
+  gtk_menu_shell_append (GTK_MENU_SHELL (submenu), find_commented_code_item);
+
+  update_license_headers_item = codeslayer_menu_item_new_with_label ("Update License Headers in Project");
+  gtk_menu_shell_append (GTK_MENU_SHELL (submenu), update_license_headers_item);
   
   g_signal_connect_swapped (G_OBJECT (comment_item), "activate", 
                             G_CALLBACK (comment_action), menu);
    
   g_signal_connect_swapped (G_OBJECT (uncomment_item), "activate", 
                             G_CALLBACK (uncomment_action), menu);
+   
+  g_signal_connect_swapped (G_OBJECT (comment_lines_item), "activate", 
+                            G_CALLBACK (comment_lines_action), menu);
+   
+  g_signal_connect_swapped (G_OBJECT (uncomment_lines_item), "activate", 
+                            G_CALLBACK (uncomment_lines_action), menu);
+   
+  g_signal_connect_swapped (G_OBJECT (comment_document_item), "activate", 
+                            G_CALLBACK (comment_document_action), menu);
+   
+  g_signal_connect_swapped (G_OBJECT (uncomment_document_item), "activate", 
+                            G_CALLBACK (uncomment_document_action), menu);
+   
+  g_signal_connect_swapped (G_OBJECT (comment_matching_item), "activate", 
+                            G_CALLBACK (comment_matching_action), menu);
+   
+  g_signal_connect_swapped (G_OBJECT (strip_comments_item), "activate", 
+                            G_CALLBACK (strip_comments_action), menu);
+   
+  g_signal_connect_swapped (G_OBJECT (reflow_comment_item), "activate", 
+                            G_CALLBACK (reflow_comment_action), menu);
+   
+  g_signal_connect_swapped (G_OBJECT (convert_comment_style_item), "activate", 
+                            G_CALLBACK (convert_comment_style_action), menu);
+   
+  g_signal_connect_swapped (G_OBJECT (next_comment_block_item), "activate", 
+                            G_CALLBACK (next_comment_block_action), menu);
+   
+  g_signal_connect_swapped (G_OBJECT (previous_comment_block_item), "activate", 
+                            G_CALLBACK (previous_comment_block_action), menu);
+   
+  g_signal_connect_swapped (G_OBJECT (select_comment_block_item), "activate", 
+                            G_CALLBACK (select_comment_block_action), menu);
+   
+  g_signal_connect_swapped (G_OBJECT (density_report_item), "activate", 
+                            G_CALLBACK (density_report_action), menu);
+   
+  g_signal_connect_swapped (G_OBJECT (find_commented_code_item), "activate", 
+                            G_CALLBACK (find_commented_code_action), menu);
+   
+  g_signal_connect_swapped (G_OBJECT (update_license_header_item), "activate", 
+                            G_CALLBACK (update_license_header_action), menu);
+   
+  g_signal_connect_swapped (G_OBJECT (update_license_headers_item), "activate", 
+                            G_CALLBACK (update_license_headers_action), menu);
 }
 
 static void 
@@ -128,3 +389,93 @@ uncomment_action (CommentsMenu *menu)
 {
   g_signal_emit_by_name ((gpointer) menu, "uncomment");
 }
+
+static void 
+comment_lines_action (CommentsMenu *menu) 
+{
+  g_signal_emit_by_name ((gpointer) menu, "comment-lines");
+}
+
+static void 
+uncomment_lines_action (CommentsMenu *menu) 
+{
+  g_signal_emit_by_name ((gpointer) menu, "uncomment-lines");
+}
+
+static void 
+comment_document_action (CommentsMenu *menu) 
+{
+  g_signal_emit_by_name ((gpointer) menu, "comment-document");
+}
+
+static void 
+uncomment_document_action (CommentsMenu *menu) 
+{
+  g_signal_emit_by_name ((gpointer) menu, "uncomment-document");
+}
+
+static void 
+comment_matching_action (CommentsMenu *menu) 
+{
+  g_signal_emit_by_name ((gpointer) menu, "comment-matching");
+}
+
+static void 
+strip_comments_action (CommentsMenu *menu) 
+{
+  g_signal_emit_by_name ((gpointer) menu, "strip-comments");
+}
+
+static void 
+reflow_comment_action (CommentsMenu *menu) 
+{
+  g_signal_emit_by_name ((gpointer) menu, "reflow-comment");
+}
+
+static void 
+convert_comment_style_action (CommentsMenu *menu) 
+{
+  g_signal_emit_by_name ((gpointer) menu, "convert-comment-style");
+}
+
+static void 
+next_comment_block_action (CommentsMenu *menu) 
+{
+  g_signal_emit_by_name ((gpointer) menu, "next-comment-block");
+}
+
+static void 
+previous_comment_block_action (CommentsMenu *menu) 
+{
+  g_signal_emit_by_name ((gpointer) menu, "previous-comment-block");
+}
+
+static void 
+select_comment_block_action (CommentsMenu *menu) 
+{
+  g_signal_emit_by_name ((gpointer) menu, "select-comment-block");
+}
+
+static void 
+density_report_action (CommentsMenu *menu) 
+{
+  g_signal_emit_by_name ((gpointer) menu, "density-report");
+}
+
+static void 
+find_commented_code_action (CommentsMenu *menu) 
+{
+  g_signal_emit_by_name ((gpointer) menu, "find-commented-code");
+}
+
+static void 
+update_license_header_action (CommentsMenu *menu) 
+{
+  g_signal_emit_by_name ((gpointer) menu, "update-license-header");
+}
+
+static void 
+update_license_headers_action (CommentsMenu *menu) 
+{
+  g_signal_emit_by_name ((gpointer) menu, "update-license-headers");
+}
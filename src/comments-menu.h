@@ -43,6 +43,21 @@ struct _CommentsMenuClass
 
   void (*comment) (CommentsMenu *menu);
   void (*uncomment) (CommentsMenu *menu);
+  void (*comment_lines) (CommentsMenu *menu);
+  void (*uncomment_lines) (CommentsMenu *menu);
+  void (*comment_document) (CommentsMenu *menu);
+  void (*uncomment_document) (CommentsMenu *menu);
+  void (*comment_matching) (CommentsMenu *menu);
+  void (*strip_comments) (CommentsMenu *menu);
+  void (*reflow_comment) (CommentsMenu *menu);
+  void (*convert_comment_style) (CommentsMenu *menu);
+  void (*next_comment_block) (CommentsMenu *menu);
+  void (*previous_comment_block) (CommentsMenu *menu);
+  void (*select_comment_block) (CommentsMenu *menu);
+  void (*density_report) (CommentsMenu *menu);
+  void (*find_commented_code) (CommentsMenu *menu);
+  void (*update_license_header) (CommentsMenu *menu);
+  void (*update_license_headers) (CommentsMenu *menu);
 };
 
 GType comments_menu_get_type (void) G_GNUC_CONST;
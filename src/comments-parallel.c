@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <string.h>
+#include "comments-parallel.h"
+
+typedef struct _Chunk Chunk;
+
+struct _Chunk
+{
+  const gchar *text;
+  gsize        length;
+  GString     *result;
+};
+
+/*
+ * The pool and the chunk array outlive each transform, so a transform
+ * only pushes work to threads that are already there. One transform runs
+ * at a time; the workers count down remaining and the caller waits on
+ * cond until it reaches zero.
+ */
+struct _CommentsParallel
+{
+  GThreadPool       *pool;
+  GArray            *chunks;
+  CommentsChunkFunc  func;
+  gpointer           user_data;
+  GMutex             mutex;
+  GCond              cond;
+  guint              remaining;
+};
+
+static void  split_chunks     (GArray           *chunks,
+                               const gchar      *text,
+                               gsize             length,
+                               guint             n_chunks);
+static void  transform_chunk  (Chunk            *chunk,
+                               CommentsParallel *parallel);
+
+CommentsParallel*
+comments_parallel_new (void)
+{
+  CommentsParallel *parallel;
+
+  parallel = g_new0 (CommentsParallel, 1);
+  parallel->pool = g_thread_pool_new ((GFunc) transform_chunk, parallel, 
+                                      g_get_num_processors (), FALSE, NULL);
+  parallel->chunks = g_array_new (FALSE, TRUE, sizeof (Chunk));
+  g_mutex_init (&parallel->mutex);
+  g_cond_init (&parallel->cond);
+
+  return parallel;
+}
+
+/*
+ * Run a line by line transform over the text and append what it makes to
+ * result, splitting big texts into chunks that each end on a newline and
+ * transforming the chunks on the thread pool. The func gets each chunk with
+ * its length and a string to append to, and must be safe to call from
+ * several threads at once. Since no line crosses a chunk boundary, joining
+ * the results gives exactly what a single call over the whole text would
+ * have. A text too small to split is transformed straight into result.
+ *
+ * The chunk strings come from the arena and go back to it once they are
+ * joined, so the passes of one action all write into the same ones.
+ */
+void
+comments_parallel_transform (CommentsParallel  *parallel,
+                             CommentsArena     *arena,
+                             GString           *result,
+                             const gchar       *text,
+                             gssize             length,
+                             CommentsChunkFunc  func,
+                             gpointer           user_data)
+{
+  guint n_threads;
+  guint n_chunks;
+  guint mark;
+  guint i;
+
+  if (length < 0)
+    length = strlen (text);
+
+  n_threads = g_get_num_processors ();
+  n_chunks = MIN (length / COMMENTS_PARALLEL_CHUNK_SIZE, n_threads * 2);
+
+  if (n_threads < 2 || n_chunks < 2)
+    {
+      func (result, text, length, user_data);
+      return;
+    }
+
+  split_chunks (parallel->chunks, text, length, n_chunks);
+
+  mark = comments_arena_mark (arena);
+  for (i = 0; i < parallel->chunks->len; i++)
+    g_array_index (parallel->chunks, Chunk, i).result = comments_arena_take (arena);
+
+  parallel->func = func;
+  parallel->user_data = user_data;
+  parallel->remaining = parallel->chunks->len;
+
+  for (i = 0; i < parallel->chunks->len; i++)
+    g_thread_pool_push (parallel->pool, &g_array_index (parallel->chunks, Chunk, i), 
+                        NULL);
+
+  g_mutex_lock (&parallel->mutex);
+  while (parallel->remaining > 0)
+    g_cond_wait (&parallel->cond, &parallel->mutex);
+  g_mutex_unlock (&parallel->mutex);
+
+  for (i = 0; i < parallel->chunks->len; i++)
+    {
+      Chunk *chunk = &g_array_index (parallel->chunks, Chunk, i);
+      g_string_append_len (result, chunk->result->str, chunk->result->len);
+    }
+
+  comments_arena_release (arena, mark);
+}
+
+void
+comments_parallel_free (CommentsParallel *parallel)
+{
+  g_thread_pool_free (parallel->pool, FALSE, TRUE);
+  g_array_free (parallel->chunks, TRUE);
+  g_mutex_clear (&parallel->mutex);
+  g_cond_clear (&parallel->cond);
+  g_free (parallel);
+}
+
+/*
+ * Cut the text into roughly equal pieces, moving each cut forward to just
+ * after the next \n. A lone \r also ends a line, but cutting only at \n
+ * keeps a \r\n pair in one piece.
+ */
+static void
+split_chunks (GArray      *chunks,
+              const gchar *text,
+              gsize        length,
+              guint        n_chunks)
+{
+  gsize offset = 0;
+  guint i;
+
+  g_array_set_size (chunks, 0);
+
+  for (i = 1; i <= n_chunks && offset < length; i++)
+    {
+      Chunk chunk = { NULL, 0, NULL };
+      gsize cut;
+
+      cut = (i == n_chunks) ? length : length / n_chunks * i;
+
+      if (cut <= offset)
+        continue;
+
+      if (cut < length)
+        {
+          const gchar *newline;
+          newline = memchr (text + cut, '\n', length - cut);
+          cut = newline != NULL ? (gsize) (newline - text) + 1 : length;
+        }
+
+      chunk.text = text + offset;
+      chunk.length = cut - offset;
+      g_array_append_val (chunks, chunk);
+
+      offset = cut;
+    }
+}
+
+static void
+transform_chunk (Chunk            *chunk,
+                 CommentsParallel *parallel)
+{
+  gsize expected;
+
+  /* room for a delimiter on most lines, unless a last pass left enough */
+  expected = chunk->length + chunk->length / 8;
+  if (chunk->result->allocated_len <= expected)
+    {
+      g_string_set_size (chunk->result, expected);
+      g_string_truncate (chunk->result, 0);
+    }
+
+  parallel->func (chunk->result, chunk->text, chunk->length, 
+                  parallel->user_data);
+
+  g_mutex_lock (&parallel->mutex);
+  if (--parallel->remaining == 0)
+    g_cond_signal (&parallel->cond);
+  g_mutex_unlock (&parallel->mutex);
+}
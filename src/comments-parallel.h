@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __COMMENTS_PARALLEL_H__
+#define	__COMMENTS_PARALLEL_H__
+
+#include <glib.h>
+#include "comments-arena.h"
+
+G_BEGIN_DECLS
+
+/* below this many bytes per chunk the text is transformed in one go */
+#define COMMENTS_PARALLEL_CHUNK_SIZE (1024 * 1024)
+
+typedef void (*CommentsChunkFunc) (GString     *result,
+                                   const gchar *text,
+                                   gsize        length,
+                                   gpointer     user_data);
+
+typedef struct _CommentsParallel CommentsParallel;
+
+CommentsParallel*  comments_parallel_new        (void);
+void               comments_parallel_transform  (CommentsParallel  *parallel,
+                                                 CommentsArena     *arena,
+                                                 GString           *result,
+                                                 const gchar       *text,
+                                                 gssize             length,
+                                                 CommentsChunkFunc  func,
+                                                 gpointer           user_data);
+void               comments_parallel_free       (CommentsParallel  *parallel);
+
+G_END_DECLS
+
+#endif /* __COMMENTS_PARALLEL_H__ */
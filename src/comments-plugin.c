@@ -17,6 +17,7 @@
  */
 
 #include <codeslayer/codeslayer.h>
+#include "comments-plugin.h"
 #include "comments-engine.h"
 #include "comments-menu.h"
 #include <gtk/gtk.h>
@@ -33,12 +34,25 @@ static CommentsEngine *engine;
 G_MODULE_EXPORT void
 activate (CodeSlayer *codeslayer)
 {
+  const gchar *trace_path;
   GtkAccelGroup *accel_group;
   accel_group = codeslayer_get_menu_bar_accel_group (codeslayer);
   menu = comments_menu_new (accel_group);
 
   engine = comments_engine_new (codeslayer, menu);
   comments_engine_load_configs (engine);
+
+  /* recording the actions is opt in, for collecting replayable traces */
+  trace_path = g_getenv ("COMMENTS_RECORD");
+  if (trace_path != NULL && *trace_path != '\0')
+    {
+      GError *error = NULL;
+      if (!comments_engine_start_recording (engine, trace_path, &error))
+        {
+          g_warning ("Comments: cannot record to %s", error->message);
+          g_error_free (error);
+        }
+    }
   
   codeslayer_add_to_menu_bar (codeslayer, GTK_MENU_ITEM (menu));
 }
@@ -48,6 +62,7 @@ deactivate (CodeSlayer *codeslayer)
 {
   codeslayer_remove_from_menu_bar (codeslayer, GTK_MENU_ITEM (menu));
   g_object_unref (engine);
+  engine = NULL;
 }
 
 G_MODULE_EXPORT void 
@@ -55,3 +70,21 @@ configure  (CodeSlayer *codeslayer)
 {
   comments_engine_open_dialog (engine);
 }
+
+/*
+ * The entry point other plugins call comments_engine_apply_ranges through.
+ * Returns FALSE when the plugin is not active or the document has no
+ * config.
+ */
+G_MODULE_EXPORT gboolean
+comments_apply_ranges (CodeSlayerDocument  *document,
+                       const CommentsRange *ranges,
+                       guint                n_ranges,
+                       CommentsOperation    operation)
+{
+  if (engine == NULL)
+    return FALSE;
+
+  return comments_engine_apply_ranges (engine, document, ranges, n_ranges, 
+                                       operation);
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __COMMENTS_PLUGIN_H__
+#define	__COMMENTS_PLUGIN_H__
+
+#include <gmodule.h>
+#include <codeslayer/codeslayer.h>
+
+G_BEGIN_DECLS
+
+/*
+ * What the comments plugin offers other plugins. The plugin is loaded as
+ * a module, so look comments_apply_ranges up with g_module_symbol rather
+ * than linking to it:
+ *
+ *   CommentsApplyRangesFunc apply_ranges;
+ *   if (g_module_symbol (module, "comments_apply_ranges", 
+ *                        (gpointer *) &apply_ranges))
+ *     apply_ranges (document, ranges, n_ranges, COMMENTS_OPERATION_COMMENT);
+ */
+
+typedef struct _CommentsRange CommentsRange;
+
+typedef enum
+{
+  COMMENTS_OPERATION_COMMENT,
+  COMMENTS_OPERATION_UNCOMMENT
+} CommentsOperation;
+
+typedef enum
+{
+  COMMENTS_RANGE_LINES,
+  COMMENTS_RANGE_OFFSETS
+} CommentsRangeUnit;
+
+/*
+ * Lines run from start to end inclusive; character offsets run from start
+ * up to but not including end.
+ */
+struct _CommentsRange
+{
+  CommentsRangeUnit unit;
+  gint              start;
+  gint              end;
+};
+
+typedef gboolean (*CommentsApplyRangesFunc) (CodeSlayerDocument  *document,
+                                             const CommentsRange *ranges,
+                                             guint                n_ranges,
+                                             CommentsOperation    operation);
+
+G_MODULE_EXPORT gboolean comments_apply_ranges (CodeSlayerDocument  *document,
+                                                const CommentsRange *ranges,
+                                                guint                n_ranges,
+                                                CommentsOperation    operation);
+
+G_END_DECLS
+
+#endif /* __COMMENTS_PLUGIN_H__ */
@@ -0,0 +1,273 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <glib/gstdio.h>
+#include "comments-recorder.h"
+
+/*
+ * A trace is a text file with one action per line and tab separated
+ * fields:
+ *
+ *   operation count suffix start end flags length lines hash microseconds
+ *
+ * The suffix is the file type of the document, start and end are its
+ * delimiters escaped with g_strescape, and the flags are "i" for indent
+ * and "p" for padding, or "-" for neither. Lines starting with # are
+ * comments. Records are appended and flushed one at a time, so traces from
+ * several sessions can share a file and a crash loses at most the action
+ * that was being written.
+ */
+
+#define TRACE_HEADER "# operation\tcount\tsuffix\tstart\tend\tflags\tlength\tlines\thash\tmicroseconds\n"
+#define FIELD_COUNT 10
+
+struct _CommentsRecorder
+{
+  FILE *file;
+};
+
+static gchar*  get_suffix  (const gchar *file_path);
+static guint32 hash_text   (const gchar *text,
+                            gsize        length);
+static guint   count_lines (const gchar *text,
+                            gsize        length);
+static CommentsRecord* parse_record (const gchar *line);
+
+CommentsRecorder*
+comments_recorder_new (const gchar  *file_path,
+                       GError      **error)
+{
+  CommentsRecorder *recorder;
+  FILE *file;
+
+  file = g_fopen (file_path, "a");
+  if (file == NULL)
+    {
+      gint saved_errno = errno;
+      g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (saved_errno),
+                   "%s: %s", file_path, g_strerror (saved_errno));
+      return NULL;
+    }
+
+  if (fseek (file, 0, SEEK_END) == 0 && ftell (file) == 0)
+    fputs (TRACE_HEADER, file);
+
+  recorder = g_new0 (CommentsRecorder, 1);
+  recorder->file = file;
+
+  return recorder;
+}
+
+/*
+ * Write one action to the trace. The text is what the action worked on,
+ * or NULL when it did not read the buffer; it is only measured and hashed.
+ */
+void
+comments_recorder_record (CommentsRecorder *recorder,
+                          const gchar      *operation,
+                          guint             count,
+                          const gchar      *file_path,
+                          CommentsConfig   *config,
+                          const gchar      *text,
+                          gint64            duration)
+{
+  const gchar *start;
+  const gchar *end;
+  gchar *suffix;
+  gchar *start_escaped;
+  gchar *end_escaped;
+  gchar flags[3];
+  gchar *flag;
+  gsize length;
+
+  start = comments_config_get_start (config);
+  end = comments_config_get_end (config);
+
+  suffix = get_suffix (file_path);
+  start_escaped = g_strescape (start != NULL ? start : "", NULL);
+  end_escaped = g_strescape (end != NULL ? end : "", NULL);
+
+  flag = flags;
+  if (comments_config_get_indent (config))
+    *flag++ = 'i';
+  if (comments_config_get_padding (config))
+    *flag++ = 'p';
+  if (flag == flags)
+    *flag++ = '-';
+  *flag = '\0';
+
+  length = text != NULL ? strlen (text) : 0;
+
+  fprintf (recorder->file, 
+           "%s\t%u\t%s\t%s\t%s\t%s\t%" G_GSIZE_FORMAT "\t%u\t%08x\t%" G_GINT64_FORMAT "\n",
+           operation, count, suffix, start_escaped, end_escaped, flags, length,
+           count_lines (text, length), hash_text (text, length), duration);
+  fflush (recorder->file);
+
+  g_free (suffix);
+  g_free (start_escaped);
+  g_free (end_escaped);
+}
+
+void
+comments_recorder_free (CommentsRecorder *recorder)
+{
+  fclose (recorder->file);
+  g_free (recorder);
+}
+
+/*
+ * Read a trace back as an array of CommentsRecord. Lines that do not parse,
+ * such as one cut short when the editor went down, are skipped.
+ */
+GPtrArray*
+comments_recorder_load (const gchar  *file_path,
+                        GError      **error)
+{
+  GPtrArray *records;
+  gchar *contents;
+  gchar **lines;
+  gchar **line;
+
+  if (!g_file_get_contents (file_path, &contents, NULL, error))
+    return NULL;
+
+  records = g_ptr_array_new_with_free_func ((GDestroyNotify) comments_record_free);
+
+  lines = g_strsplit (contents, "\n", -1);
+  g_free (contents);
+
+  for (line = lines; *line != NULL; line++)
+    {
+      CommentsRecord *record;
+
+      if (**line == '\0' || **line == '#')
+        continue;
+
+      record = parse_record (*line);
+      if (record != NULL)
+        g_ptr_array_add (records, record);
+    }
+
+  g_strfreev (lines);
+
+  return records;
+}
+
+void
+comments_record_free (CommentsRecord *record)
+{
+  g_free (record->operation);
+  g_free (record->suffix);
+  g_free (record->start);
+  g_free (record->end);
+  g_free (record);
+}
+
+static CommentsRecord*
+parse_record (const gchar *line)
+{
+  CommentsRecord *record;
+  gchar **fields;
+
+  fields = g_strsplit (line, "\t", FIELD_COUNT);
+  if (g_strv_length (fields) != FIELD_COUNT)
+    {
+      g_strfreev (fields);
+      return NULL;
+    }
+
+  record = g_new0 (CommentsRecord, 1);
+  record->operation = g_strdup (fields[0]);
+  record->count = g_ascii_strtoull (fields[1], NULL, 10);
+  record->suffix = g_strcompress (fields[2]);
+  record->start = g_strcompress (fields[3]);
+  record->end = g_strcompress (fields[4]);
+  record->indent = strchr (fields[5], 'i') != NULL;
+  record->padding = strchr (fields[5], 'p') != NULL;
+  record->length = g_ascii_strtoull (fields[6], NULL, 10);
+  record->lines = g_ascii_strtoull (fields[7], NULL, 10);
+  record->hash = g_ascii_strtoull (fields[8], NULL, 16);
+  record->duration = g_ascii_strtoll (fields[9], NULL, 10);
+
+  g_strfreev (fields);
+
+  return record;
+}
+
+/*
+ * The file type is taken to be everything from the last dot of the file
+ * name, or the whole name when there is no dot, as in Makefile.
+ */
+static gchar*
+get_suffix (const gchar *file_path)
+{
+  const gchar *name;
+  const gchar *dot;
+
+  if (file_path == NULL)
+    return g_strdup ("");
+
+  name = strrchr (file_path, G_DIR_SEPARATOR);
+  name = name != NULL ? name + 1 : file_path;
+
+  dot = strrchr (name, '.');
+
+  return g_strescape (dot != NULL ? dot : name, NULL);
+}
+
+/* 32 bit FNV-1a */
+static guint32
+hash_text (const gchar *text,
+           gsize        length)
+{
+  guint32 hash = 2166136261u;
+  gsize i;
+
+  for (i = 0; i < length; i++)
+    {
+      hash ^= (guchar) text[i];
+      hash *= 16777619u;
+    }
+
+  return hash;
+}
+
+static guint
+count_lines (const gchar *text,
+             gsize        length)
+{
+  const gchar *end;
+  guint lines = 0;
+
+  if (length == 0)
+    return 0;
+
+  end = text + length;
+
+  while ((text = memchr (text, '\n', end - text)) != NULL)
+    {
+      lines++;
+      text++;
+    }
+
+  return lines + 1;
+}
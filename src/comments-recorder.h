@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __COMMENTS_RECORDER_H__
+#define	__COMMENTS_RECORDER_H__
+
+#include <glib.h>
+#include "comments-config.h"
+
+G_BEGIN_DECLS
+
+typedef struct _CommentsRecorder CommentsRecorder;
+typedef struct _CommentsRecord CommentsRecord;
+
+/*
+ * One action as it was written to a trace. Only the shape of the text is
+ * kept: its length in bytes, its line count and a hash of the content.
+ */
+struct _CommentsRecord
+{
+  gchar    *operation;
+  guint     count;
+  gchar    *suffix;
+  gchar    *start;
+  gchar    *end;
+  gboolean  indent;
+  gboolean  padding;
+  gsize     length;
+  guint     lines;
+  guint32   hash;
+  gint64    duration;
+};
+
+CommentsRecorder*  comments_recorder_new     (const gchar      *file_path,
+                                              GError          **error);
+void               comments_recorder_record  (CommentsRecorder *recorder,
+                                              const gchar      *operation,
+                                              guint             count,
+                                              const gchar      *file_path,
+                                              CommentsConfig   *config,
+                                              const gchar      *text,
+                                              gint64            duration);
+void               comments_recorder_free    (CommentsRecorder *recorder);
+
+GPtrArray*         comments_recorder_load    (const gchar      *file_path,
+                                              GError          **error);
+void               comments_record_free      (CommentsRecord   *record);
+
+G_END_DECLS
+
+#endif /* __COMMENTS_RECORDER_H__ */
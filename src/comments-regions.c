@@ -0,0 +1,511 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <string.h>
+#include "comments-regions.h"
+
+/*
+ * Works out which language the text at an iter is written in for files
+ * that embed one language in another, such as the scripts and styles in
+ * an HTML page or the code in a PHP page. GtkSourceView does not say which
+ * embedded language it highlighted a spot with, so the tags that open and
+ * close each embedded block are looked for around the iter instead.
+ *
+ * Every lookup leaves behind the region it found, held between two marks,
+ * so more actions in the same block are answered without searching the
+ * buffer again. Two more marks take in the tags on either side of it. An
+ * edit to the text of those tags, or one within the region that could add
+ * or break a tag, drops it. Tags are matched without regard to case.
+ */
+
+#define REGIONS "comments_regions"
+
+/* the longest tag, </script>, so a < this far back may start one */
+#define TAG_REACH 9
+
+typedef struct _Embedding Embedding;
+typedef struct _Host Host;
+typedef struct _Region Region;
+typedef struct _Regions Regions;
+
+struct _Embedding
+{
+  const gchar *open;
+  const gchar *close;
+  const gchar *file_type;
+};
+
+struct _Host
+{
+  const gchar     *suffix;
+  const gchar     *outside;
+  const Embedding *embeddings;
+  guint            n_embeddings;
+};
+
+/*
+ * start to end is the text the file type applies to, and outer_start to
+ * outer_end runs on over the tags that bound it. A region that is itself
+ * an opening tag is dropped by any edit to it.
+ */
+struct _Region
+{
+  GtkTextMark *start;
+  GtkTextMark *end;
+  GtkTextMark *outer_start;
+  GtkTextMark *outer_end;
+  const gchar *file_type;
+  gboolean     tag;
+};
+
+struct _Regions
+{
+  const Host *host;
+  GList      *list;
+};
+
+static const Embedding html_embeddings[] =
+{
+  { "<script", "</script>", ".js" },
+  { "<style", "</style>", ".css" }
+};
+
+static const Embedding php_embeddings[] =
+{
+  { "<?php", "?>", ".php" },
+  { "<script", "</script>", ".js" },
+  { "<style", "</style>", ".css" }
+};
+
+/* outside of the embedded blocks a NULL file type means the file's own */
+static const Host hosts[] =
+{
+  { ".html", NULL, html_embeddings, G_N_ELEMENTS (html_embeddings) },
+  { ".htm", NULL, html_embeddings, G_N_ELEMENTS (html_embeddings) },
+  { ".xhtml", NULL, html_embeddings, G_N_ELEMENTS (html_embeddings) },
+  { ".php", ".html", php_embeddings, G_N_ELEMENTS (php_embeddings) }
+};
+
+static const Host* find_host       (const gchar       *file_path);
+static Regions*    get_regions     (GtkTextBuffer     *buffer);
+static Region*     scan_region     (GtkTextBuffer     *buffer,
+                                    const Host        *host,
+                                    const GtkTextIter *iter);
+static Region*     new_region      (GtkTextBuffer     *buffer,
+                                    const GtkTextIter *outer_start,
+                                    const GtkTextIter *start,
+                                    const GtkTextIter *end,
+                                    const GtkTextIter *outer_end,
+                                    const gchar       *file_type);
+static gboolean    region_touches  (GtkTextBuffer     *buffer,
+                                    Region            *region,
+                                    const GtkTextIter *start,
+                                    const GtkTextIter *end,
+                                    gboolean           strict);
+static void        drop_regions    (GtkTextBuffer     *buffer,
+                                    Regions           *regions,
+                                    const GtkTextIter *start,
+                                    const GtkTextIter *end,
+                                    gboolean           strict);
+static gboolean    overlaps        (GtkTextBuffer     *buffer,
+                                    GtkTextMark       *mark_start,
+                                    GtkTextMark       *mark_end,
+                                    const GtkTextIter *start,
+                                    const GtkTextIter *end);
+static void        delete_region   (GtkTextBuffer     *buffer,
+                                    Region            *region);
+static void        clear_regions   (GtkTextBuffer     *buffer,
+                                    Regions           *regions);
+static void        free_regions    (Regions           *regions);
+static void        insert_text     (GtkTextBuffer     *buffer,
+                                    GtkTextIter       *iter,
+                                    gchar             *text,
+                                    gint               length,
+                                    Regions           *regions);
+static void        delete_range    (GtkTextBuffer     *buffer,
+                                    GtkTextIter       *start,
+                                    GtkTextIter       *end,
+                                    Regions           *regions);
+static gboolean    after_tag_start (const GtkTextIter *iter);
+static gboolean    is_tag_char     (gunichar           ch,
+                                    gpointer           user_data);
+static gboolean    is_tag_end      (gunichar           ch,
+                                    gpointer           user_data);
+
+/*
+ * Returns the file type to resolve the config at iter with, or NULL when
+ * the file's own config applies.
+ */
+const gchar*
+comments_regions_lookup (GtkTextBuffer     *buffer,
+                         const gchar       *file_path,
+                         const GtkTextIter *iter)
+{
+  const Host *host;
+  Regions *regions;
+  Region *region;
+  GList *list;
+
+  host = find_host (file_path);
+  if (host == NULL)
+    return NULL;
+
+  regions = get_regions (buffer);
+
+  if (regions->host != host)
+    {
+      clear_regions (buffer, regions);
+      regions->host = host;
+    }
+
+  for (list = regions->list; list != NULL; list = list->next)
+    {
+      region = list->data;
+      if (region_touches (buffer, region, iter, iter, FALSE))
+        return region->file_type;
+    }
+
+  region = scan_region (buffer, host, iter);
+  regions->list = g_list_prepend (regions->list, region);
+
+  return region->file_type;
+}
+
+static const Host*
+find_host (const gchar *file_path)
+{
+  guint i;
+
+  if (file_path == NULL)
+    return NULL;
+
+  for (i = 0; i < G_N_ELEMENTS (hosts); i++)
+    if (g_str_has_suffix (file_path, hosts[i].suffix))
+      return &hosts[i];
+
+  return NULL;
+}
+
+static Regions*
+get_regions (GtkTextBuffer *buffer)
+{
+  Regions *regions;
+
+  regions = g_object_get_data (G_OBJECT (buffer), REGIONS);
+  if (regions != NULL)
+    return regions;
+
+  regions = g_new0 (Regions, 1);
+  g_object_set_data_full (G_OBJECT (buffer), REGIONS, regions, 
+                          (GDestroyNotify) free_regions);
+
+  g_signal_connect (G_OBJECT (buffer), "insert-text", 
+                    G_CALLBACK (insert_text), regions);
+  g_signal_connect (G_OBJECT (buffer), "delete-range", 
+                    G_CALLBACK (delete_range), regions);
+
+  return regions;
+}
+
+/*
+ * The block around iter is opened by the nearest opening tag before it.
+ * When that block was closed before iter, iter is in the host language
+ * from the closing tag up to the next opening tag.
+ */
+static Region*
+scan_region (GtkTextBuffer     *buffer,
+             const Host        *host,
+             const GtkTextIter *iter)
+{
+  const Embedding *embedding = NULL;
+  GtkTextIter open_start, open_end;
+  GtkTextIter match_start, match_end;
+  GtkTextIter outer_start, start, end, outer_end;
+  guint i;
+
+  gtk_text_buffer_get_bounds (buffer, &start, &end);
+  outer_start = start;
+  outer_end = end;
+
+  for (i = 0; i < host->n_embeddings; i++)
+    {
+      if (gtk_text_iter_backward_search (iter, host->embeddings[i].open, 
+                                         GTK_TEXT_SEARCH_CASE_INSENSITIVE,
+                                         &match_start, &match_end, NULL) &&
+          (embedding == NULL || 
+           gtk_text_iter_compare (&match_start, &open_start) > 0))
+        {
+          embedding = &host->embeddings[i];
+          open_start = match_start;
+          open_end = match_end;
+        }
+    }
+
+  if (embedding != NULL)
+    {
+      GtkTextIter inner;
+      GtkTextIter close_start, close_end;
+
+      /* an element's opening tag runs on to its > */
+      inner = open_end;
+      if (embedding->open[1] != '?' &&
+          gtk_text_iter_forward_find_char (&inner, is_tag_end, NULL, NULL))
+        gtk_text_iter_forward_char (&inner);
+
+      if (!gtk_text_iter_forward_search (&inner, embedding->close, 
+                                         GTK_TEXT_SEARCH_CASE_INSENSITIVE,
+                                         &close_start, &close_end, NULL))
+        close_start = close_end = end;
+
+      if (gtk_text_iter_compare (iter, &inner) < 0)
+        {
+          Region *region;
+          region = new_region (buffer, &open_start, &open_start, &inner, &inner, 
+                               host->outside);
+          region->tag = TRUE;
+          return region;
+        }
+
+      if (gtk_text_iter_compare (iter, &close_start) <= 0)
+        return new_region (buffer, &open_start, &inner, &close_start, &close_end, 
+                           embedding->file_type);
+
+      outer_start = close_start;
+      start = close_end;
+    }
+
+  for (i = 0; i < host->n_embeddings; i++)
+    {
+      if (gtk_text_iter_forward_search (iter, host->embeddings[i].open, 
+                                        GTK_TEXT_SEARCH_CASE_INSENSITIVE,
+                                        &match_start, &match_end, &end))
+        {
+          end = match_start;
+          outer_end = match_end;
+        }
+    }
+
+  return new_region (buffer, &outer_start, &start, &end, &outer_end, 
+                     host->outside);
+}
+
+static Region*
+new_region (GtkTextBuffer     *buffer,
+            const GtkTextIter *outer_start,
+            const GtkTextIter *start,
+            const GtkTextIter *end,
+            const GtkTextIter *outer_end,
+            const gchar       *file_type)
+{
+  Region *region;
+
+  region = g_new0 (Region, 1);
+  region->start = gtk_text_buffer_create_mark (buffer, NULL, start, TRUE);
+  region->end = gtk_text_buffer_create_mark (buffer, NULL, end, FALSE);
+  region->outer_start = gtk_text_buffer_create_mark (buffer, NULL, outer_start, TRUE);
+  region->outer_end = gtk_text_buffer_create_mark (buffer, NULL, outer_end, FALSE);
+  region->file_type = file_type;
+
+  return region;
+}
+
+/*
+ * Whether start to end falls within the region, taking in its bounds
+ * unless strict is set.
+ */
+static gboolean
+region_touches (GtkTextBuffer     *buffer,
+                Region            *region,
+                const GtkTextIter *start,
+                const GtkTextIter *end,
+                gboolean           strict)
+{
+  GtkTextIter region_start, region_end;
+  gint bound;
+
+  gtk_text_buffer_get_iter_at_mark (buffer, &region_start, region->start);
+  gtk_text_buffer_get_iter_at_mark (buffer, &region_end, region->end);
+
+  bound = strict ? 1 : 0;
+
+  return gtk_text_iter_compare (start, &region_start) >= bound &&
+         gtk_text_iter_compare (&region_end, end) >= bound;
+}
+
+/*
+ * Drop every region start to end reaches the bounding tags of, and every
+ * region it overlaps, except, when strict is set, one it lies strictly
+ * inside of.
+ */
+static void
+drop_regions (GtkTextBuffer     *buffer,
+              Regions           *regions,
+              const GtkTextIter *start,
+              const GtkTextIter *end,
+              gboolean           strict)
+{
+  GList *list;
+
+  list = regions->list;
+  while (list != NULL)
+    {
+      Region *region = list->data;
+      GList *next = list->next;
+      gboolean drop;
+
+      if (overlaps (buffer, region->outer_start, region->start, start, end) ||
+          overlaps (buffer, region->end, region->outer_end, start, end))
+        drop = TRUE;
+      else if (!overlaps (buffer, region->start, region->end, start, end))
+        drop = FALSE;
+      else
+        drop = region->tag || !strict || 
+               !region_touches (buffer, region, start, end, TRUE);
+
+      if (drop)
+        {
+          delete_region (buffer, region);
+          regions->list = g_list_delete_link (regions->list, list);
+        }
+
+      list = next;
+    }
+}
+
+/*
+ * Whether start to end overlaps or meets mark_start to mark_end.
+ */
+static gboolean
+overlaps (GtkTextBuffer     *buffer,
+          GtkTextMark       *mark_start,
+          GtkTextMark       *mark_end,
+          const GtkTextIter *start,
+          const GtkTextIter *end)
+{
+  GtkTextIter iter_start, iter_end;
+
+  gtk_text_buffer_get_iter_at_mark (buffer, &iter_start, mark_start);
+  gtk_text_buffer_get_iter_at_mark (buffer, &iter_end, mark_end);
+
+  return gtk_text_iter_compare (end, &iter_start) >= 0 &&
+         gtk_text_iter_compare (&iter_end, start) >= 0;
+}
+
+static void
+delete_region (GtkTextBuffer *buffer,
+               Region        *region)
+{
+  gtk_text_buffer_delete_mark (buffer, region->start);
+  gtk_text_buffer_delete_mark (buffer, region->end);
+  gtk_text_buffer_delete_mark (buffer, region->outer_start);
+  gtk_text_buffer_delete_mark (buffer, region->outer_end);
+  g_free (region);
+}
+
+static void
+clear_regions (GtkTextBuffer *buffer,
+               Regions       *regions)
+{
+  GList *list;
+
+  for (list = regions->list; list != NULL; list = list->next)
+    delete_region (buffer, list->data);
+
+  g_list_free (regions->list);
+  regions->list = NULL;
+}
+
+/* the buffer is going away with its marks, so only the regions are freed */
+static void
+free_regions (Regions *regions)
+{
+  g_list_free_full (regions->list, g_free);
+  g_free (regions);
+}
+
+/*
+ * Text without a < or > cannot open or close a block, so inside a region
+ * it only moves it; anything else drops that region, as does an edit just
+ * after a < that could turn it into a tag. Text that goes into one of the
+ * tags always drops the regions it bounds.
+ */
+static void
+insert_text (GtkTextBuffer *buffer,
+             GtkTextIter   *iter,
+             gchar         *text,
+             gint           length,
+             Regions       *regions)
+{
+  gboolean strict;
+
+  if (regions->list == NULL)
+    return;
+
+  strict = memchr (text, '<', length) == NULL && 
+           memchr (text, '>', length) == NULL &&
+           !after_tag_start (iter);
+
+  drop_regions (buffer, regions, iter, iter, strict);
+}
+
+static void
+delete_range (GtkTextBuffer *buffer,
+              GtkTextIter   *start,
+              GtkTextIter   *end,
+              Regions       *regions)
+{
+  GtkTextIter iter;
+  gboolean strict;
+
+  if (regions->list == NULL)
+    return;
+
+  iter = *start;
+  strict = !gtk_text_iter_forward_find_char (&iter, is_tag_char, NULL, end) &&
+           !after_tag_start (start);
+
+  drop_regions (buffer, regions, start, end, strict);
+}
+
+static gboolean
+after_tag_start (const GtkTextIter *iter)
+{
+  GtkTextIter limit;
+  GtkTextIter search;
+
+  limit = *iter;
+  gtk_text_iter_backward_chars (&limit, TAG_REACH);
+
+  search = *iter;
+  return gtk_text_iter_backward_find_char (&search, is_tag_char, NULL, &limit) &&
+         gtk_text_iter_get_char (&search) == '<';
+}
+
+static gboolean
+is_tag_char (gunichar  ch,
+             gpointer  user_data)
+{
+  return ch == '<' || ch == '>';
+}
+
+static gboolean
+is_tag_end (gunichar  ch,
+            gpointer  user_data)
+{
+  return ch == '>';
+}
@@ -0,0 +1,280 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "comments-report.h"
+#include "comments-scanner.h"
+
+static void comments_report_class_init  (CommentsReportClass  *klass);
+static void comments_report_init        (CommentsReport       *report);
+static void comments_report_finalize    (CommentsReport       *report);
+
+static void add_content_area            (CommentsReport       *report);
+static void load_stats                  (CommentsReport       *report);
+static void add_column                  (GtkWidget            *tree,
+                                         const gchar          *title,
+                                         gint                  column);
+static void render_ratio                (GtkTreeViewColumn    *column,
+                                         GtkCellRenderer      *renderer,
+                                         GtkTreeModel         *model,
+                                         GtkTreeIter          *iter,
+                                         gpointer              data);
+
+#define COMMENTS_REPORT_GET_PRIVATE(obj) \
+  (G_TYPE_INSTANCE_GET_PRIVATE ((obj), COMMENTS_REPORT_TYPE, CommentsReportPrivate))
+
+typedef struct _CommentsReportPrivate CommentsReportPrivate;
+
+struct _CommentsReportPrivate
+{
+  gchar        *folder_path;
+  GPtrArray    *stats;
+  GtkListStore *store;
+};
+
+enum
+{
+  PATH = 0,
+  TYPE,
+  FILES,
+  CODE,
+  COMMENT,
+  BLANK,
+  RATIO,
+  COLUMNS
+};
+
+G_DEFINE_TYPE (CommentsReport, comments_report, GTK_TYPE_DIALOG)
+
+static void 
+comments_report_class_init (CommentsReportClass *klass)
+{
+  G_OBJECT_CLASS (klass)->finalize = (GObjectFinalizeFunc) comments_report_finalize;
+  g_type_class_add_private (klass, sizeof (CommentsReportPrivate));
+}
+
+static void
+comments_report_init (CommentsReport *report)
+{
+  CommentsReportPrivate *priv;
+  priv = COMMENTS_REPORT_GET_PRIVATE (report);
+  priv->folder_path = NULL;
+  priv->stats = NULL;
+
+  gtk_window_set_title (GTK_WINDOW (report), "Comment Density Report");
+  gtk_window_set_skip_taskbar_hint (GTK_WINDOW (report), TRUE);
+  gtk_window_set_skip_pager_hint (GTK_WINDOW (report), TRUE);
+}
+
+static void
+comments_report_finalize (CommentsReport *report)
+{
+  CommentsReportPrivate *priv;
+  priv = COMMENTS_REPORT_GET_PRIVATE (report);
+  if (priv->folder_path)
+    {
+      g_free (priv->folder_path);
+      priv->folder_path = NULL;
+    }
+  if (priv->stats)
+    {
+      g_ptr_array_unref (priv->stats);
+      priv->stats = NULL;
+    }
+  G_OBJECT_CLASS (comments_report_parent_class)-> finalize (G_OBJECT (report));
+}
+
+GtkWidget*
+comments_report_new (const gchar *folder_path,
+                     GPtrArray   *stats)
+{
+  CommentsReportPrivate *priv;
+  GtkWidget *report;
+  
+  report = g_object_new (comments_report_get_type (), NULL);
+  priv = COMMENTS_REPORT_GET_PRIVATE (report);
+
+  priv->folder_path = g_strdup (folder_path);
+  priv->stats = g_ptr_array_ref (stats);
+  
+  add_content_area (COMMENTS_REPORT (report));
+  load_stats (COMMENTS_REPORT (report));
+  
+  return report;
+}
+
+static void
+add_content_area (CommentsReport *report)
+{
+  CommentsReportPrivate *priv;
+  GtkWidget *content_area;
+  GtkWidget *label;
+  GtkWidget *tree;
+  GtkListStore *store;
+  GtkWidget *scrolled_window;
+
+  priv = COMMENTS_REPORT_GET_PRIVATE (report);
+
+  gtk_dialog_add_buttons (GTK_DIALOG (report), 
+                          GTK_STOCK_SAVE_AS, COMMENTS_REPORT_RESPONSE_SAVE,
+                          GTK_STOCK_CLOSE, GTK_RESPONSE_CLOSE, NULL);
+  gtk_dialog_set_default_response (GTK_DIALOG (report), GTK_RESPONSE_CLOSE);
+                          
+  content_area = gtk_dialog_get_content_area (GTK_DIALOG (report));
+  
+  label = gtk_label_new (priv->folder_path);
+  gtk_misc_set_alignment (GTK_MISC (label), 0, .5);
+
+  /* the tree */
+
+  tree = gtk_tree_view_new ();
+  
+  store = gtk_list_store_new (COLUMNS, G_TYPE_STRING, G_TYPE_STRING, 
+                              G_TYPE_UINT, G_TYPE_UINT, G_TYPE_UINT, 
+                              G_TYPE_UINT, G_TYPE_DOUBLE);
+  priv->store = store;
+  
+  gtk_tree_view_set_model (GTK_TREE_VIEW (tree), GTK_TREE_MODEL (store));
+  g_object_unref (store);
+  
+  add_column (tree, "Path", PATH);
+  add_column (tree, "Type", TYPE);
+  add_column (tree, "Files", FILES);
+  add_column (tree, "Code", CODE);
+  add_column (tree, "Comment", COMMENT);
+  add_column (tree, "Blank", BLANK);
+  add_column (tree, "Ratio", RATIO);
+
+  scrolled_window = gtk_scrolled_window_new (NULL, NULL);
+  gtk_scrolled_window_set_policy (GTK_SCROLLED_WINDOW (scrolled_window),
+                                  GTK_POLICY_AUTOMATIC, GTK_POLICY_AUTOMATIC);
+  gtk_container_add (GTK_CONTAINER (scrolled_window), GTK_WIDGET (tree));
+  gtk_widget_set_size_request (scrolled_window, 600, 400);
+
+  gtk_box_pack_start (GTK_BOX (content_area), label, FALSE, FALSE, 4);
+  gtk_box_pack_start (GTK_BOX (content_area), scrolled_window, TRUE, TRUE, 0);
+  gtk_widget_show_all (content_area);
+}
+
+static void
+add_column (GtkWidget   *tree,
+            const gchar *title,
+            gint         column)
+{
+  GtkTreeViewColumn *tree_column;
+  GtkCellRenderer *renderer;
+
+  tree_column = gtk_tree_view_column_new ();
+  gtk_tree_view_column_set_title (tree_column, title);
+  gtk_tree_view_column_set_sort_column_id (tree_column, column);
+  gtk_tree_view_column_set_resizable (tree_column, TRUE);
+
+  renderer = gtk_cell_renderer_text_new ();
+  gtk_tree_view_column_pack_start (tree_column, renderer, TRUE);
+
+  if (column == RATIO)
+    gtk_tree_view_column_set_cell_data_func (tree_column, renderer, 
+                                             render_ratio, NULL, NULL);
+  else
+    gtk_tree_view_column_set_attributes (tree_column, renderer, 
+                                         "text", column, NULL);
+
+  if (column != PATH && column != TYPE)
+    g_object_set (renderer, "xalign", 1.0, NULL);
+
+  gtk_tree_view_append_column (GTK_TREE_VIEW (tree), tree_column);
+}
+
+static void
+render_ratio (GtkTreeViewColumn *column,
+              GtkCellRenderer   *renderer,
+              GtkTreeModel      *model,
+              GtkTreeIter       *iter,
+              gpointer           data)
+{
+  gdouble ratio;
+  gchar *text;
+
+  gtk_tree_model_get (model, iter, RATIO, &ratio, -1);
+  text = g_strdup_printf ("%.1f%%", ratio * 100);
+  g_object_set (renderer, "text", text, NULL);
+  g_free (text);
+}
+
+static void
+load_stats (CommentsReport *report)
+{
+  CommentsReportPrivate *priv;
+  GtkTreeIter iter;
+  guint i;
+
+  priv = COMMENTS_REPORT_GET_PRIVATE (report);
+
+  for (i = 0; i < priv->stats->len; i++)
+    {
+      CommentsScanStats *stats = g_ptr_array_index (priv->stats, i);
+      
+      gtk_list_store_append (priv->store, &iter);
+      gtk_list_store_set (priv->store, &iter, 
+                          PATH, stats->path, 
+                          TYPE, stats->directory ? "directory" : "file",
+                          FILES, stats->files,
+                          CODE, stats->code,
+                          COMMENT, stats->comment,
+                          BLANK, stats->blank,
+                          RATIO, comments_scan_stats_get_ratio (stats),
+                          -1);
+    }
+}
+
+void
+comments_report_save_csv (CommentsReport *report)
+{
+  CommentsReportPrivate *priv;
+  GtkWidget *chooser;
+
+  priv = COMMENTS_REPORT_GET_PRIVATE (report);
+
+  chooser = gtk_file_chooser_dialog_new ("Save Report", GTK_WINDOW (report),
+                                         GTK_FILE_CHOOSER_ACTION_SAVE,
+                                         GTK_STOCK_CANCEL, GTK_RESPONSE_CANCEL,
+                                         GTK_STOCK_SAVE, GTK_RESPONSE_ACCEPT,
+                                         NULL);
+  gtk_file_chooser_set_do_overwrite_confirmation (GTK_FILE_CHOOSER (chooser), TRUE);
+  gtk_file_chooser_set_current_name (GTK_FILE_CHOOSER (chooser), "comments.csv");
+
+  if (gtk_dialog_run (GTK_DIALOG (chooser)) == GTK_RESPONSE_ACCEPT)
+    {
+      gchar *file_path;
+      gchar *csv;
+      GError *error = NULL;
+
+      file_path = gtk_file_chooser_get_filename (GTK_FILE_CHOOSER (chooser));
+      csv = comments_scanner_to_csv (priv->stats);
+
+      if (!g_file_set_contents (file_path, csv, -1, &error))
+        {
+          g_warning ("Comment Density Report: %s", error->message);
+          g_error_free (error);
+        }
+
+      g_free (csv);
+      g_free (file_path);
+    }
+
+  gtk_widget_destroy (chooser);
+}
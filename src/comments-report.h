@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __COMMENTS_REPORT_H__
+#define	__COMMENTS_REPORT_H__
+
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+#define COMMENTS_REPORT_TYPE            (comments_report_get_type ())
+#define COMMENTS_REPORT(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), COMMENTS_REPORT_TYPE, CommentsReport))
+#define COMMENTS_REPORT_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), COMMENTS_REPORT_TYPE, CommentsReportClass))
+#define IS_COMMENTS_REPORT(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), COMMENTS_REPORT_TYPE))
+#define IS_COMMENTS_REPORT_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), COMMENTS_REPORT_TYPE))
+
+#define COMMENTS_REPORT_RESPONSE_SAVE 1
+
+typedef struct _CommentsReport CommentsReport;
+typedef struct _CommentsReportClass CommentsReportClass;
+
+struct _CommentsReport
+{
+  GtkDialog parent_instance;
+};
+
+struct _CommentsReportClass
+{
+  GtkDialogClass parent_class;
+};
+
+GType comments_report_get_type (void) G_GNUC_CONST;
+     
+GtkWidget*  comments_report_new       (const gchar    *folder_path,
+                                       GPtrArray      *stats);
+
+void        comments_report_save_csv  (CommentsReport *report);
+
+G_END_DECLS
+
+#endif /* __COMMENTS_REPORT_H__ */
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <codeslayer/codeslayer-utils.h>
+#include "comments-resolver.h"
+
+/*
+ * The configs are flattened into a single table keyed by file type, where
+ * the value is the position of the first config that lists that type.
+ * Because a file type matches when the file path ends with it, a lookup
+ * tries every suffix of the path against the table and keeps the match
+ * with the lowest position, which gives the same answer as walking the
+ * configs in order.
+ */
+struct _CommentsResolver
+{
+  GPtrArray  *configs;
+  GHashTable *file_types;
+};
+
+static void add_config (CommentsResolver *resolver,
+                        CommentsConfig   *config);
+
+/*
+ * The overlay configs are placed ahead of the global ones so they win for
+ * any file type that both of them list.
+ */
+CommentsResolver*
+comments_resolver_new (GList *overlay,
+                       GList *configs)
+{
+  CommentsResolver *resolver;
+
+  resolver = g_new0 (CommentsResolver, 1);
+  resolver->configs = g_ptr_array_new_with_free_func (g_object_unref);
+  resolver->file_types = g_hash_table_new_full (g_str_hash, g_str_equal, 
+                                                g_free, NULL);
+
+  for (; overlay != NULL; overlay = g_list_next (overlay))
+    add_config (resolver, overlay->data);
+
+  for (; configs != NULL; configs = g_list_next (configs))
+    add_config (resolver, configs->data);
+
+  return resolver;
+}
+
+static void
+add_config (CommentsResolver *resolver,
+            CommentsConfig   *config)
+{
+  const gchar *file_types;
+  GList *elements;
+  GList *list;
+  guint position;
+
+  g_ptr_array_add (resolver->configs, g_object_ref (config));
+  position = resolver->configs->len;
+
+  file_types = comments_config_get_file_types (config);
+  elements = codeslayer_utils_string_to_list (file_types);
+
+  for (list = elements; list != NULL; list = g_list_next (list))
+    {
+      gchar *file_type = list->data;
+
+      if (*file_type == '\0' || 
+          g_hash_table_lookup (resolver->file_types, file_type) != NULL)
+        {
+          g_free (file_type);
+          continue;
+        }
+
+      /* positions start at 1 so a miss can be told apart from a hit */
+      g_hash_table_insert (resolver->file_types, file_type, 
+                           GUINT_TO_POINTER (position));
+    }
+
+  g_list_free (elements);
+}
+
+CommentsConfig*
+comments_resolver_lookup (CommentsResolver *resolver,
+                          const gchar      *file_path)
+{
+  guint best = G_MAXUINT;
+
+  if (file_path == NULL)
+    return NULL;
+
+  for (; *file_path != '\0'; file_path++)
+    {
+      guint position;
+
+      position = GPOINTER_TO_UINT (g_hash_table_lookup (resolver->file_types, 
+                                                        file_path));
+      if (position != 0 && position < best)
+        best = position;
+    }
+
+  if (best == G_MAXUINT)
+    return NULL;
+
+  return g_ptr_array_index (resolver->configs, best - 1);
+}
+
+void
+comments_resolver_free (CommentsResolver *resolver)
+{
+  g_hash_table_destroy (resolver->file_types);
+  g_ptr_array_unref (resolver->configs);
+  g_free (resolver);
+}
@@ -0,0 +1,440 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <string.h>
+#include "comments-scanner.h"
+#include "comments-walker.h"
+#include "comments-simd.h"
+
+typedef struct _Rule Rule;
+
+struct _Rule
+{
+  gchar *start;
+  gchar *end;
+};
+
+typedef struct _Job Job;
+
+struct _Job
+{
+  gchar             *file_path;
+  Rule              *rule;
+  CommentsScanStats *stats;
+};
+
+static Rule*               rule_new            (CommentsConfig    *config);
+static void                rule_free           (Rule              *rule);
+static Job*                job_new             (const gchar       *file_path,
+                                                const gchar       *path,
+                                                Rule              *rule,
+                                                gpointer           user_data);
+static void                scan_job            (Job               *job,
+                                                gpointer           user_data);
+static CommentsScanStats*  stats_new           (const gchar       *path,
+                                                gboolean           directory);
+static void                add_to_directories  (GHashTable        *directories,
+                                                GPtrArray         *results,
+                                                CommentsScanStats *stats);
+static gint                compare_path        (CommentsScanStats **a,
+                                                CommentsScanStats **b);
+static gint                compare_code        (CommentsScanStats **a,
+                                                CommentsScanStats **b);
+static gint                compare_comment     (CommentsScanStats **a,
+                                                CommentsScanStats **b);
+static gint                compare_blank       (CommentsScanStats **a,
+                                                CommentsScanStats **b);
+static gint                compare_ratio       (CommentsScanStats **a,
+                                                CommentsScanStats **b);
+
+/*
+ * Count the code, comment and blank lines of every file under the folder
+ * that one of the configs knows about. The tree is walked up front and the
+ * files are then read through mmap and counted on a thread pool, one job
+ * per file. The result holds an entry for every file and one for every
+ * directory with the totals of everything below it, sorted by path.
+ */
+GPtrArray*
+comments_scanner_scan (const gchar *folder_path,
+                       GList       *configs)
+{
+  GPtrArray *jobs;
+  GPtrArray *results;
+  GHashTable *directories;
+  CommentsScanStats *root;
+  guint i;
+
+  jobs = comments_walker_run (folder_path, configs, 
+                              (CommentsRuleFunc) rule_new, 
+                              (GDestroyNotify) rule_free, 
+                              (CommentsFileFunc) job_new, 
+                              (GFunc) scan_job, NULL);
+
+  results = g_ptr_array_new_with_free_func ((GDestroyNotify) comments_scan_stats_free);
+  directories = g_hash_table_new (g_str_hash, g_str_equal);
+
+  root = stats_new (".", TRUE);
+  g_hash_table_insert (directories, root->path, root);
+  g_ptr_array_add (results, root);
+
+  for (i = 0; i < jobs->len; i++)
+    {
+      Job *job = g_ptr_array_index (jobs, i);
+      g_ptr_array_add (results, job->stats);
+      add_to_directories (directories, results, job->stats);
+      g_free (job->file_path);
+      g_free (job);
+    }
+
+  g_hash_table_destroy (directories);
+  g_ptr_array_free (jobs, TRUE);
+
+  comments_scanner_sort (results, COMMENTS_SCAN_SORT_PATH);
+
+  return results;
+}
+
+/*
+ * A line that has anything besides comments on it counts as code, a line
+ * that only has whitespace counts as blank, even inside a block comment.
+ * Delimiters inside string literals are not recognised; this is a report,
+ * not a parser.
+ */
+void
+comments_scanner_count_lines (const gchar       *text,
+                              gsize              length,
+                              const gchar       *start,
+                              const gchar       *end,
+                              CommentsScanStats *stats)
+{
+  const gchar *pos = text;
+  const gchar *limit = text + length;
+  gsize start_length;
+  gsize end_length;
+  gboolean block;
+  gboolean in_block = FALSE;
+
+  start_length = start != NULL ? strlen (start) : 0;
+  end_length = end != NULL ? strlen (end) : 0;
+  block = start_length > 0 && end_length > 0;
+
+  while (pos < limit)
+    {
+      const gchar *eol;
+      const gchar *next;
+      gboolean code = FALSE;
+      gboolean comment = FALSE;
+
+      eol = memchr (pos, '\n', limit - pos);
+      if (eol == NULL)
+        eol = limit;
+      next = eol < limit ? eol + 1 : limit;
+
+      if (eol > pos && eol[-1] == '\r')
+        eol--;
+
+      while (pos < eol)
+        {
+          while (pos < eol && g_ascii_isspace (*pos))
+            pos++;
+
+          if (pos == eol)
+            break;
+
+          if (in_block)
+            {
+              const gchar *close;
+
+              comment = TRUE;
+              close = comments_simd_find_delimiter (pos, eol, end, end_length);
+              if (close == eol)
+                break;
+
+              in_block = FALSE;
+              pos = close + end_length;
+            }
+          else if (start_length > 0 &&
+                   (gsize) (eol - pos) >= start_length &&
+                   memcmp (pos, start, start_length) == 0)
+            {
+              comment = TRUE;
+              if (!block)
+                break;
+
+              in_block = TRUE;
+              pos += start_length;
+            }
+          else
+            {
+              code = TRUE;
+              if (!block)
+                break;
+
+              pos = comments_simd_find_delimiter (pos, eol, start, start_length);
+            }
+        }
+
+      if (code)
+        stats->code++;
+      else if (comment)
+        stats->comment++;
+      else
+        stats->blank++;
+
+      pos = next;
+    }
+}
+
+void
+comments_scanner_sort (GPtrArray        *stats,
+                       CommentsScanSort  sort)
+{
+  GCompareFunc func;
+
+  switch (sort)
+    {
+    case COMMENTS_SCAN_SORT_CODE:
+      func = (GCompareFunc) compare_code;
+      break;
+    case COMMENTS_SCAN_SORT_COMMENT:
+      func = (GCompareFunc) compare_comment;
+      break;
+    case COMMENTS_SCAN_SORT_BLANK:
+      func = (GCompareFunc) compare_blank;
+      break;
+    case COMMENTS_SCAN_SORT_RATIO:
+      func = (GCompareFunc) compare_ratio;
+      break;
+    default:
+      func = (GCompareFunc) compare_path;
+      break;
+    }
+
+  g_ptr_array_sort (stats, func);
+}
+
+gchar*
+comments_scanner_to_csv (GPtrArray *stats)
+{
+  GString *csv;
+  guint i;
+
+  csv = g_string_new ("path,type,files,code,comment,blank,ratio\n");
+
+  for (i = 0; i < stats->len; i++)
+    {
+      CommentsScanStats *entry = g_ptr_array_index (stats, i);
+      gchar ratio[G_ASCII_DTOSTR_BUF_SIZE];
+      const gchar *c;
+
+      g_string_append_c (csv, '"');
+      for (c = entry->path; *c != '\0'; c++)
+        {
+          if (*c == '"')
+            g_string_append_c (csv, '"');
+          g_string_append_c (csv, *c);
+        }
+      g_string_append_c (csv, '"');
+
+      g_ascii_formatd (ratio, sizeof (ratio), "%.4f", 
+                       comments_scan_stats_get_ratio (entry));
+
+      g_string_append_printf (csv, ",%s,%u,%u,%u,%u,%s\n",
+                              entry->directory ? "directory" : "file",
+                              entry->files, entry->code, entry->comment, 
+                              entry->blank, ratio);
+    }
+
+  return g_string_free (csv, FALSE);
+}
+
+gdouble
+comments_scan_stats_get_ratio (CommentsScanStats *stats)
+{
+  if (stats->code + stats->comment == 0)
+    return 0;
+
+  return (gdouble) stats->comment / (stats->code + stats->comment);
+}
+
+void
+comments_scan_stats_free (CommentsScanStats *stats)
+{
+  g_free (stats->path);
+  g_free (stats);
+}
+
+/* a config without a start delimiter has nothing to count */
+static Rule*
+rule_new (CommentsConfig *config)
+{
+  Rule *rule;
+
+  if (comments_config_get_start (config) == NULL ||
+      *comments_config_get_start (config) == '\0')
+    return NULL;
+
+  rule = g_new0 (Rule, 1);
+  rule->start = g_strdup (comments_config_get_start (config));
+  rule->end = g_strdup (comments_config_get_end (config));
+
+  return rule;
+}
+
+static void
+rule_free (Rule *rule)
+{
+  g_free (rule->start);
+  g_free (rule->end);
+  g_free (rule);
+}
+
+static Job*
+job_new (const gchar *file_path,
+         const gchar *path,
+         Rule        *rule,
+         gpointer     user_data)
+{
+  Job *job;
+
+  job = g_new0 (Job, 1);
+  job->file_path = g_strdup (file_path);
+  job->rule = rule;
+  job->stats = g_new0 (CommentsScanStats, 1);
+  job->stats->path = g_strdup (path);
+  job->stats->files = 1;
+
+  return job;
+}
+
+static void
+scan_job (Job      *job,
+          gpointer  user_data)
+{
+  GMappedFile *mapped_file;
+  const gchar *contents;
+  gsize length;
+
+  mapped_file = g_mapped_file_new (job->file_path, FALSE, NULL);
+  if (mapped_file == NULL)
+    return;
+
+  contents = g_mapped_file_get_contents (mapped_file);
+  length = g_mapped_file_get_length (mapped_file);
+
+  if (contents != NULL && length > 0)
+    comments_scanner_count_lines (contents, length, job->rule->start, 
+                                  job->rule->end, job->stats);
+
+  g_mapped_file_unref (mapped_file);
+}
+
+static CommentsScanStats*
+stats_new (const gchar *path,
+           gboolean     directory)
+{
+  CommentsScanStats *stats;
+  stats = g_new0 (CommentsScanStats, 1);
+  stats->path = g_strdup (path);
+  stats->directory = directory;
+  return stats;
+}
+
+static void
+add_to_directories (GHashTable        *directories,
+                    GPtrArray         *results,
+                    CommentsScanStats *stats)
+{
+  gchar *path;
+
+  path = g_path_get_dirname (stats->path);
+
+  while (TRUE)
+    {
+      CommentsScanStats *directory;
+      gchar *parent;
+
+      directory = g_hash_table_lookup (directories, path);
+      if (directory == NULL)
+        {
+          directory = stats_new (path, TRUE);
+          g_hash_table_insert (directories, directory->path, directory);
+          g_ptr_array_add (results, directory);
+        }
+
+      directory->files += stats->files;
+      directory->code += stats->code;
+      directory->comment += stats->comment;
+      directory->blank += stats->blank;
+
+      if (g_strcmp0 (path, ".") == 0)
+        break;
+
+      parent = g_path_get_dirname (path);
+      g_free (path);
+      path = parent;
+    }
+
+  g_free (path);
+}
+
+static gint
+compare_path (CommentsScanStats **a,
+              CommentsScanStats **b)
+{
+  return g_strcmp0 ((*a)->path, (*b)->path);
+}
+
+static gint
+compare_code (CommentsScanStats **a,
+              CommentsScanStats **b)
+{
+  if ((*a)->code == (*b)->code)
+    return compare_path (a, b);
+  return (*a)->code < (*b)->code ? 1 : -1;
+}
+
+static gint
+compare_comment (CommentsScanStats **a,
+                 CommentsScanStats **b)
+{
+  if ((*a)->comment == (*b)->comment)
+    return compare_path (a, b);
+  return (*a)->comment < (*b)->comment ? 1 : -1;
+}
+
+static gint
+compare_blank (CommentsScanStats **a,
+               CommentsScanStats **b)
+{
+  if ((*a)->blank == (*b)->blank)
+    return compare_path (a, b);
+  return (*a)->blank < (*b)->blank ? 1 : -1;
+}
+
+static gint
+compare_ratio (CommentsScanStats **a,
+               CommentsScanStats **b)
+{
+  gdouble ratio_a = comments_scan_stats_get_ratio (*a);
+  gdouble ratio_b = comments_scan_stats_get_ratio (*b);
+
+  if (ratio_a == ratio_b)
+    return compare_path (a, b);
+  return ratio_a < ratio_b ? 1 : -1;
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __COMMENTS_SCANNER_H__
+#define	__COMMENTS_SCANNER_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _CommentsScanStats CommentsScanStats;
+
+struct _CommentsScanStats
+{
+  gchar    *path;
+  gboolean  directory;
+  guint     files;
+  guint     code;
+  guint     comment;
+  guint     blank;
+};
+
+typedef enum
+{
+  COMMENTS_SCAN_SORT_PATH,
+  COMMENTS_SCAN_SORT_CODE,
+  COMMENTS_SCAN_SORT_COMMENT,
+  COMMENTS_SCAN_SORT_BLANK,
+  COMMENTS_SCAN_SORT_RATIO
+} CommentsScanSort;
+
+GPtrArray*  comments_scanner_scan          (const gchar       *folder_path,
+                                            GList             *configs);
+
+void        comments_scanner_count_lines   (const gchar       *text,
+                                            gsize              length,
+                                            const gchar       *start,
+                                            const gchar       *end,
+                                            CommentsScanStats *stats);
+
+void        comments_scanner_sort          (GPtrArray         *stats,
+                                            CommentsScanSort   sort);
+
+gchar*      comments_scanner_to_csv        (GPtrArray         *stats);
+
+gdouble     comments_scan_stats_get_ratio  (CommentsScanStats *stats);
+
+void        comments_scan_stats_free       (CommentsScanStats *stats);
+
+G_END_DECLS
+
+#endif /* __COMMENTS_SCANNER_H__ */
@@ -0,0 +1,401 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Vector versions of the two searches the line transforms and the scanner
+ * spend their time in: finding the next \n or \r, and finding the next
+ * occurrence of a comment delimiter. One and two byte delimiters such as
+ * "#", ";", "//" and "--" are compared 16 or 32 positions at a time;
+ * longer ones use the two byte search to find candidates. SSE2 is the
+ * baseline on x86-64, AVX2 is picked at run time when the CPU has it, and
+ * everything else gets the scalar loops.
+ */
+
+#include <string.h>
+#include "comments-simd.h"
+
+#if defined (__GNUC__) && defined (__x86_64__)
+#define HAVE_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+typedef struct _Kernels Kernels;
+
+struct _Kernels
+{
+  const gchar* (*find_newline) (const gchar *text,
+                                const gchar *end);
+  const gchar* (*find_byte)    (const gchar *text,
+                                const gchar *end,
+                                gchar        byte);
+  const gchar* (*find_pair)    (const gchar *text,
+                                const gchar *end,
+                                gchar        first,
+                                gchar        second);
+};
+
+static const gchar* find_newline_scalar  (const gchar *text,
+                                          const gchar *end);
+static const gchar* find_byte_scalar     (const gchar *text,
+                                          const gchar *end,
+                                          gchar        byte);
+static const gchar* find_pair_scalar     (const gchar *text,
+                                          const gchar *end,
+                                          gchar        first,
+                                          gchar        second);
+static const Kernels* get_kernels        (void);
+
+static const Kernels scalar_kernels = 
+{
+  find_newline_scalar,
+  find_byte_scalar,
+  find_pair_scalar
+};
+
+#ifdef HAVE_X86_KERNELS
+
+static const gchar* find_newline_sse2    (const gchar *text,
+                                          const gchar *end);
+static const gchar* find_byte_sse2       (const gchar *text,
+                                          const gchar *end,
+                                          gchar        byte);
+static const gchar* find_pair_sse2       (const gchar *text,
+                                          const gchar *end,
+                                          gchar        first,
+                                          gchar        second);
+static const gchar* find_newline_avx2    (const gchar *text,
+                                          const gchar *end);
+static const gchar* find_byte_avx2       (const gchar *text,
+                                          const gchar *end,
+                                          gchar        byte);
+static const gchar* find_pair_avx2       (const gchar *text,
+                                          const gchar *end,
+                                          gchar        first,
+                                          gchar        second);
+
+static const Kernels sse2_kernels = 
+{
+  find_newline_sse2,
+  find_byte_sse2,
+  find_pair_sse2
+};
+
+static const Kernels avx2_kernels = 
+{
+  find_newline_avx2,
+  find_byte_avx2,
+  find_pair_avx2
+};
+
+#endif
+
+static const Kernels *kernels = NULL;
+static CommentsSimdLevel detected_level = COMMENTS_SIMD_SCALAR;
+
+/*
+ * Returns the first \n or \r at or after text, or end when there is none.
+ */
+const gchar*
+comments_simd_find_newline (const gchar *text,
+                            const gchar *end)
+{
+  return get_kernels ()->find_newline (text, end);
+}
+
+/*
+ * Returns the first occurrence of the delimiter at or after text that fits
+ * entirely before end, or end when there is none.
+ */
+const gchar*
+comments_simd_find_delimiter (const gchar *text,
+                              const gchar *end,
+                              const gchar *delimiter,
+                              gsize        length)
+{
+  const Kernels *k = get_kernels ();
+
+  if (length == 0 || (gsize) (end - text) < length)
+    return end;
+
+  if (length == 1)
+    return k->find_byte (text, end, delimiter[0]);
+
+  while (text < end)
+    {
+      text = k->find_pair (text, end, delimiter[0], delimiter[1]);
+      if ((gsize) (end - text) < length)
+        return end;
+      if (length == 2 || memcmp (text + 2, delimiter + 2, length - 2) == 0)
+        return text;
+      text++;
+    }
+
+  return end;
+}
+
+CommentsSimdLevel
+comments_simd_get_level (void)
+{
+  get_kernels ();
+#ifdef HAVE_X86_KERNELS
+  if (kernels == &avx2_kernels)
+    return COMMENTS_SIMD_AVX2;
+  if (kernels == &sse2_kernels)
+    return COMMENTS_SIMD_SSE2;
+#endif
+  return COMMENTS_SIMD_SCALAR;
+}
+
+/*
+ * Forces a lower level than the CPU supports, so the kernels can be timed
+ * against each other. Asking for more than the CPU has gets the most it
+ * has. Meant to be called before any threads use the kernels.
+ */
+void
+comments_simd_set_level (CommentsSimdLevel level)
+{
+  get_kernels ();
+
+  if (level > detected_level)
+    level = detected_level;
+
+  switch (level)
+    {
+#ifdef HAVE_X86_KERNELS
+    case COMMENTS_SIMD_AVX2:
+      kernels = &avx2_kernels;
+      break;
+    case COMMENTS_SIMD_SSE2:
+      kernels = &sse2_kernels;
+      break;
+#endif
+    default:
+      kernels = &scalar_kernels;
+      break;
+    }
+}
+
+static const Kernels*
+get_kernels (void)
+{
+  static gsize initialized = 0;
+
+  if (g_once_init_enter (&initialized))
+    {
+      kernels = &scalar_kernels;
+#ifdef HAVE_X86_KERNELS
+      kernels = &sse2_kernels;
+      detected_level = COMMENTS_SIMD_SSE2;
+      __builtin_cpu_init ();
+      if (__builtin_cpu_supports ("avx2"))
+        {
+          kernels = &avx2_kernels;
+          detected_level = COMMENTS_SIMD_AVX2;
+        }
+#endif
+      g_once_init_leave (&initialized, 1);
+    }
+
+  return kernels;
+}
+
+static const gchar*
+find_newline_scalar (const gchar *text,
+                     const gchar *end)
+{
+  while (text < end && *text != '\n' && *text != '\r')
+    text++;
+  return text;
+}
+
+static const gchar*
+find_byte_scalar (const gchar *text,
+                  const gchar *end,
+                  gchar        byte)
+{
+  while (text < end && *text != byte)
+    text++;
+  return text;
+}
+
+/* the pair has to fit, so the last byte is never a match on its own */
+static const gchar*
+find_pair_scalar (const gchar *text,
+                  const gchar *end,
+                  gchar        first,
+                  gchar        second)
+{
+  while (text + 1 < end && (text[0] != first || text[1] != second))
+    text++;
+  return text + 1 < end ? text : end;
+}
+
+#ifdef HAVE_X86_KERNELS
+
+static const gchar*
+find_newline_sse2 (const gchar *text,
+                   const gchar *end)
+{
+  const __m128i lf = _mm_set1_epi8 ('\n');
+  const __m128i cr = _mm_set1_epi8 ('\r');
+
+  while (end - text >= 16)
+    {
+      __m128i block;
+      gint mask;
+
+      block = _mm_loadu_si128 ((const __m128i *) text);
+      mask = _mm_movemask_epi8 (_mm_or_si128 (_mm_cmpeq_epi8 (block, lf),
+                                              _mm_cmpeq_epi8 (block, cr)));
+      if (mask != 0)
+        return text + __builtin_ctz (mask);
+      text += 16;
+    }
+
+  return find_newline_scalar (text, end);
+}
+
+static const gchar*
+find_byte_sse2 (const gchar *text,
+                const gchar *end,
+                gchar        byte)
+{
+  const __m128i needle = _mm_set1_epi8 (byte);
+
+  while (end - text >= 16)
+    {
+      __m128i block;
+      gint mask;
+
+      block = _mm_loadu_si128 ((const __m128i *) text);
+      mask = _mm_movemask_epi8 (_mm_cmpeq_epi8 (block, needle));
+      if (mask != 0)
+        return text + __builtin_ctz (mask);
+      text += 16;
+    }
+
+  return find_byte_scalar (text, end, byte);
+}
+
+/*
+ * Compares the block against the first byte and the block one position on
+ * against the second, so a bit set in both masks marks a whole pair.
+ */
+static const gchar*
+find_pair_sse2 (const gchar *text,
+                const gchar *end,
+                gchar        first,
+                gchar        second)
+{
+  const __m128i first_needle = _mm_set1_epi8 (first);
+  const __m128i second_needle = _mm_set1_epi8 (second);
+
+  while (end - text >= 17)
+    {
+      __m128i block;
+      __m128i next;
+      gint mask;
+
+      block = _mm_loadu_si128 ((const __m128i *) text);
+      next = _mm_loadu_si128 ((const __m128i *) (text + 1));
+      mask = _mm_movemask_epi8 (_mm_and_si128 (_mm_cmpeq_epi8 (block, first_needle),
+                                               _mm_cmpeq_epi8 (next, second_needle)));
+      if (mask != 0)
+        return text + __builtin_ctz (mask);
+      text += 16;
+    }
+
+  return find_pair_scalar (text, end, first, second);
+}
+
+__attribute__ ((target ("avx2")))
+static const gchar*
+find_newline_avx2 (const gchar *text,
+                   const gchar *end)
+{
+  const __m256i lf = _mm256_set1_epi8 ('\n');
+  const __m256i cr = _mm256_set1_epi8 ('\r');
+
+  while (end - text >= 32)
+    {
+      __m256i block;
+      guint mask;
+
+      block = _mm256_loadu_si256 ((const __m256i *) text);
+      mask = _mm256_movemask_epi8 (_mm256_or_si256 (_mm256_cmpeq_epi8 (block, lf),
+                                                    _mm256_cmpeq_epi8 (block, cr)));
+      if (mask != 0)
+        return text + __builtin_ctz (mask);
+      text += 32;
+    }
+
+  return find_newline_sse2 (text, end);
+}
+
+__attribute__ ((target ("avx2")))
+static const gchar*
+find_byte_avx2 (const gchar *text,
+                const gchar *end,
+                gchar        byte)
+{
+  const __m256i needle = _mm256_set1_epi8 (byte);
+
+  while (end - text >= 32)
+    {
+      __m256i block;
+      guint mask;
+
+      block = _mm256_loadu_si256 ((const __m256i *) text);
+      mask = _mm256_movemask_epi8 (_mm256_cmpeq_epi8 (block, needle));
+      if (mask != 0)
+        return text + __builtin_ctz (mask);
+      text += 32;
+    }
+
+  return find_byte_sse2 (text, end, byte);
+}
+
+__attribute__ ((target ("avx2")))
+static const gchar*
+find_pair_avx2 (const gchar *text,
+                const gchar *end,
+                gchar        first,
+                gchar        second)
+{
+  const __m256i first_needle = _mm256_set1_epi8 (first);
+  const __m256i second_needle = _mm256_set1_epi8 (second);
+
+  while (end - text >= 33)
+    {
+      __m256i block;
+      __m256i next;
+      guint mask;
+
+      block = _mm256_loadu_si256 ((const __m256i *) text);
+      next = _mm256_loadu_si256 ((const __m256i *) (text + 1));
+      mask = _mm256_movemask_epi8 (_mm256_and_si256 (_mm256_cmpeq_epi8 (block, first_needle),
+                                                     _mm256_cmpeq_epi8 (next, second_needle)));
+      if (mask != 0)
+        return text + __builtin_ctz (mask);
+      text += 32;
+    }
+
+  return find_pair_sse2 (text, end, first, second);
+}
+
+#endif
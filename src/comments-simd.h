@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __COMMENTS_SIMD_H__
+#define	__COMMENTS_SIMD_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+  COMMENTS_SIMD_SCALAR,
+  COMMENTS_SIMD_SSE2,
+  COMMENTS_SIMD_AVX2
+} CommentsSimdLevel;
+
+const gchar*       comments_simd_find_newline    (const gchar       *text,
+                                                  const gchar       *end);
+const gchar*       comments_simd_find_delimiter  (const gchar       *text,
+                                                  const gchar       *end,
+                                                  const gchar       *delimiter,
+                                                  gsize              length);
+
+CommentsSimdLevel  comments_simd_get_level       (void);
+void               comments_simd_set_level       (CommentsSimdLevel  level);
+
+G_END_DECLS
+
+#endif /* __COMMENTS_SIMD_H__ */
@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <glib-object.h>
+#include "comments-snapshot.h"
+
+/*
+ * The publisher hands out the current snapshot RCU style. Readers never
+ * lock: they announce themselves on one of two reader counts, load the
+ * pointer and take a reference. A writer swaps the pointer in and then,
+ * once for each count, steers new readers onto the other count and waits
+ * for the one it steered them away from to drain. A reader that loaded the
+ * old pointer was counted on one of the two before the swap, so after both
+ * have drained every such reader holds its own reference and the
+ * publisher's reference to the old snapshot can be dropped.
+ */
+struct _CommentsPublisher
+{
+  CommentsSnapshot *current;
+  gint              phase;
+  gint              readers[2];
+  GMutex            mutex;
+};
+
+/*
+ * Takes ownership of the configs, which must not be changed afterwards.
+ */
+CommentsSnapshot*
+comments_snapshot_new (GList *configs)
+{
+  CommentsSnapshot *snapshot;
+  snapshot = g_new0 (CommentsSnapshot, 1);
+  snapshot->configs = configs;
+  snapshot->ref_count = 1;
+  return snapshot;
+}
+
+CommentsSnapshot*
+comments_snapshot_ref (CommentsSnapshot *snapshot)
+{
+  g_atomic_int_inc (&snapshot->ref_count);
+  return snapshot;
+}
+
+void
+comments_snapshot_unref (CommentsSnapshot *snapshot)
+{
+  if (!g_atomic_int_dec_and_test (&snapshot->ref_count))
+    return;
+
+  g_list_foreach (snapshot->configs, (GFunc) g_object_unref, NULL);
+  g_list_free (snapshot->configs);
+  g_free (snapshot);
+}
+
+CommentsPublisher*
+comments_publisher_new (void)
+{
+  CommentsPublisher *publisher;
+  publisher = g_new0 (CommentsPublisher, 1);
+  publisher->current = comments_snapshot_new (NULL);
+  g_mutex_init (&publisher->mutex);
+  return publisher;
+}
+
+/*
+ * Returns a new reference to the current snapshot. Safe to call from any
+ * thread, and never blocks.
+ */
+CommentsSnapshot*
+comments_publisher_acquire (CommentsPublisher *publisher)
+{
+  CommentsSnapshot *snapshot;
+  gint phase;
+
+  phase = g_atomic_int_get (&publisher->phase);
+  g_atomic_int_inc (&publisher->readers[phase]);
+
+  snapshot = g_atomic_pointer_get (&publisher->current);
+  comments_snapshot_ref (snapshot);
+
+  g_atomic_int_add (&publisher->readers[phase], -1);
+
+  return snapshot;
+}
+
+/*
+ * Makes the snapshot current, taking over the caller's reference. Readers
+ * holding the old snapshot keep it alive until they let it go.
+ */
+void
+comments_publisher_publish (CommentsPublisher *publisher,
+                            CommentsSnapshot  *snapshot)
+{
+  CommentsSnapshot *old;
+  gint phase;
+  gint i;
+
+  g_mutex_lock (&publisher->mutex);
+
+  old = g_atomic_pointer_get (&publisher->current);
+  g_atomic_pointer_set (&publisher->current, snapshot);
+
+  phase = g_atomic_int_get (&publisher->phase);
+
+  for (i = 0; i < 2; i++)
+    {
+      g_atomic_int_set (&publisher->phase, !phase);
+      while (g_atomic_int_get (&publisher->readers[phase]) != 0)
+        g_thread_yield ();
+      phase = !phase;
+    }
+
+  g_mutex_unlock (&publisher->mutex);
+
+  comments_snapshot_unref (old);
+}
+
+void
+comments_publisher_free (CommentsPublisher *publisher)
+{
+  comments_snapshot_unref (publisher->current);
+  g_mutex_clear (&publisher->mutex);
+  g_free (publisher);
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __COMMENTS_SNAPSHOT_H__
+#define	__COMMENTS_SNAPSHOT_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _CommentsSnapshot CommentsSnapshot;
+typedef struct _CommentsPublisher CommentsPublisher;
+
+/*
+ * A list of configs that is never changed once it has been created, so it
+ * can be read from any thread for as long as a reference is held.
+ */
+struct _CommentsSnapshot
+{
+  GList *configs;
+
+  /*< private >*/
+  gint   ref_count;
+};
+
+CommentsSnapshot*   comments_snapshot_new        (GList             *configs);
+CommentsSnapshot*   comments_snapshot_ref        (CommentsSnapshot  *snapshot);
+void                comments_snapshot_unref      (CommentsSnapshot  *snapshot);
+
+CommentsPublisher*  comments_publisher_new       (void);
+CommentsSnapshot*   comments_publisher_acquire   (CommentsPublisher *publisher);
+void                comments_publisher_publish   (CommentsPublisher *publisher,
+                                                  CommentsSnapshot  *snapshot);
+void                comments_publisher_free      (CommentsPublisher *publisher);
+
+G_END_DECLS
+
+#endif /* __COMMENTS_SNAPSHOT_H__ */
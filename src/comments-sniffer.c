@@ -0,0 +1,357 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include "comments-sniffer.h"
+
+#define MAX_NAME_LENGTH 32
+
+typedef struct _Language Language;
+
+struct _Language
+{
+  const gchar *name;
+  const gchar *suffix;
+};
+
+/* 
+ * Interpreter and modeline names mapped to the file suffix a config would
+ * normally list for them. Kept sorted by name so it can be searched with
+ * bsearch.
+ */
+static const Language languages[] = 
+{
+  { "awk",          ".awk" },
+  { "bash",         ".sh" },
+  { "c",            ".c" },
+  { "c++",          ".cpp" },
+  { "cmake",        ".cmake" },
+  { "conf",         ".conf" },
+  { "cperl",        ".pl" },
+  { "cpp",          ".cpp" },
+  { "csh",          ".csh" },
+  { "css",          ".css" },
+  { "dash",         ".sh" },
+  { "dockerfile",   ".dockerfile" },
+  { "emacs-lisp",   ".el" },
+  { "fish",         ".fish" },
+  { "gawk",         ".awk" },
+  { "go",           ".go" },
+  { "groovy",       ".groovy" },
+  { "haskell",      ".hs" },
+  { "html",         ".html" },
+  { "java",         ".java" },
+  { "javascript",   ".js" },
+  { "js",           ".js" },
+  { "julia",        ".jl" },
+  { "ksh",          ".sh" },
+  { "lisp",         ".lisp" },
+  { "lua",          ".lua" },
+  { "make",         ".mk" },
+  { "makefile",     ".mk" },
+  { "mawk",         ".awk" },
+  { "nawk",         ".awk" },
+  { "node",         ".js" },
+  { "nodejs",       ".js" },
+  { "ocaml",        ".ml" },
+  { "perl",         ".pl" },
+  { "php",          ".php" },
+  { "pwsh",         ".ps1" },
+  { "python",       ".py" },
+  { "r",            ".r" },
+  { "rscript",      ".r" },
+  { "ruby",         ".rb" },
+  { "rust",         ".rs" },
+  { "scheme",       ".scm" },
+  { "sed",          ".sed" },
+  { "sh",           ".sh" },
+  { "shell-script", ".sh" },
+  { "sql",          ".sql" },
+  { "tcl",          ".tcl" },
+  { "tclsh",        ".tcl" },
+  { "tcsh",         ".csh" },
+  { "vim",          ".vim" },
+  { "wish",         ".tcl" },
+  { "xml",          ".xml" },
+  { "yaml",         ".yml" },
+  { "zsh",          ".zsh" }
+};
+
+static const gchar* sniff_shebang   (const gchar  *text,
+                                     gsize         length);
+static const gchar* sniff_emacs     (const gchar  *text,
+                                     gsize         length);
+static const gchar* sniff_vim       (const gchar  *text,
+                                     gsize         length);
+static const gchar* lookup_language (const gchar  *name,
+                                     gsize         length);
+static gint         compare_name    (const gchar  *name,
+                                     const Language *language);
+static const gchar* next_word       (const gchar **pos,
+                                     const gchar  *end,
+                                     const gchar  *separators,
+                                     gsize        *length);
+static const gchar* get_line_end    (const gchar  *text,
+                                     const gchar  *end);
+
+/*
+ * Guess the file suffix for a document from a shebang line or an emacs or
+ * vim modeline. Only the given head and tail of the document are looked
+ * at, so the cost does not depend on the size of the file. Returns NULL
+ * when nothing is recognized.
+ */
+const gchar*
+comments_sniffer_sniff (const gchar *head,
+                        gsize        head_length,
+                        const gchar *tail,
+                        gsize        tail_length)
+{
+  const gchar *suffix = NULL;
+
+  if (head != NULL)
+    {
+      suffix = sniff_shebang (head, head_length);
+      if (suffix == NULL)
+        suffix = sniff_emacs (head, head_length);
+      if (suffix == NULL)
+        suffix = sniff_vim (head, head_length);
+    }
+
+  if (suffix == NULL && tail != NULL)
+    suffix = sniff_vim (tail, tail_length);
+
+  return suffix;
+}
+
+/*
+ * Handles both "#!/usr/bin/python3" and "#!/usr/bin/env -S python3 -u",
+ * skipping any options and variable assignments given to env.
+ */
+static const gchar*
+sniff_shebang (const gchar *text,
+               gsize        length)
+{
+  const gchar *pos;
+  const gchar *end;
+  const gchar *word;
+  gsize word_length;
+  gboolean env = FALSE;
+
+  if (length < 2 || text[0] != '#' || text[1] != '!')
+    return NULL;
+
+  pos = text + 2;
+  end = get_line_end (pos, text + length);
+
+  while ((word = next_word (&pos, end, " \t", &word_length)) != NULL)
+    {
+      const gchar *slash;
+
+      if (env && (word[0] == '-' || memchr (word, '=', word_length) != NULL))
+        continue;
+
+      slash = g_strrstr_len (word, word_length, "/");
+      if (slash != NULL)
+        {
+          word_length -= slash + 1 - word;
+          word = slash + 1;
+        }
+
+      if (!env && word_length == 3 && strncmp (word, "env", 3) == 0)
+        {
+          env = TRUE;
+          continue;
+        }
+
+      return lookup_language (word, word_length);
+    }
+
+  return NULL;
+}
+
+/*
+ * The emacs "-*- mode: python -*-" or "-*- python -*-" line has to be the
+ * first line, or the second one after a shebang.
+ */
+static const gchar*
+sniff_emacs (const gchar *text,
+             gsize        length)
+{
+  const gchar *end = text + length;
+  const gchar *line_end;
+  const gchar *open;
+  const gchar *close;
+  const gchar *mode;
+  const gchar *word;
+  gsize word_length;
+
+  line_end = get_line_end (text, end);
+  
+  if (length >= 2 && text[0] == '#' && text[1] == '!' && line_end < end)
+    {
+      text = line_end + 1;
+      line_end = get_line_end (text, end);
+    }
+
+  open = g_strstr_len (text, line_end - text, "-*-");
+  if (open == NULL)
+    return NULL;
+
+  open += 3;
+  close = g_strstr_len (open, line_end - open, "-*-");
+  if (close == NULL)
+    return NULL;
+
+  mode = g_strstr_len (open, close - open, "mode:");
+  if (mode != NULL)
+    {
+      mode += 5;
+      word = next_word (&mode, close, " \t;", &word_length);
+    }
+  else if (memchr (open, ':', close - open) == NULL)
+    {
+      word = next_word (&open, close, " \t;", &word_length);
+    }
+  else
+    {
+      return NULL;
+    }
+
+  if (word == NULL)
+    return NULL;
+
+  return lookup_language (word, word_length);
+}
+
+/*
+ * Looks for "vim: set ft=python :" style modelines, which vim itself only
+ * honours near the top and bottom of a file.
+ */
+static const gchar*
+sniff_vim (const gchar *text,
+           gsize        length)
+{
+  static const gchar *markers[] = { "vim:", "vi:", "ex:" };
+  static const gchar *keys[] = { "ft=", "filetype=", "syn=", "syntax=" };
+  const gchar *end = text + length;
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (markers); i++)
+    {
+      const gchar *pos = text;
+      const gchar *marker;
+
+      while ((marker = g_strstr_len (pos, end - pos, markers[i])) != NULL)
+        {
+          const gchar *cursor;
+          const gchar *option;
+          const gchar *line_end;
+          gsize option_length;
+
+          pos = marker + strlen (markers[i]);
+
+          if (marker != text && !g_ascii_isspace (marker[-1]))
+            continue;
+
+          cursor = pos;
+          line_end = get_line_end (cursor, end);
+
+          while ((option = next_word (&cursor, line_end, " \t:", &option_length)) != NULL)
+            {
+              guint k;
+
+              for (k = 0; k < G_N_ELEMENTS (keys); k++)
+                {
+                  gsize key_length = strlen (keys[k]);
+                  if (option_length > key_length &&
+                      strncmp (option, keys[k], key_length) == 0)
+                    return lookup_language (option + key_length, 
+                                            option_length - key_length);
+                }
+            }
+        }
+    }
+
+  return NULL;
+}
+
+static const gchar*
+lookup_language (const gchar *name,
+                 gsize        length)
+{
+  gchar key[MAX_NAME_LENGTH];
+  const Language *language;
+  gsize i;
+
+  /* python3.11 and perl5 are looked up as python and perl */
+  while (length > 1 && 
+         (g_ascii_isdigit (name[length - 1]) || 
+          name[length - 1] == '.' || name[length - 1] == '-'))
+    length--;
+
+  if (length == 0 || length >= MAX_NAME_LENGTH)
+    return NULL;
+
+  for (i = 0; i < length; i++)
+    key[i] = g_ascii_tolower (name[i]);
+  key[length] = '\0';
+
+  language = bsearch (key, languages, G_N_ELEMENTS (languages), 
+                      sizeof (Language), (GCompareFunc) compare_name);
+
+  return language != NULL ? language->suffix : NULL;
+}
+
+static gint
+compare_name (const gchar    *name,
+              const Language *language)
+{
+  return strcmp (name, language->name);
+}
+
+static const gchar*
+next_word (const gchar **pos,
+           const gchar  *end,
+           const gchar  *separators,
+           gsize        *length)
+{
+  const gchar *word;
+
+  while (*pos < end && strchr (separators, **pos) != NULL)
+    (*pos)++;
+
+  if (*pos >= end)
+    return NULL;
+
+  word = *pos;
+  while (*pos < end && strchr (separators, **pos) == NULL)
+    (*pos)++;
+
+  *length = *pos - word;
+  return word;
+}
+
+static const gchar*
+get_line_end (const gchar *text,
+              const gchar *end)
+{
+  while (text < end && *text != '\n' && *text != '\r')
+    text++;
+  return text;
+}
@@ -0,0 +1,259 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Reads config snapshots on many threads while the main thread commits
+ * new ones the way the dialog does, copying the current list, editing
+ * every copy and publishing the copies.
+ *
+ *   comments-stress [--readers N] [--commits 10000] [--configs 16]
+ *
+ * Every config of a commit gets the commit's generation as its start, so
+ * a reader can tell a snapshot that was changed after it was published,
+ * or freed under it, from a good one: all of its configs carry the same
+ * generation, no lower than the last one that reader saw, and still do
+ * once the reader has taken the next snapshot. Readers default to one per
+ * processor. Run it under valgrind or with -fsanitize=thread to catch
+ * what the checks cannot see. Prints the number of reads to stderr and
+ * exits with 1 on the first bad snapshot.
+ */
+
+#include "comments-config.h"
+#include "comments-snapshot.h"
+
+typedef struct _Stress Stress;
+
+struct _Stress
+{
+  CommentsPublisher *publisher;
+  gint               n_configs;
+  gint               stop;
+  gint               failed;
+  gint               reads;
+};
+
+static gpointer  read_snapshots   (Stress            *stress);
+static gint64    check_snapshot   (Stress            *stress,
+                                   CommentsSnapshot  *snapshot);
+static GList*    create_configs   (gint               n_configs);
+static void      commit_configs   (CommentsPublisher *publisher,
+                                   gint64             generation);
+
+static gint readers = 0;
+static gint commits = 10000;
+static gint configs = 16;
+
+static GOptionEntry entries[] = 
+{
+  { "readers", 'r', 0, G_OPTION_ARG_INT, &readers, "number of reader threads, one per processor by default", "N" },
+  { "commits", 'c', 0, G_OPTION_ARG_INT, &commits, "number of snapshots to publish", "N" },
+  { "configs", 'n', 0, G_OPTION_ARG_INT, &configs, "number of configs in each snapshot", "N" },
+  { NULL }
+};
+
+int
+main (int    argc,
+      char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  GPtrArray *threads;
+  Stress stress = { NULL, 0, 0, 0, 0 };
+  gint64 generation;
+  guint i;
+
+  context = g_option_context_new ("- stress the config snapshots");
+  g_option_context_add_main_entries (context, entries, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("comments-stress: %s\n", error->message);
+      return 1;
+    }
+  g_option_context_free (context);
+
+  if (readers <= 0)
+    readers = g_get_num_processors ();
+
+  stress.publisher = comments_publisher_new ();
+  stress.n_configs = MAX (configs, 1);
+  comments_publisher_publish (stress.publisher,
+                              comments_snapshot_new (create_configs (stress.n_configs)));
+
+  threads = g_ptr_array_new ();
+  for (i = 0; i < (guint) readers; i++)
+    g_ptr_array_add (threads, g_thread_new ("reader",
+                                            (GThreadFunc) read_snapshots,
+                                            &stress));
+
+  for (generation = 1; generation <= commits; generation++)
+    {
+      if (g_atomic_int_get (&stress.failed))
+        break;
+      commit_configs (stress.publisher, generation);
+    }
+
+  g_atomic_int_set (&stress.stop, TRUE);
+
+  for (i = 0; i < threads->len; i++)
+    g_thread_join (g_ptr_array_index (threads, i));
+  g_ptr_array_free (threads, TRUE);
+
+  comments_publisher_free (stress.publisher);
+
+  g_printerr ("%d reads over %d commits on %d readers\n",
+              g_atomic_int_get (&stress.reads), commits, readers);
+
+  return stress.failed ? 1 : 0;
+}
+
+/*
+ * Keeps hold of the snapshot it read last until it has the next one, so
+ * old snapshots are still being read while the writer drops them.
+ */
+static gpointer
+read_snapshots (Stress *stress)
+{
+  CommentsSnapshot *held = NULL;
+  gint64 held_generation = 0;
+
+  while (!g_atomic_int_get (&stress->stop) && !g_atomic_int_get (&stress->failed))
+    {
+      CommentsSnapshot *snapshot;
+      gint64 generation;
+
+      snapshot = comments_publisher_acquire (stress->publisher);
+      generation = check_snapshot (stress, snapshot);
+
+      if (generation >= 0 && generation < held_generation)
+        {
+          g_printerr ("comments-stress: read generation %" G_GINT64_FORMAT
+                      " after %" G_GINT64_FORMAT "\n", generation, held_generation);
+          g_atomic_int_set (&stress->failed, TRUE);
+        }
+
+      if (held != NULL)
+        {
+          if (check_snapshot (stress, held) != held_generation)
+            {
+              g_printerr ("comments-stress: generation %" G_GINT64_FORMAT
+                          " changed while it was held\n", held_generation);
+              g_atomic_int_set (&stress->failed, TRUE);
+            }
+          comments_snapshot_unref (held);
+        }
+
+      held = snapshot;
+      held_generation = generation;
+
+      g_atomic_int_inc (&stress->reads);
+    }
+
+  if (held != NULL)
+    comments_snapshot_unref (held);
+
+  return NULL;
+}
+
+/* the generation every config agrees on, or -1 */
+static gint64
+check_snapshot (Stress           *stress,
+                CommentsSnapshot *snapshot)
+{
+  GList *list;
+  gint64 generation = -1;
+  gint count = 0;
+
+  for (list = snapshot->configs; list != NULL; list = g_list_next (list))
+    {
+      CommentsConfig *config = list->data;
+      gint64 start;
+      gchar *file_type;
+
+      start = g_ascii_strtoll (comments_config_get_start (config), NULL, 10);
+      file_type = g_strdup_printf (".%d", count);
+
+      if ((count > 0 && start != generation) ||
+          comments_config_find_for_path (snapshot->configs, file_type) != config)
+        {
+          g_printerr ("comments-stress: config %d of generation %"
+                      G_GINT64_FORMAT " is torn\n", count, generation);
+          g_atomic_int_set (&stress->failed, TRUE);
+          g_free (file_type);
+          return -1;
+        }
+
+      g_free (file_type);
+      generation = start;
+      count++;
+    }
+
+  if (count != stress->n_configs)
+    {
+      g_printerr ("comments-stress: read %d configs instead of %d\n",
+                  count, stress->n_configs);
+      g_atomic_int_set (&stress->failed, TRUE);
+      return -1;
+    }
+
+  return generation;
+}
+
+static GList*
+create_configs (gint n_configs)
+{
+  GList *results = NULL;
+  gint i;
+
+  for (i = 0; i < n_configs; i++)
+    {
+      CommentsConfig *config;
+      gchar *file_types;
+
+      config = comments_config_new ();
+      file_types = g_strdup_printf (".%d", i);
+      comments_config_set_file_types (config, file_types);
+      comments_config_set_start (config, "0");
+      comments_config_set_end (config, "*/");
+      results = g_list_prepend (results, config);
+      g_free (file_types);
+    }
+
+  return g_list_reverse (results);
+}
+
+/* what the dialog does when it is answered with OK */
+static void
+commit_configs (CommentsPublisher *publisher,
+                gint64             generation)
+{
+  CommentsSnapshot *snapshot;
+  GList *copies;
+  GList *list;
+  gchar *start;
+
+  snapshot = comments_publisher_acquire (publisher);
+  copies = comments_config_copy_list (snapshot->configs);
+  comments_snapshot_unref (snapshot);
+
+  start = g_strdup_printf ("%" G_GINT64_FORMAT, generation);
+  for (list = copies; list != NULL; list = g_list_next (list))
+    comments_config_set_start (list->data, start);
+  g_free (start);
+
+  comments_publisher_publish (publisher, comments_snapshot_new (copies));
+}
@@ -0,0 +1,381 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <string.h>
+#include "comments-stripper.h"
+
+/*
+ * A GConverter that drops comments from a stream. Only the part of a
+ * delimiter that has been matched so far is carried between chunks, and
+ * since that is always a prefix of the delimiter itself no input is ever
+ * buffered; memory use does not depend on the size of the stream. A
+ * delimiter split across two chunks, or a block comment spanning any
+ * number of them, strips the same as it would in one piece.
+ *
+ * Line breaks inside comments are kept so the line numbers of the code that
+ * remains do not move. Delimiters inside string literals are not
+ * recognised.
+ */
+
+static void comments_stripper_class_init       (CommentsStripperClass  *klass);
+static void comments_stripper_init             (CommentsStripper       *stripper);
+static void comments_stripper_finalize         (CommentsStripper       *stripper);
+static void comments_stripper_converter_init   (GConverterIface        *iface);
+
+static GConverterResult comments_stripper_convert (GConverter      *converter,
+                                                   const void      *inbuf,
+                                                   gsize            inbuf_size,
+                                                   void            *outbuf,
+                                                   gsize            outbuf_size,
+                                                   GConverterFlags  flags,
+                                                   gsize           *bytes_read,
+                                                   gsize           *bytes_written,
+                                                   GError         **error);
+static void comments_stripper_reset            (GConverter             *converter);
+
+#define COMMENTS_STRIPPER_GET_PRIVATE(obj) \
+  (G_TYPE_INSTANCE_GET_PRIVATE ((obj), COMMENTS_STRIPPER_TYPE, CommentsStripperPrivate))
+
+typedef struct _CommentsStripperPrivate CommentsStripperPrivate;
+
+typedef enum
+{
+  STATE_CODE,
+  STATE_LINE,
+  STATE_BLOCK
+} State;
+
+struct _CommentsStripperPrivate
+{
+  gchar *start;
+  gsize  start_length;
+  gchar *end;
+  gsize  end_length;
+  gchar *scratch;
+  State  state;
+  gsize  matched;
+};
+
+static gsize strip_byte     (CommentsStripperPrivate *priv,
+                             gchar                    c,
+                             gchar                   *out);
+static gsize next_matched   (CommentsStripperPrivate *priv,
+                             const gchar             *delimiter,
+                             gchar                    c);
+
+G_DEFINE_TYPE_WITH_CODE (CommentsStripper, comments_stripper, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (G_TYPE_CONVERTER,
+                                                comments_stripper_converter_init))
+
+static void
+comments_stripper_class_init (CommentsStripperClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  gobject_class->finalize = (GObjectFinalizeFunc) comments_stripper_finalize;
+  g_type_class_add_private (klass, sizeof (CommentsStripperPrivate));
+}
+
+static void
+comments_stripper_converter_init (GConverterIface *iface)
+{
+  iface->convert = comments_stripper_convert;
+  iface->reset = comments_stripper_reset;
+}
+
+static void
+comments_stripper_init (CommentsStripper *stripper) 
+{
+  CommentsStripperPrivate *priv;
+  priv = COMMENTS_STRIPPER_GET_PRIVATE (stripper);
+  priv->start = NULL;
+  priv->start_length = 0;
+  priv->end = NULL;
+  priv->end_length = 0;
+  priv->scratch = NULL;
+  priv->state = STATE_CODE;
+  priv->matched = 0;
+}
+
+static void
+comments_stripper_finalize (CommentsStripper *stripper)
+{
+  CommentsStripperPrivate *priv;
+  priv = COMMENTS_STRIPPER_GET_PRIVATE (stripper);
+  g_free (priv->start);
+  g_free (priv->end);
+  g_free (priv->scratch);
+  G_OBJECT_CLASS (comments_stripper_parent_class)->finalize (G_OBJECT (stripper));
+}
+
+CommentsStripper*
+comments_stripper_new (CommentsConfig *config)
+{
+  CommentsStripperPrivate *priv;
+  CommentsStripper *stripper;
+  const gchar *start;
+  const gchar *end;
+
+  stripper = COMMENTS_STRIPPER (g_object_new (comments_stripper_get_type (), NULL));
+  priv = COMMENTS_STRIPPER_GET_PRIVATE (stripper);
+
+  start = comments_config_get_start (config);
+  end = comments_config_get_end (config);
+
+  priv->start = g_strdup (start != NULL ? start : "");
+  priv->start_length = strlen (priv->start);
+  priv->end = g_strdup (end != NULL ? end : "");
+  priv->end_length = strlen (priv->end);
+  priv->scratch = g_malloc (MAX (priv->start_length, priv->end_length) + 1);
+
+  return stripper;
+}
+
+/*
+ * Run a whole string through the converter, for callers that already have
+ * the text in memory such as the editor.
+ */
+gchar*
+comments_stripper_strip (CommentsStripper *stripper,
+                         const gchar      *text,
+                         gssize            length)
+{
+  CommentsStripperPrivate *priv;
+  GString *result;
+
+  priv = COMMENTS_STRIPPER_GET_PRIVATE (stripper);
+
+  if (length < 0)
+    length = strlen (text);
+
+  g_converter_reset (G_CONVERTER (stripper));
+
+  result = g_string_sized_new (length + 1);
+
+  while (TRUE)
+    {
+      GConverterResult converted;
+      gsize bytes_read;
+      gsize bytes_written;
+      gsize used;
+      gsize room;
+
+      used = result->len;
+      room = length + priv->start_length + 1;
+      g_string_set_size (result, used + room);
+
+      converted = g_converter_convert (G_CONVERTER (stripper), text, length, 
+                                       result->str + used, room,
+                                       G_CONVERTER_INPUT_AT_END, 
+                                       &bytes_read, &bytes_written, NULL);
+
+      if (converted == G_CONVERTER_ERROR)
+        {
+          g_string_set_size (result, used);
+          break;
+        }
+
+      g_string_set_size (result, used + bytes_written);
+      text += bytes_read;
+      length -= bytes_read;
+
+      if (converted == G_CONVERTER_FINISHED)
+        break;
+    }
+
+  return g_string_free (result, FALSE);
+}
+
+static GConverterResult 
+comments_stripper_convert (GConverter      *converter,
+                           const void      *inbuf,
+                           gsize            inbuf_size,
+                           void            *outbuf,
+                           gsize            outbuf_size,
+                           GConverterFlags  flags,
+                           gsize           *bytes_read,
+                           gsize           *bytes_written,
+                           GError         **error)
+{
+  CommentsStripperPrivate *priv;
+  const gchar *in = inbuf;
+  gchar *out = outbuf;
+  gsize read = 0;
+  gsize written = 0;
+  gsize reserve;
+
+  priv = COMMENTS_STRIPPER_GET_PRIVATE (converter);
+
+  /* the most a single byte can release is the pending start plus itself */
+  reserve = priv->start_length + 1;
+
+  while (read < inbuf_size && outbuf_size - written >= reserve)
+    {
+      written += strip_byte (priv, in[read], out + written);
+      read++;
+    }
+
+  if (read == inbuf_size && (flags & G_CONVERTER_INPUT_AT_END))
+    {
+      if (priv->state == STATE_CODE && priv->matched > 0)
+        {
+          if (outbuf_size - written < priv->matched)
+            goto out_of_space;
+
+          memcpy (out + written, priv->start, priv->matched);
+          written += priv->matched;
+          priv->matched = 0;
+        }
+
+      *bytes_read = read;
+      *bytes_written = written;
+      return G_CONVERTER_FINISHED;
+    }
+
+  if (read < inbuf_size)
+    goto out_of_space;
+
+  *bytes_read = read;
+  *bytes_written = written;
+
+  if (flags & G_CONVERTER_FLUSH)
+    return G_CONVERTER_FLUSHED;
+
+  if (read == 0)
+    {
+      g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_PARTIAL_INPUT, 
+                           "Need more input");
+      return G_CONVERTER_ERROR;
+    }
+
+  return G_CONVERTER_CONVERTED;
+
+out_of_space:
+
+  if (read == 0 && written == 0)
+    {
+      g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NO_SPACE, 
+                           "Need more room in the output buffer");
+      return G_CONVERTER_ERROR;
+    }
+
+  *bytes_read = read;
+  *bytes_written = written;
+  return G_CONVERTER_CONVERTED;
+}
+
+static void
+comments_stripper_reset (GConverter *converter)
+{
+  CommentsStripperPrivate *priv;
+  priv = COMMENTS_STRIPPER_GET_PRIVATE (converter);
+  priv->state = STATE_CODE;
+  priv->matched = 0;
+}
+
+/*
+ * Feed one byte through the state machine and return how many bytes were
+ * written to out. In code the bytes that could still turn out to be the
+ * start delimiter are held back, and released as soon as they cannot.
+ */
+static gsize
+strip_byte (CommentsStripperPrivate *priv,
+            gchar                    c,
+            gchar                   *out)
+{
+  gsize pending;
+  gsize matched;
+
+  switch (priv->state)
+    {
+    case STATE_LINE:
+      if (c == '\n' || c == '\r')
+        {
+          priv->state = STATE_CODE;
+          *out = c;
+          return 1;
+        }
+      return 0;
+
+    case STATE_BLOCK:
+      priv->matched = next_matched (priv, priv->end, c);
+      if (priv->matched == priv->end_length)
+        {
+          priv->state = STATE_CODE;
+          priv->matched = 0;
+        }
+      if (c == '\n' || c == '\r')
+        {
+          *out = c;
+          return 1;
+        }
+      return 0;
+
+    case STATE_CODE:
+    default:
+      if (priv->start_length == 0)
+        {
+          *out = c;
+          return 1;
+        }
+
+      pending = priv->matched + 1;
+      matched = next_matched (priv, priv->start, c);
+
+      if (matched == priv->start_length)
+        {
+          priv->state = priv->end_length > 0 ? STATE_BLOCK : STATE_LINE;
+          priv->matched = 0;
+          return 0;
+        }
+
+      /* whatever is not part of the new match can be let go */
+      memcpy (out, priv->scratch, pending - matched);
+      priv->matched = matched;
+      return pending - matched;
+    }
+}
+
+/*
+ * The delimiter prefix matched so far followed by c is put in the scratch
+ * buffer, and the longest suffix of it that is again a prefix of the
+ * delimiter is the new match. Delimiters are a few bytes long so trying
+ * each suffix in turn is cheaper than building a failure table.
+ */
+static gsize
+next_matched (CommentsStripperPrivate *priv,
+              const gchar             *delimiter,
+              gchar                    c)
+{
+  gsize pending;
+  gsize matched;
+
+  if (delimiter[priv->matched] == c)
+    return priv->matched + 1;
+
+  memcpy (priv->scratch, delimiter, priv->matched);
+  priv->scratch[priv->matched] = c;
+  pending = priv->matched + 1;
+
+  for (matched = priv->matched; matched > 0; matched--)
+    {
+      if (memcmp (priv->scratch + pending - matched, delimiter, matched) == 0)
+        return matched;
+    }
+
+  return 0;
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __COMMENTS_STRIPPER_H__
+#define	__COMMENTS_STRIPPER_H__
+
+#include <gio/gio.h>
+#include "comments-config.h"
+
+G_BEGIN_DECLS
+
+#define COMMENTS_STRIPPER_TYPE            (comments_stripper_get_type ())
+#define COMMENTS_STRIPPER(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), COMMENTS_STRIPPER_TYPE, CommentsStripper))
+#define COMMENTS_STRIPPER_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), COMMENTS_STRIPPER_TYPE, CommentsStripperClass))
+#define IS_COMMENTS_STRIPPER(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), COMMENTS_STRIPPER_TYPE))
+#define IS_COMMENTS_STRIPPER_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), COMMENTS_STRIPPER_TYPE))
+
+typedef struct _CommentsStripper CommentsStripper;
+typedef struct _CommentsStripperClass CommentsStripperClass;
+
+struct _CommentsStripper
+{
+  GObject parent_instance;
+};
+
+struct _CommentsStripperClass
+{
+  GObjectClass parent_class;
+};
+
+GType comments_stripper_get_type (void) G_GNUC_CONST;
+
+CommentsStripper*  comments_stripper_new    (CommentsConfig   *config);
+
+gchar*             comments_stripper_strip  (CommentsStripper *stripper,
+                                             const gchar      *text,
+                                             gssize            length);
+
+G_END_DECLS
+
+#endif /* __COMMENTS_STRIPPER_H__ */
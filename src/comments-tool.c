@@ -0,0 +1,439 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Headless front end to the parts of the plugin that do not need an editor.
+ *
+ *   comments-tool report --config ~/.codeslayer/plugins/comments.xml [--csv]
+ *                        [--sort code|comment|blank|ratio|path] FOLDER
+ *   comments-tool strip --config FILE [--type SUFFIX] [INPUT [OUTPUT]]
+ *   comments-tool license --config FILE --template FILE [--replace] [--check]
+ *                         [--cache FILE] FOLDER
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib.h>
+#include <gio/gio.h>
+#include <gio/gunixinputstream.h>
+#include <gio/gunixoutputstream.h>
+#include "comments-config.h"
+#include "comments-scanner.h"
+#include "comments-stripper.h"
+#include "comments-license.h"
+
+typedef gint (*CommandFunc) (gint argc, gchar **argv);
+
+typedef struct _Command Command;
+
+struct _Command
+{
+  const gchar *name;
+  CommandFunc  func;
+  const gchar *summary;
+};
+
+static gint report_command  (gint    argc, 
+                             gchar **argv);
+static gint strip_command   (gint    argc, 
+                             gchar **argv);
+static gint license_command (gint    argc, 
+                             gchar **argv);
+static gboolean parse_options (GOptionContext *context,
+                               gint           *argc,
+                               gchar        ***argv,
+                               gint            min_args,
+                               gint            max_args);
+static GList* load_configs  (const gchar *config_path);
+static void free_configs    (GList       *configs);
+static void print_usage     (void);
+
+static const Command commands[] = 
+{
+  { "report", report_command, "count comment, code and blank lines per file and directory" },
+  { "strip", strip_command, "remove the comments from a stream" },
+  { "license", license_command, "add or update the license header of every file in a folder" },
+  { NULL, NULL, NULL }
+};
+
+int
+main (int    argc,
+      char **argv)
+{
+  gint i;
+
+  if (argc < 2)
+    {
+      print_usage ();
+      return EXIT_FAILURE;
+    }
+
+  for (i = 0; commands[i].name != NULL; i++)
+    {
+      if (g_strcmp0 (argv[1], commands[i].name) == 0)
+        return commands[i].func (argc - 1, argv + 1);
+    }
+
+  print_usage ();
+  return EXIT_FAILURE;
+}
+
+static void
+print_usage (void)
+{
+  gint i;
+
+  g_printerr ("usage: comments-tool COMMAND [OPTION...]\n\ncommands:\n");
+  for (i = 0; commands[i].name != NULL; i++)
+    g_printerr ("  %-10s %s\n", commands[i].name, commands[i].summary);
+}
+
+static GList*
+load_configs (const gchar *config_path)
+{
+  GList *configs;
+
+  if (config_path == NULL)
+    {
+      g_printerr ("comments-tool: --config is required\n");
+      return NULL;
+    }
+
+  if (!g_file_test (config_path, G_FILE_TEST_IS_REGULAR))
+    {
+      g_printerr ("comments-tool: %s does not exist\n", config_path);
+      return NULL;
+    }
+
+  configs = comments_config_load_list (config_path);
+  if (configs == NULL)
+    g_printerr ("comments-tool: %s has no comment configurations\n", config_path);
+
+  return configs;
+}
+
+static gboolean
+parse_options (GOptionContext *context,
+               gint           *argc,
+               gchar        ***argv,
+               gint            min_args,
+               gint            max_args)
+{
+  GError *error = NULL;
+
+  if (!g_option_context_parse (context, argc, argv, &error))
+    {
+      g_printerr ("comments-tool: %s\n", error->message);
+      g_error_free (error);
+      g_option_context_free (context);
+      return FALSE;
+    }
+
+  if (*argc < min_args || *argc > max_args)
+    {
+      gchar *help = g_option_context_get_help (context, TRUE, NULL);
+      g_printerr ("%s", help);
+      g_free (help);
+      g_option_context_free (context);
+      return FALSE;
+    }
+
+  g_option_context_free (context);
+  return TRUE;
+}
+
+static void
+free_configs (GList *configs)
+{
+  g_list_foreach (configs, (GFunc) g_object_unref, NULL);
+  g_list_free (configs);
+}
+
+static gint
+report_command (gint    argc, 
+                gchar **argv)
+{
+  GOptionContext *context;
+  gchar *config_path = NULL;
+  gchar *sort = NULL;
+  gboolean csv = FALSE;
+  GList *configs;
+  GPtrArray *stats;
+  CommentsScanSort scan_sort = COMMENTS_SCAN_SORT_PATH;
+  guint i;
+
+  GOptionEntry entries[] = 
+  {
+    { "config", 'c', 0, G_OPTION_ARG_FILENAME, &config_path, "The comments.xml to read the delimiters from", "FILE" },
+    { "csv", 0, 0, G_OPTION_ARG_NONE, &csv, "Write CSV instead of a table", NULL },
+    { "sort", 's', 0, G_OPTION_ARG_STRING, &sort, "Sort by path, code, comment, blank or ratio", "COLUMN" },
+    { NULL }
+  };
+
+  context = g_option_context_new ("FOLDER - comment density report");
+  g_option_context_add_main_entries (context, entries, NULL);
+
+  if (!parse_options (context, &argc, &argv, 2, 2))
+    return EXIT_FAILURE;
+
+  if (g_strcmp0 (sort, "code") == 0)
+    scan_sort = COMMENTS_SCAN_SORT_CODE;
+  else if (g_strcmp0 (sort, "comment") == 0)
+    scan_sort = COMMENTS_SCAN_SORT_COMMENT;
+  else if (g_strcmp0 (sort, "blank") == 0)
+    scan_sort = COMMENTS_SCAN_SORT_BLANK;
+  else if (g_strcmp0 (sort, "ratio") == 0)
+    scan_sort = COMMENTS_SCAN_SORT_RATIO;
+
+  configs = load_configs (config_path);
+  if (configs == NULL)
+    return EXIT_FAILURE;
+
+  stats = comments_scanner_scan (argv[1], configs);
+  comments_scanner_sort (stats, scan_sort);
+
+  if (csv)
+    {
+      gchar *text = comments_scanner_to_csv (stats);
+      g_print ("%s", text);
+      g_free (text);
+    }
+  else
+    {
+      g_print ("%-48s %9s %6s %9s %9s %9s %7s\n", 
+               "PATH", "TYPE", "FILES", "CODE", "COMMENT", "BLANK", "RATIO");
+
+      for (i = 0; i < stats->len; i++)
+        {
+          CommentsScanStats *entry = g_ptr_array_index (stats, i);
+          g_print ("%-48s %9s %6u %9u %9u %9u %6.1f%%\n", 
+                   entry->path, entry->directory ? "directory" : "file",
+                   entry->files, entry->code, entry->comment, entry->blank,
+                   comments_scan_stats_get_ratio (entry) * 100);
+        }
+    }
+
+  g_ptr_array_unref (stats);
+  free_configs (configs);
+  g_free (config_path);
+  g_free (sort);
+
+  return EXIT_SUCCESS;
+}
+
+/*
+ * The input is pulled through the stripper in fixed size chunks and spliced
+ * straight into the output, so files of any size go through in constant
+ * memory.
+ */
+static gint
+strip_command (gint    argc, 
+               gchar **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  gchar *config_path = NULL;
+  gchar *type = NULL;
+  GList *configs;
+  CommentsConfig *config;
+  CommentsStripper *stripper;
+  GInputStream *input;
+  GInputStream *converter_input;
+  GOutputStream *output;
+  const gchar *input_path;
+  const gchar *output_path;
+  gint result = EXIT_SUCCESS;
+
+  GOptionEntry entries[] = 
+  {
+    { "config", 'c', 0, G_OPTION_ARG_FILENAME, &config_path, "The comments.xml to read the delimiters from", "FILE" },
+    { "type", 't', 0, G_OPTION_ARG_STRING, &type, "File name or suffix that picks the delimiters, the input name by default", "SUFFIX" },
+    { NULL }
+  };
+
+  context = g_option_context_new ("[INPUT [OUTPUT]] - remove the comments from a file, - is standard input");
+  g_option_context_add_main_entries (context, entries, NULL);
+
+  if (!parse_options (context, &argc, &argv, 1, 3))
+    return EXIT_FAILURE;
+
+  input_path = argc > 1 && g_strcmp0 (argv[1], "-") != 0 ? argv[1] : NULL;
+  output_path = argc > 2 && g_strcmp0 (argv[2], "-") != 0 ? argv[2] : NULL;
+
+  if (type == NULL && input_path == NULL)
+    {
+      g_printerr ("comments-tool: --type is required when reading standard input\n");
+      return EXIT_FAILURE;
+    }
+
+  configs = load_configs (config_path);
+  if (configs == NULL)
+    return EXIT_FAILURE;
+
+  config = comments_config_find_for_path (configs, type != NULL ? type : input_path);
+  if (config == NULL)
+    {
+      g_printerr ("comments-tool: no comment configuration for %s\n", 
+                  type != NULL ? type : input_path);
+      free_configs (configs);
+      return EXIT_FAILURE;
+    }
+
+  if (input_path != NULL)
+    {
+      GFile *file = g_file_new_for_commandline_arg (input_path);
+      input = G_INPUT_STREAM (g_file_read (file, NULL, &error));
+      g_object_unref (file);
+    }
+  else
+    {
+      input = g_unix_input_stream_new (STDIN_FILENO, FALSE);
+    }
+
+  if (input == NULL)
+    {
+      g_printerr ("comments-tool: %s\n", error->message);
+      g_error_free (error);
+      free_configs (configs);
+      return EXIT_FAILURE;
+    }
+
+  if (output_path != NULL)
+    {
+      GFile *file = g_file_new_for_commandline_arg (output_path);
+      output = G_OUTPUT_STREAM (g_file_replace (file, NULL, FALSE, 
+                                                G_FILE_CREATE_NONE, NULL, &error));
+      g_object_unref (file);
+    }
+  else
+    {
+      output = g_unix_output_stream_new (STDOUT_FILENO, FALSE);
+    }
+
+  if (output == NULL)
+    {
+      g_printerr ("comments-tool: %s\n", error->message);
+      g_error_free (error);
+      g_object_unref (input);
+      free_configs (configs);
+      return EXIT_FAILURE;
+    }
+
+  stripper = comments_stripper_new (config);
+  converter_input = g_converter_input_stream_new (input, G_CONVERTER (stripper));
+
+  if (g_output_stream_splice (output, converter_input, 
+                              G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE |
+                              G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET,
+                              NULL, &error) < 0)
+    {
+      g_printerr ("comments-tool: %s\n", error->message);
+      g_error_free (error);
+      result = EXIT_FAILURE;
+    }
+
+  g_object_unref (converter_input);
+  g_object_unref (stripper);
+  g_object_unref (output);
+  g_object_unref (input);
+  free_configs (configs);
+  g_free (config_path);
+  g_free (type);
+
+  return result;
+}
+
+/*
+ * Files that already have some other license header are left alone unless
+ * --replace is given. With --check nothing is written and the exit status
+ * says whether any file would have changed.
+ */
+static gint
+license_command (gint    argc, 
+                 gchar **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  gchar *config_path = NULL;
+  gchar *template_path = NULL;
+  gchar *cache_path = NULL;
+  gchar *template_text;
+  gboolean replace = FALSE;
+  gboolean check = FALSE;
+  GList *configs;
+  CommentsLicense *license;
+  CommentsLicenseStats stats;
+  gint result = EXIT_SUCCESS;
+
+  GOptionEntry entries[] = 
+  {
+    { "config", 'c', 0, G_OPTION_ARG_FILENAME, &config_path, "The comments.xml to read the delimiters from", "FILE" },
+    { "template", 't', 0, G_OPTION_ARG_FILENAME, &template_path, "The text of the header, without delimiters", "FILE" },
+    { "replace", 'r', 0, G_OPTION_ARG_NONE, &replace, "Replace headers that hold another license", NULL },
+    { "check", 0, 0, G_OPTION_ARG_NONE, &check, "Only report the files that would change", NULL },
+    { "cache", 0, 0, G_OPTION_ARG_FILENAME, &cache_path, "Remember the files that are up to date here", "FILE" },
+    { NULL }
+  };
+
+  context = g_option_context_new ("FOLDER - add or update license headers");
+  g_option_context_add_main_entries (context, entries, NULL);
+
+  if (!parse_options (context, &argc, &argv, 2, 2))
+    return EXIT_FAILURE;
+
+  if (template_path == NULL)
+    {
+      g_printerr ("comments-tool: --template is required\n");
+      return EXIT_FAILURE;
+    }
+
+  if (!g_file_get_contents (template_path, &template_text, NULL, &error))
+    {
+      g_printerr ("comments-tool: %s\n", error->message);
+      g_error_free (error);
+      return EXIT_FAILURE;
+    }
+
+  configs = load_configs (config_path);
+  if (configs == NULL)
+    {
+      g_free (template_text);
+      return EXIT_FAILURE;
+    }
+
+  license = comments_license_new (template_text);
+  comments_license_update (license, argv[1], configs, cache_path, 
+                           replace, check, &stats);
+
+  g_print ("%u added, %u replaced, %u current (%u cached), %u skipped, %u failed\n", 
+           stats.added, stats.replaced, stats.current, stats.cached, 
+           stats.skipped, stats.failed);
+
+  if (stats.failed > 0 || (check && stats.added + stats.replaced > 0))
+    result = EXIT_FAILURE;
+
+  comments_license_free (license);
+  free_configs (configs);
+  g_free (template_text);
+  g_free (config_path);
+  g_free (template_path);
+  g_free (cache_path);
+
+  return result;
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __COMMENTS_TRACE_H__
+#define	__COMMENTS_TRACE_H__
+
+/*
+ * Static tracepoints for perf and bpftrace. Configure with --enable-sdt to
+ * compile them in, otherwise every macro expands to nothing. Each probe has
+ * a semaphore so arguments that cost something to compute (the line count
+ * of a selection for instance) are only worked out while a tracer is
+ * attached:
+ *
+ *   bpftrace -e 'usdt:libcommentscodeslayerplugin.so:comments:action__start
+ *                { printf ("%d bytes %d lines\n", arg0, arg1); }'
+ */
+
+#ifdef ENABLE_SDT
+
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+
+#define COMMENTS_TRACE_SEMAPHORE(name) comments_##name##_semaphore
+
+#define COMMENTS_TRACE_DECLARE(name) \
+  extern unsigned short COMMENTS_TRACE_SEMAPHORE (name)
+
+#define COMMENTS_TRACE_DEFINE(name) \
+  unsigned short COMMENTS_TRACE_SEMAPHORE (name) \
+  __attribute__ ((section (".probes"))) = 0
+
+#define COMMENTS_TRACE_ENABLED(name) \
+  G_UNLIKELY (COMMENTS_TRACE_SEMAPHORE (name) != 0)
+
+#define COMMENTS_TRACE(name) \
+  DTRACE_PROBE (comments, name)
+#define COMMENTS_TRACE1(name, a) \
+  DTRACE_PROBE1 (comments, name, a)
+#define COMMENTS_TRACE2(name, a, b) \
+  DTRACE_PROBE2 (comments, name, a, b)
+#define COMMENTS_TRACE3(name, a, b, c) \
+  DTRACE_PROBE3 (comments, name, a, b, c)
+
+#else
+
+#define COMMENTS_TRACE_DECLARE(name) \
+  extern int comments_trace_unused
+#define COMMENTS_TRACE_DEFINE(name) \
+  extern int comments_trace_unused
+#define COMMENTS_TRACE_ENABLED(name) (0)
+
+/* the arguments are referenced but never evaluated */
+#define COMMENTS_TRACE(name) \
+  G_STMT_START { } G_STMT_END
+#define COMMENTS_TRACE1(name, a) \
+  G_STMT_START { if (0) { (void) (a); } } G_STMT_END
+#define COMMENTS_TRACE2(name, a, b) \
+  G_STMT_START { if (0) { (void) (a); (void) (b); } } G_STMT_END
+#define COMMENTS_TRACE3(name, a, b, c) \
+  G_STMT_START { if (0) { (void) (a); (void) (b); (void) (c); } } G_STMT_END
+
+#endif
+
+/* action__start (selection bytes, selection lines, config id) */
+COMMENTS_TRACE_DECLARE (action__start);
+/* action__done (replacement bytes, 0 when nothing was replaced as one piece) */
+COMMENTS_TRACE_DECLARE (action__done);
+/* get_config__start () */
+COMMENTS_TRACE_DECLARE (get_config__start);
+/* get_config__done (config id, -1 when nothing matched) */
+COMMENTS_TRACE_DECLARE (get_config__done);
+/* transform__start (transform name, input bytes) */
+COMMENTS_TRACE_DECLARE (transform__start);
+/* transform__done (transform name, output bytes) */
+COMMENTS_TRACE_DECLARE (transform__done);
+/* edit__start (deleted bytes, inserted bytes) */
+COMMENTS_TRACE_DECLARE (edit__start);
+/* edit__done () */
+COMMENTS_TRACE_DECLARE (edit__done);
+/* load__start () */
+COMMENTS_TRACE_DECLARE (load__start);
+/* load__done (config count) */
+COMMENTS_TRACE_DECLARE (load__done);
+/* save__start (config count) */
+COMMENTS_TRACE_DECLARE (save__start);
+/* save__done () */
+COMMENTS_TRACE_DECLARE (save__done);
+
+#endif /* __COMMENTS_TRACE_H__ */
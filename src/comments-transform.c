@@ -0,0 +1,1475 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#define _GNU_SOURCE
+#include <string.h>
+#include "comments-transform.h"
+#include "comments-simd.h"
+
+#define DEFAULT_TAB_WIDTH 8
+
+typedef struct _Line Line;
+typedef struct _Reflow Reflow;
+
+struct _Line
+{
+  gsize    offset;
+  gsize    end;
+  gsize    indent;
+  guint    column;
+  gboolean blank;
+};
+
+struct _Reflow
+{
+  GString     *result;
+  const gchar *eol;
+  guint        width;
+  guint        tab_width;
+  const gchar *prefix;
+  const gchar *next_prefix;
+  guint        prefix_column;
+  guint        column;
+  gboolean     started;
+  gboolean     open;
+};
+
+static gsize   next_line         (const gchar *text,
+                                  gsize        pos,
+                                  gsize        length,
+                                  guint        tab_width,
+                                  Line        *line);
+static guint   get_min_column    (const gchar *text,
+                                  gsize        length,
+                                  guint        tab_width);
+static gsize   get_indent_split  (const gchar *line,
+                                  gsize        indent,
+                                  guint        min_column,
+                                  guint        tab_width);
+static gsize   skip_space        (const gchar *text,
+                                  gsize        length);
+static const gchar* find_line_end (const gchar *text,
+                                  const gchar *end,
+                                  CommentsEol  eol,
+                                  gsize       *eol_length);
+static gsize   skip_lines        (const gchar *text,
+                                  gsize        pos,
+                                  gsize        to,
+                                  guint       *line);
+static gsize   skip_line         (const gchar *text,
+                                  gsize        pos,
+                                  gsize        length);
+static gboolean reflow_lines     (Reflow      *reflow,
+                                  const gchar *text,
+                                  const gchar *limit,
+                                  gsize        indent,
+                                  const gchar *start,
+                                  CommentsEol  eol);
+static gboolean reflow_block     (Reflow      *reflow,
+                                  const gchar *text,
+                                  const gchar *limit,
+                                  gsize        indent,
+                                  const gchar *start,
+                                  const gchar *end,
+                                  CommentsEol  eol);
+static gchar*  get_block_prefix  (const gchar *text,
+                                  const gchar *open,
+                                  const gchar *pos,
+                                  const gchar *close,
+                                  gsize        indent,
+                                  const gchar *end,
+                                  CommentsEol  eol,
+                                  gboolean    *decorated);
+static void    reflow_set_prefix (Reflow      *reflow,
+                                  const gchar *prefix,
+                                  const gchar *next_prefix);
+static void    reflow_line       (Reflow      *reflow);
+static void    reflow_next_prefix (Reflow     *reflow);
+static void    reflow_word       (Reflow      *reflow,
+                                  const gchar *word,
+                                  gsize        length);
+static void    reflow_words      (Reflow      *reflow,
+                                  const gchar *text,
+                                  const gchar *end);
+static void    reflow_break      (Reflow      *reflow,
+                                  const gchar *line,
+                                  const gchar *end);
+static gboolean convert_to_block (GString     *result,
+                                  const gchar *text,
+                                  const gchar *limit,
+                                  const gchar *line,
+                                  const gchar *start,
+                                  const gchar *end,
+                                  CommentsEol  eol);
+static gboolean convert_to_lines (GString     *result,
+                                  const gchar *text,
+                                  const gchar *limit,
+                                  gsize        indent,
+                                  const gchar *line,
+                                  const gchar *start,
+                                  const gchar *end,
+                                  CommentsEol  eol);
+static gboolean has_prefix       (const gchar *text,
+                                  const gchar *end,
+                                  const gchar *prefix);
+static guint   get_width         (const gchar *text,
+                                  guint        tab_width);
+static const gchar* skip_blanks  (const gchar *text,
+                                  const gchar *end);
+static const gchar* trim_end     (const gchar *text,
+                                  const gchar *end);
+static gboolean has_words        (const gchar *text,
+                                  const gchar *end);
+static void    match_literal     (const gchar *text,
+                                  gsize        length,
+                                  const gchar *pattern,
+                                  GArray      *lines);
+static void    match_regex       (const gchar *text,
+                                  gsize        length,
+                                  GRegex      *regex,
+                                  GArray      *lines);
+
+/*
+ * Read the line that starts at pos, where it ends and how far in its
+ * leading whitespace reaches, and return where the next one starts.
+ */
+static gsize
+next_line (const gchar *text,
+           gsize        pos,
+           gsize        length,
+           guint        tab_width,
+           Line        *line)
+{
+  line->offset = pos;
+  line->column = 0;
+
+  while (pos < length && (text[pos] == ' ' || text[pos] == '\t'))
+    {
+      if (text[pos] == '\t')
+        line->column += tab_width - (line->column % tab_width);
+      else
+        line->column++;
+      pos++;
+    }
+
+  line->indent = pos - line->offset;
+  line->blank = (pos == length || text[pos] == '\n' || text[pos] == '\r');
+
+  pos = comments_simd_find_newline (text + pos, text + length) - text;
+
+  if (pos < length)
+    {
+      if (text[pos] == '\r' && pos + 1 < length && text[pos + 1] == '\n')
+        pos++;
+      pos++;
+    }
+
+  line->end = pos;
+
+  return pos;
+}
+
+/*
+ * The smallest visual indent of the lines that have content, so the
+ * delimiters can all be lined up on the same column. Walking the text
+ * twice is cheaper than keeping a record of every line.
+ */
+static guint
+get_min_column (const gchar *text,
+                gsize        length,
+                guint        tab_width)
+{
+  guint min_column = G_MAXUINT;
+  gsize pos = 0;
+
+  while (pos < length)
+    {
+      Line line;
+
+      pos = next_line (text, pos, length, tab_width, &line);
+
+      if (!line.blank && line.column < min_column)
+        min_column = line.column;
+    }
+
+  if (min_column == G_MAXUINT)
+    min_column = 0;
+
+  return min_column;
+}
+
+static gsize
+get_indent_split (const gchar *line,
+                  gsize        indent,
+                  guint        min_column,
+                  guint        tab_width)
+{
+  guint column = 0;
+  gsize split = 0;
+
+  while (split < indent)
+    {
+      guint next;
+
+      if (line[split] == '\t')
+        next = column + tab_width - (column % tab_width);
+      else
+        next = column + 1;
+
+      if (next > min_column)
+        break;
+
+      column = next;
+      split++;
+    }
+
+  return split;
+}
+
+/*
+ * The transforms append what they make to result, so a caller that keeps
+ * its strings between actions does not allocate once they have grown.
+ */
+void
+comments_transform_insert_indented_line (GString     *result,
+                                         const gchar *text,
+                                         gssize       length,
+                                         const gchar *start,
+                                         gboolean     padding,
+                                         guint        tab_width)
+{
+  guint min_column;
+  gsize start_length;
+  gsize pos = 0;
+
+  if (length < 0)
+    length = strlen (text);
+
+  if (tab_width == 0)
+    tab_width = DEFAULT_TAB_WIDTH;
+
+  min_column = get_min_column (text, length, tab_width);
+  start_length = strlen (start);
+
+  while (pos < (gsize) length)
+    {
+      Line line;
+      const gchar *line_text = text + pos;
+      gsize split;
+
+      pos = next_line (text, pos, length, tab_width, &line);
+
+      if (line.blank)
+        {
+          g_string_append_len (result, line_text, line.end - line.offset);
+          continue;
+        }
+
+      split = get_indent_split (line_text, line.indent, min_column, tab_width);
+
+      g_string_append_len (result, line_text, split);
+      g_string_append_len (result, start, start_length);
+      if (padding)
+        g_string_append_c (result, ' ');
+      g_string_append_len (result, line_text + split,
+                           line.end - line.offset - split);
+    }
+}
+
+void
+comments_transform_remove_indented_line (GString     *result,
+                                         const gchar *text,
+                                         gssize       length,
+                                         const gchar *start,
+                                         gboolean     padding)
+{
+  gsize start_length;
+  gsize pos = 0;
+
+  if (length < 0)
+    length = strlen (text);
+
+  start_length = strlen (start);
+
+  while (pos < (gsize) length)
+    {
+      Line line;
+      const gchar *line_text = text + pos;
+      gsize line_length;
+      gsize skip;
+
+      pos = next_line (text, pos, length, DEFAULT_TAB_WIDTH, &line);
+      line_length = line.end - line.offset;
+
+      if (line.blank ||
+          start_length == 0 ||
+          line.indent + start_length > line_length ||
+          strncmp (line_text + line.indent, start, start_length) != 0)
+        {
+          g_string_append_len (result, line_text, line_length);
+          continue;
+        }
+
+      skip = start_length;
+      if (padding &&
+          line.indent + skip < line_length &&
+          line_text[line.indent + skip] == ' ')
+        skip++;
+
+      g_string_append_len (result, line_text, line.indent);
+      g_string_append_len (result, line_text + line.indent + skip,
+                           line_length - line.indent - skip);
+    }
+}
+
+/*
+ * Put the start delimiter in front of every line that ends in a line break.
+ * A line without one, which can only be the last, is left alone, as is the
+ * empty line after a trailing break. Lines are split the way eol says, so
+ * a file that only uses \r is not taken to be a single line and the \r of
+ * a \r\n pair is never mistaken for a line of its own.
+ */
+void
+comments_transform_insert_line (GString     *result,
+                                const gchar *text,
+                                gssize       length,
+                                const gchar *start,
+                                CommentsEol  eol)
+{
+  const gchar *end;
+  gsize start_length;
+
+  if (length < 0)
+    length = strlen (text);
+
+  end = text + length;
+  start_length = strlen (start);
+
+  while (text < end)
+    {
+      const gchar *line_end;
+      gsize eol_length;
+
+      line_end = find_line_end (text, end, eol, &eol_length);
+      if (line_end == end)
+        break;
+
+      g_string_append_len (result, start, start_length);
+      g_string_append_len (result, text, line_end + eol_length - text);
+      text = line_end + eol_length;
+    }
+
+  g_string_append_len (result, text, end - text);
+}
+
+/*
+ * Take the first start delimiter out of every line that ends in a line
+ * break, wherever on the line it is.
+ */
+void
+comments_transform_remove_line (GString     *result,
+                                const gchar *text,
+                                gssize       length,
+                                const gchar *start,
+                                CommentsEol  eol)
+{
+  const gchar *end;
+  gsize start_length;
+
+  if (length < 0)
+    length = strlen (text);
+
+  end = text + length;
+  start_length = strlen (start);
+
+  while (text < end)
+    {
+      const gchar *line_end;
+      const gchar *match;
+      gsize eol_length;
+
+      line_end = find_line_end (text, end, eol, &eol_length);
+      if (line_end == end)
+        break;
+
+      match = comments_simd_find_delimiter (text, line_end, start, start_length);
+      if (start_length > 0 && match != line_end)
+        {
+          g_string_append_len (result, text, match - text);
+          text = match + start_length;
+        }
+
+      g_string_append_len (result, text, line_end + eol_length - text);
+      text = line_end + eol_length;
+    }
+
+  g_string_append_len (result, text, end - text);
+}
+
+/*
+ * Wrap the text in the start and end delimiters, after its leading
+ * whitespace, and finish it with a line break. Text that is nothing but
+ * whitespace is left as it is.
+ */
+void
+comments_transform_insert_block (GString     *result,
+                                 const gchar *text,
+                                 gssize       length,
+                                 const gchar *start,
+                                 const gchar *end,
+                                 CommentsEol  eol)
+{
+  gsize space;
+
+  if (length < 0)
+    length = strlen (text);
+
+  space = skip_space (text, length);
+
+  if (space == (gsize) length)
+    {
+      g_string_append_len (result, text, length);
+      return;
+    }
+
+  g_string_append_len (result, text, space);
+  g_string_append (result, start);
+  g_string_append_len (result, text + space, length - space);
+  g_string_append (result, end);
+  g_string_append (result, comments_transform_get_eol_string (eol));
+}
+
+/*
+ * Take out the start delimiter that follows the leading whitespace and
+ * the last end delimiter after it, putting a line break where the end
+ * delimiter was. Text that does not open with the start delimiter or
+ * never closes is left as it is.
+ */
+void
+comments_transform_remove_block (GString     *result,
+                                 const gchar *text,
+                                 gssize       length,
+                                 const gchar *start,
+                                 const gchar *end,
+                                 CommentsEol  eol)
+{
+  gsize start_length;
+  gsize end_length;
+  gsize space;
+  gsize close;
+
+  if (length < 0)
+    length = strlen (text);
+
+  start_length = strlen (start);
+  end_length = strlen (end);
+  space = skip_space (text, length);
+
+  if (start_length == 0 || end_length == 0 ||
+      space + start_length + end_length > (gsize) length ||
+      strncmp (text + space, start, start_length) != 0)
+    {
+      g_string_append_len (result, text, length);
+      return;
+    }
+
+  close = length - end_length;
+  while (close > space + start_length && 
+         strncmp (text + close, end, end_length) != 0)
+    close--;
+
+  if (strncmp (text + close, end, end_length) != 0)
+    {
+      g_string_append_len (result, text, length);
+      return;
+    }
+
+  g_string_append_len (result, text, space);
+  g_string_append_len (result, text + space + start_length, 
+                       close - space - start_length);
+  g_string_append (result, comments_transform_get_eol_string (eol));
+  g_string_append_len (result, text + close + end_length, 
+                       length - close - end_length);
+}
+
+/*
+ * Rewrap a comment so its lines fill up to width columns, taking the
+ * delimiters and the indent from the first line. Blank lines and lines
+ * without any words, such as rules, are kept as they are and end the
+ * paragraph before them. A block comment keeps an opening or closing line
+ * of its own, and the decoration down its left side. Each word is looked
+ * at once and placed on the line being filled or starts the next, so the
+ * time taken only grows with the length of the comment. Text that is not
+ * a comment with these delimiters is left as it is.
+ */
+void
+comments_transform_reflow (GString     *result,
+                           const gchar *text,
+                           gssize       length,
+                           const gchar *start,
+                           const gchar *end,
+                           guint        width,
+                           guint        tab_width,
+                           CommentsEol  eol)
+{
+  Reflow reflow;
+  const gchar *limit;
+  gsize start_length;
+  gsize indent;
+  gsize mark;
+  gboolean done;
+
+  if (length < 0)
+    length = strlen (text);
+
+  if (tab_width == 0)
+    tab_width = DEFAULT_TAB_WIDTH;
+
+  limit = text + length;
+  start_length = start != NULL ? strlen (start) : 0;
+  indent = skip_blanks (text, limit) - text;
+  mark = result->len;
+
+  reflow.result = result;
+  reflow.eol = comments_transform_get_eol_string (eol);
+  reflow.width = width;
+  reflow.tab_width = tab_width;
+  reflow.prefix = NULL;
+  reflow.next_prefix = NULL;
+  reflow.prefix_column = 0;
+  reflow.column = 0;
+  reflow.started = FALSE;
+  reflow.open = FALSE;
+
+  if (start_length == 0 || 
+      indent + start_length > (gsize) length ||
+      strncmp (text + indent, start, start_length) != 0)
+    done = FALSE;
+  else if (end != NULL && *end != '\0')
+    done = reflow_block (&reflow, text, limit, indent, start, end, eol);
+  else
+    done = reflow_lines (&reflow, text, limit, indent, start, eol);
+
+  if (!done)
+    {
+      g_string_truncate (result, mark);
+      g_string_append_len (result, text, length);
+    }
+}
+
+/* every line has to start with the delimiter, or be blank */
+static gboolean
+reflow_lines (Reflow      *reflow,
+              const gchar *text,
+              const gchar *limit,
+              gsize        indent,
+              const gchar *start,
+              CommentsEol  eol)
+{
+  const gchar *pos = text;
+  gsize start_length;
+  gchar *empty;
+  gchar *prefix;
+  gboolean pad;
+
+  start_length = strlen (start);
+  pad = text + indent + start_length < limit && 
+        text[indent + start_length] == ' ';
+
+  empty = g_strndup (text, indent + start_length);
+  prefix = g_strconcat (empty, pad ? " " : "", NULL);
+  reflow_set_prefix (reflow, prefix, prefix);
+
+  while (pos < limit)
+    {
+      const gchar *line_end;
+      const gchar *content;
+      gsize eol_length;
+
+      line_end = find_line_end (pos, limit, eol, &eol_length);
+      content = skip_blanks (pos, line_end);
+
+      if (content == line_end)
+        {
+          reflow_break (reflow, content, content);
+        }
+      else if ((gsize) (line_end - content) < start_length ||
+               strncmp (content, start, start_length) != 0)
+        {
+          g_free (empty);
+          g_free (prefix);
+          return FALSE;
+        }
+      else if (skip_blanks (content + start_length, line_end) == line_end)
+        {
+          reflow_break (reflow, empty, empty + strlen (empty));
+        }
+      else if (!has_words (content + start_length, line_end))
+        {
+          reflow_break (reflow, pos, trim_end (pos, line_end));
+        }
+      else
+        {
+          reflow_words (reflow, content + start_length, line_end);
+        }
+
+      if (line_end == limit)
+        break;
+
+      pos = line_end + eol_length;
+    }
+
+  g_free (empty);
+  g_free (prefix);
+
+  return TRUE;
+}
+
+/*
+ * The last end delimiter closes the comment, and nothing but whitespace
+ * may follow it. Punctuation straight after the start delimiter, as in
+ * the opening of a doc comment, stays with it.
+ */
+static gboolean
+reflow_block (Reflow      *reflow,
+              const gchar *text,
+              const gchar *limit,
+              gsize        indent,
+              const gchar *start,
+              const gchar *end,
+              CommentsEol  eol)
+{
+  const gchar *open;
+  const gchar *close;
+  const gchar *marker;
+  const gchar *first_end;
+  gsize start_length;
+  gsize end_length;
+  gsize eol_length;
+  gchar *prefix;
+  gchar *next_prefix;
+  gchar *empty;
+  gboolean decorated;
+  gboolean closed = FALSE;
+
+  start_length = strlen (start);
+  end_length = strlen (end);
+  open = text + indent + start_length;
+
+  if ((gsize) (limit - open) < end_length)
+    return FALSE;
+
+  close = limit - end_length;
+  while (close > open && strncmp (close, end, end_length) != 0)
+    close--;
+
+  if (strncmp (close, end, end_length) != 0 ||
+      skip_space (close + end_length, limit - close - end_length) != 
+      (gsize) (limit - close - end_length))
+    return FALSE;
+
+  first_end = find_line_end (open, close, eol, &eol_length);
+
+  if (first_end == close && !has_words (open, close))
+    return FALSE;
+
+  marker = open;
+  while (marker < first_end && (*marker == '*' || *marker == '!') &&
+         strncmp (marker, end, end_length) != 0)
+    marker++;
+
+  next_prefix = get_block_prefix (text, marker, 
+                                  first_end < close ? first_end + eol_length : close, 
+                                  close, indent, end, eol, &decorated);
+  prefix = g_strdup_printf ("%.*s ", (gint) (marker - text), text);
+  empty = g_strndup (next_prefix, 
+                     trim_end (next_prefix, next_prefix + strlen (next_prefix)) - 
+                     next_prefix);
+
+  if (has_words (open, first_end))
+    {
+      reflow_set_prefix (reflow, prefix, next_prefix);
+      reflow_words (reflow, marker, first_end);
+    }
+  else
+    {
+      reflow_set_prefix (reflow, next_prefix, next_prefix);
+      reflow_break (reflow, text, trim_end (text, first_end));
+    }
+
+  if (first_end < close)
+    {
+      const gchar *pos = first_end + eol_length;
+
+      while (TRUE)
+        {
+          const gchar *line_end;
+          const gchar *content;
+
+          line_end = find_line_end (pos, close, eol, &eol_length);
+          content = skip_blanks (pos, line_end);
+
+          if (decorated && content < line_end && *content == '*' &&
+              strncmp (content, end, end_length) != 0)
+            content++;
+
+          if (content == close)
+            {
+              reflow_break (reflow, pos, skip_blanks (pos, close));
+              g_string_append_len (reflow->result, end, end_length);
+              closed = TRUE;
+              break;
+            }
+
+          if (content == line_end || skip_blanks (content, line_end) == line_end)
+            reflow_break (reflow, empty, empty + strlen (empty));
+          else if (!has_words (content, line_end))
+            reflow_break (reflow, pos, trim_end (pos, line_end));
+          else
+            reflow_words (reflow, content, line_end);
+
+          if (line_end == close)
+            break;
+
+          pos = line_end + eol_length;
+        }
+    }
+
+  if (!closed)
+    reflow_word (reflow, end, end_length);
+
+  g_free (prefix);
+  g_free (next_prefix);
+  g_free (empty);
+
+  return TRUE;
+}
+
+/*
+ * How the lines after the first start: the same as the first of them with
+ * anything on it, taking in a * down the side, or else lined up with the
+ * text after the start delimiter.
+ */
+static gchar*
+get_block_prefix (const gchar *text,
+                  const gchar *open,
+                  const gchar *pos,
+                  const gchar *close,
+                  gsize        indent,
+                  const gchar *end,
+                  CommentsEol  eol,
+                  gboolean    *decorated)
+{
+  gsize end_length;
+  GString *prefix;
+
+  end_length = strlen (end);
+  *decorated = FALSE;
+
+  while (pos < close)
+    {
+      const gchar *line_end;
+      const gchar *content;
+      gsize eol_length;
+
+      line_end = find_line_end (pos, close, eol, &eol_length);
+      content = skip_blanks (pos, line_end);
+
+      if (content < line_end && *content == '*' &&
+          strncmp (content, end, end_length) != 0)
+        {
+          *decorated = TRUE;
+          return g_strdup_printf ("%.*s* ", (gint) (content - pos), pos);
+        }
+
+      if (content < line_end)
+        return g_strndup (pos, content - pos);
+
+      if (line_end == close)
+        break;
+
+      pos = line_end + eol_length;
+    }
+
+  prefix = g_string_new_len (text, indent);
+  g_string_append_printf (prefix, "%*s", 
+                          (gint) g_utf8_strlen (text + indent, open - text - indent) + 1, 
+                          "");
+
+  return g_string_free (prefix, FALSE);
+}
+
+static void
+reflow_set_prefix (Reflow      *reflow,
+                   const gchar *prefix,
+                   const gchar *next_prefix)
+{
+  reflow->prefix = prefix;
+  reflow->next_prefix = next_prefix;
+  reflow->prefix_column = get_width (prefix, reflow->tab_width);
+}
+
+static void
+reflow_line (Reflow *reflow)
+{
+  if (reflow->started)
+    g_string_append (reflow->result, reflow->eol);
+
+  reflow->started = TRUE;
+  reflow->open = FALSE;
+}
+
+/* once the first line is out the lines after it take the next prefix */
+static void
+reflow_next_prefix (Reflow *reflow)
+{
+  if (reflow->prefix != reflow->next_prefix)
+    reflow_set_prefix (reflow, reflow->next_prefix, reflow->next_prefix);
+}
+
+/* a word longer than the width gets a line to itself */
+static void
+reflow_word (Reflow      *reflow,
+             const gchar *word,
+             gsize        length)
+{
+  guint column;
+
+  column = g_utf8_strlen (word, length);
+
+  if (reflow->open && reflow->column + 1 + column <= reflow->width)
+    {
+      g_string_append_c (reflow->result, ' ');
+      reflow->column++;
+    }
+  else
+    {
+      reflow_line (reflow);
+      g_string_append (reflow->result, reflow->prefix);
+      reflow->column = reflow->prefix_column;
+      reflow->open = TRUE;
+      reflow_next_prefix (reflow);
+    }
+
+  g_string_append_len (reflow->result, word, length);
+  reflow->column += column;
+}
+
+static void
+reflow_words (Reflow      *reflow,
+              const gchar *text,
+              const gchar *end)
+{
+  while (text < end)
+    {
+      const gchar *word;
+
+      while (text < end && g_ascii_isspace (*text))
+        text++;
+
+      word = text;
+      while (text < end && !g_ascii_isspace (*text))
+        text++;
+
+      if (text > word)
+        reflow_word (reflow, word, text - word);
+    }
+}
+
+/* a line kept as it is, which ends the paragraph being filled */
+static void
+reflow_break (Reflow      *reflow,
+              const gchar *line,
+              const gchar *end)
+{
+  reflow_line (reflow);
+  g_string_append_len (reflow->result, line, end - line);
+  reflow_next_prefix (reflow);
+}
+
+/*
+ * Turn a run of line comments into one block comment, or a block comment
+ * into line comments, whichever the text opens with. Only the delimiters
+ * change: the text of each line stays where it was, a block loses an
+ * opening or closing line with nothing else on it and the decoration down
+ * its side, and the text is passed over once. Text that is neither, or
+ * that the other style cannot hold, such as a line comment with the end
+ * delimiter in it, is left as it is.
+ */
+void
+comments_transform_convert (GString     *result,
+                            const gchar *text,
+                            gssize       length,
+                            const gchar *line,
+                            const gchar *start,
+                            const gchar *end,
+                            CommentsEol  eol)
+{
+  const gchar *limit;
+  gsize indent;
+  gsize mark;
+  gboolean done = FALSE;
+
+  if (length < 0)
+    length = strlen (text);
+
+  limit = text + length;
+  indent = skip_blanks (text, limit) - text;
+  mark = result->len;
+
+  if (line == NULL || *line == '\0' || end == NULL || *end == '\0')
+    done = FALSE;
+  else if (has_prefix (text + indent, limit, start))
+    done = convert_to_lines (result, text, limit, indent, line, start, end, eol);
+  else if (has_prefix (text + indent, limit, line))
+    done = convert_to_block (result, text, limit, line, start, end, eol);
+
+  if (!done)
+    {
+      g_string_truncate (result, mark);
+      g_string_append_len (result, text, length);
+    }
+}
+
+/*
+ * The start delimiter takes the place of the first line delimiter and the
+ * others give way to spaces, so the text lines up under it; the end
+ * delimiter goes after the last line with anything on it.
+ */
+static gboolean
+convert_to_block (GString     *result,
+                  const gchar *text,
+                  const gchar *limit,
+                  const gchar *line,
+                  const gchar *start,
+                  const gchar *end,
+                  CommentsEol  eol)
+{
+  const gchar *eol_string;
+  const gchar *close;
+  const gchar *pos = text;
+  gsize line_length;
+  gsize end_length;
+  guint start_width;
+  gboolean first = TRUE;
+
+  eol_string = comments_transform_get_eol_string (eol);
+  line_length = strlen (line);
+  end_length = strlen (end);
+  start_width = g_utf8_strlen (start, -1);
+
+  close = limit;
+  while (close > text && g_ascii_isspace (close[-1]))
+    close--;
+
+  while (TRUE)
+    {
+      const gchar *line_end;
+      const gchar *content;
+      gsize eol_length;
+
+      line_end = find_line_end (pos, close, eol, &eol_length);
+      content = skip_blanks (pos, line_end);
+
+      if (!first)
+        g_string_append (result, eol_string);
+
+      if (content < line_end)
+        {
+          const gchar *body;
+          const gchar *body_end;
+
+          if (!has_prefix (content, line_end, line))
+            return FALSE;
+
+          body = content + line_length;
+          body_end = trim_end (body, line_end);
+
+          if (comments_simd_find_delimiter (body, body_end, end, end_length) != body_end)
+            return FALSE;
+
+          if (first)
+            {
+              g_string_append_len (result, pos, content - pos);
+              g_string_append (result, start);
+            }
+          else if (body < body_end || line_end == close)
+            {
+              g_string_append_len (result, pos, content - pos);
+              g_string_append_printf (result, "%*s", (gint) start_width, "");
+            }
+
+          g_string_append_len (result, body, body_end - body);
+        }
+
+      first = FALSE;
+
+      if (line_end == close)
+        break;
+
+      pos = line_end + eol_length;
+    }
+
+  g_string_append_c (result, ' ');
+  g_string_append (result, end);
+  g_string_append_len (result, close, limit - close);
+
+  return TRUE;
+}
+
+/*
+ * Every line takes the indent of the first and the line delimiter. The
+ * text after the start delimiter, or after the decoration or the columns
+ * the start delimiter took up on the lines below it, follows unchanged.
+ */
+static gboolean
+convert_to_lines (GString     *result,
+                  const gchar *text,
+                  const gchar *limit,
+                  gsize        indent,
+                  const gchar *line,
+                  const gchar *start,
+                  const gchar *end,
+                  CommentsEol  eol)
+{
+  const gchar *eol_string;
+  const gchar *open;
+  const gchar *close;
+  const gchar *pos = text;
+  gsize end_length;
+  guint start_width;
+  gboolean first = TRUE;
+  gboolean started = FALSE;
+
+  eol_string = comments_transform_get_eol_string (eol);
+  end_length = strlen (end);
+  start_width = g_utf8_strlen (start, -1);
+  open = text + indent + strlen (start);
+
+  close = comments_simd_find_delimiter (open, limit, end, end_length);
+
+  if (close == limit ||
+      skip_space (close + end_length, limit - close - end_length) != 
+      (gsize) (limit - close - end_length))
+    return FALSE;
+
+  while (open < close && (*open == '*' || *open == '!'))
+    open++;
+
+  while (TRUE)
+    {
+      const gchar *line_end;
+      const gchar *body;
+      const gchar *body_end;
+      gsize eol_length;
+
+      line_end = find_line_end (pos, close, eol, &eol_length);
+
+      if (first)
+        {
+          body = open;
+        }
+      else
+        {
+          const gchar *content;
+
+          content = skip_blanks (pos, line_end);
+
+          if (content < line_end && *content == '*')
+            {
+              body = content + 1;
+            }
+          else
+            {
+              body = pos;
+              while (body < content && body - pos < (gssize) (indent + start_width))
+                body++;
+            }
+        }
+
+      body_end = trim_end (body, line_end);
+
+      if (body < body_end || (!first && line_end != close))
+        {
+          if (started)
+            g_string_append (result, eol_string);
+          started = TRUE;
+
+          g_string_append_len (result, text, indent);
+          g_string_append (result, line);
+          g_string_append_len (result, body, body_end - body);
+        }
+
+      first = FALSE;
+
+      if (line_end == close)
+        break;
+
+      pos = line_end + eol_length;
+    }
+
+  if (!started)
+    return FALSE;
+
+  g_string_append_len (result, close + end_length, limit - close - end_length);
+
+  return TRUE;
+}
+
+static gboolean
+has_prefix (const gchar *text,
+            const gchar *end,
+            const gchar *prefix)
+{
+  gsize length;
+
+  length = strlen (prefix);
+
+  return length > 0 && (gsize) (end - text) >= length && 
+         strncmp (text, prefix, length) == 0;
+}
+
+static guint
+get_width (const gchar *text,
+           guint        tab_width)
+{
+  guint column = 0;
+
+  while (*text != '\0')
+    {
+      if (*text == '\t')
+        column += tab_width - (column % tab_width);
+      else
+        column++;
+      text = g_utf8_next_char (text);
+    }
+
+  return column;
+}
+
+static const gchar*
+skip_blanks (const gchar *text,
+             const gchar *end)
+{
+  while (text < end && (*text == ' ' || *text == '\t'))
+    text++;
+
+  return text;
+}
+
+static const gchar*
+trim_end (const gchar *text,
+          const gchar *end)
+{
+  while (end > text && (end[-1] == ' ' || end[-1] == '\t'))
+    end--;
+
+  return end;
+}
+
+/* anything that is not ASCII punctuation or whitespace makes a word */
+static gboolean
+has_words (const gchar *text,
+           const gchar *end)
+{
+  while (text < end)
+    {
+      if (g_ascii_isalnum (*text) || (guchar) *text >= 0x80)
+        return TRUE;
+      text++;
+    }
+
+  return FALSE;
+}
+
+static gsize
+skip_space (const gchar *text,
+            gsize        length)
+{
+  gsize pos = 0;
+
+  while (pos < length && 
+         (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\n' || 
+          text[pos] == '\r' || text[pos] == '\f'))
+    pos++;
+
+  return pos;
+}
+
+/*
+ * Returns the start of the line break that ends the line at text, or end,
+ * and the length of the break. With a known style only that break is
+ * looked for; otherwise any of \n, \r\n and \r end a line, the same as in
+ * GtkTextBuffer.
+ */
+static const gchar*
+find_line_end (const gchar *text,
+               const gchar *end,
+               CommentsEol  eol,
+               gsize       *eol_length)
+{
+  const gchar *line_end;
+
+  *eol_length = 1;
+
+  switch (eol)
+    {
+    case COMMENTS_EOL_LF:
+      return comments_simd_find_delimiter (text, end, "\n", 1);
+
+    case COMMENTS_EOL_CRLF:
+      line_end = comments_simd_find_delimiter (text, end, "\n", 1);
+      if (line_end != end && line_end > text && line_end[-1] == '\r')
+        {
+          *eol_length = 2;
+          line_end--;
+        }
+      return line_end;
+
+    case COMMENTS_EOL_CR:
+      return comments_simd_find_delimiter (text, end, "\r", 1);
+
+    default:
+      line_end = comments_simd_find_newline (text, end);
+      if (line_end + 1 < end && line_end[0] == '\r' && line_end[1] == '\n')
+        *eol_length = 2;
+      return line_end;
+    }
+}
+
+/*
+ * Work out which line breaks the text uses. A \r as the very last byte
+ * could be the first half of a \r\n pair and is not counted, so a sample
+ * cut from a larger text is read correctly.
+ */
+CommentsEol
+comments_transform_detect_eol (const gchar *text,
+                               gssize       length)
+{
+  const gchar *end;
+  CommentsEol eol = COMMENTS_EOL_NONE;
+
+  if (length < 0)
+    length = strlen (text);
+
+  end = text + length;
+
+  while (eol != COMMENTS_EOL_MIXED)
+    {
+      text = comments_simd_find_newline (text, end);
+      if (text == end)
+        break;
+
+      if (*text == '\n')
+        {
+          eol = comments_transform_merge_eol (eol, COMMENTS_EOL_LF);
+          text++;
+        }
+      else if (text + 1 == end)
+        {
+          break;
+        }
+      else if (text[1] == '\n')
+        {
+          eol = comments_transform_merge_eol (eol, COMMENTS_EOL_CRLF);
+          text += 2;
+        }
+      else
+        {
+          eol = comments_transform_merge_eol (eol, COMMENTS_EOL_CR);
+          text++;
+        }
+    }
+
+  return eol;
+}
+
+CommentsEol
+comments_transform_merge_eol (CommentsEol eol,
+                              CommentsEol other)
+{
+  if (eol == COMMENTS_EOL_NONE || eol == other)
+    return other;
+  if (other == COMMENTS_EOL_NONE)
+    return eol;
+  return COMMENTS_EOL_MIXED;
+}
+
+/*
+ * The break to write for the style, \n when there is no single style.
+ */
+const gchar*
+comments_transform_get_eol_string (CommentsEol eol)
+{
+  switch (eol)
+    {
+    case COMMENTS_EOL_CRLF:
+      return "\r\n";
+    case COMMENTS_EOL_CR:
+      return "\r";
+    default:
+      return "\n";
+    }
+}
+
+/*
+ * Line numbers follow GtkTextBuffer, so a lone \r ends a line as well as
+ * \n and \r\n.
+ */
+static gsize
+skip_lines (const gchar *text,
+            gsize        pos,
+            gsize        to,
+            guint       *line)
+{
+  while (pos < to)
+    {
+      pos = comments_simd_find_newline (text + pos, text + to) - text;
+      if (pos == to)
+        break;
+      if (text[pos] == '\n' || text[pos + 1] != '\n')
+        (*line)++;
+      pos++;
+    }
+  return pos;
+}
+
+static gsize
+skip_line (const gchar *text,
+           gsize        pos,
+           gsize        length)
+{
+  pos = comments_simd_find_newline (text + pos, text + length) - text;
+
+  if (pos < length)
+    {
+      if (text[pos] == '\r' && pos + 1 < length && text[pos + 1] == '\n')
+        pos++;
+      pos++;
+    }
+
+  return pos;
+}
+
+/*
+ * Returns the numbers of the lines that contain the pattern, in order and
+ * without duplicates. The text is walked once; a literal pattern is
+ * searched for with memmem so no regex is compiled at all.
+ */
+GArray*
+comments_transform_match_lines (const gchar *text,
+                                gssize       length,
+                                const gchar *pattern,
+                                gboolean     regex,
+                                GError     **error)
+{
+  GArray *lines;
+
+  if (length < 0)
+    length = strlen (text);
+
+  lines = g_array_new (FALSE, FALSE, sizeof (guint));
+
+  if (pattern == NULL || *pattern == '\0')
+    return lines;
+
+  if (regex)
+    {
+      GRegex *compiled;
+      
+      compiled = g_regex_new (pattern, G_REGEX_MULTILINE | G_REGEX_OPTIMIZE, 
+                              0, error);
+      if (compiled == NULL)
+        {
+          g_array_free (lines, TRUE);
+          return NULL;
+        }
+
+      match_regex (text, length, compiled, lines);
+      g_regex_unref (compiled);
+    }
+  else
+    {
+      match_literal (text, length, pattern, lines);
+    }
+
+  return lines;
+}
+
+static void
+match_literal (const gchar *text,
+               gsize        length,
+               const gchar *pattern,
+               GArray      *lines)
+{
+  gsize pattern_length;
+  gsize pos = 0;
+  guint line = 0;
+
+  pattern_length = strlen (pattern);
+
+  while (pos < length)
+    {
+      const gchar *match;
+      gsize next;
+
+      match = memmem (text + pos, length - pos, pattern, pattern_length);
+      if (match == NULL)
+        break;
+
+      pos = skip_lines (text, pos, match - text, &line);
+      g_array_append_val (lines, line);
+
+      next = skip_line (text, pos, length);
+      skip_lines (text, pos, next, &line);
+      pos = next;
+    }
+}
+
+static void
+match_regex (const gchar *text,
+             gsize        length,
+             GRegex      *regex,
+             GArray      *lines)
+{
+  gsize pos = 0;
+  guint line = 0;
+
+  while (pos < length)
+    {
+      GMatchInfo *match_info;
+      gint match_start;
+      gsize next;
+
+      if (!g_regex_match_full (regex, text, length, pos, 0, &match_info, NULL))
+        {
+          g_match_info_free (match_info);
+          break;
+        }
+
+      g_match_info_fetch_pos (match_info, 0, &match_start, NULL);
+      g_match_info_free (match_info);
+
+      pos = skip_lines (text, pos, match_start, &line);
+      g_array_append_val (lines, line);
+
+      next = skip_line (text, pos, length);
+      skip_lines (text, pos, next, &line);
+      pos = next;
+    }
+}
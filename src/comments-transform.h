@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __COMMENTS_TRANSFORM_H__
+#define	__COMMENTS_TRANSFORM_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+  COMMENTS_EOL_NONE,
+  COMMENTS_EOL_LF,
+  COMMENTS_EOL_CRLF,
+  COMMENTS_EOL_CR,
+  COMMENTS_EOL_MIXED
+} CommentsEol;
+
+void    comments_transform_insert_indented_line  (GString     *result,
+                                                  const gchar *text,
+                                                  gssize       length,
+                                                  const gchar *start,
+                                                  gboolean     padding,
+                                                  guint        tab_width);
+
+void    comments_transform_remove_indented_line  (GString     *result,
+                                                  const gchar *text,
+                                                  gssize       length,
+                                                  const gchar *start,
+                                                  gboolean     padding);
+
+void    comments_transform_insert_line           (GString     *result,
+                                                  const gchar *text,
+                                                  gssize       length,
+                                                  const gchar *start,
+                                                  CommentsEol  eol);
+
+void    comments_transform_remove_line           (GString     *result,
+                                                  const gchar *text,
+                                                  gssize       length,
+                                                  const gchar *start,
+                                                  CommentsEol  eol);
+
+void    comments_transform_insert_block          (GString     *result,
+                                                  const gchar *text,
+                                                  gssize       length,
+                                                  const gchar *start,
+                                                  const gchar *end,
+                                                  CommentsEol  eol);
+
+void    comments_transform_remove_block          (GString     *result,
+                                                  const gchar *text,
+                                                  gssize       length,
+                                                  const gchar *start,
+                                                  const gchar *end,
+                                                  CommentsEol  eol);
+
+void    comments_transform_reflow                (GString     *result,
+                                                  const gchar *text,
+                                                  gssize       length,
+                                                  const gchar *start,
+                                                  const gchar *end,
+                                                  guint        width,
+                                                  guint        tab_width,
+                                                  CommentsEol  eol);
+
+void    comments_transform_convert               (GString     *result,
+                                                  const gchar *text,
+                                                  gssize       length,
+                                                  const gchar *line,
+                                                  const gchar *start,
+                                                  const gchar *end,
+                                                  CommentsEol  eol);
+
+CommentsEol  comments_transform_detect_eol       (const gchar *text,
+                                                  gssize       length);
+
+CommentsEol  comments_transform_merge_eol        (CommentsEol  eol,
+                                                  CommentsEol  other);
+
+const gchar* comments_transform_get_eol_string   (CommentsEol  eol);
+
+GArray* comments_transform_match_lines           (const gchar *text,
+                                                  gssize       length,
+                                                  const gchar *pattern,
+                                                  gboolean     regex,
+                                                  GError     **error);
+
+G_END_DECLS
+
+#endif /* __COMMENTS_TRANSFORM_H__ */
@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2010 - Jeff Johnston
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "comments-walker.h"
+
+typedef struct _Walk Walk;
+
+struct _Walk
+{
+  GList            *configs;
+  GHashTable       *rules;
+  CommentsFileFunc  file_func;
+  gpointer          user_data;
+  GPtrArray        *jobs;
+};
+
+static GHashTable*  get_rules     (GList            *configs,
+                                   CommentsRuleFunc  rule_func,
+                                   GDestroyNotify    rule_free);
+static void         collect_jobs  (Walk             *walk,
+                                   const gchar      *folder_path,
+                                   const gchar      *relative_path);
+
+/*
+ * The scanner, the detector and the license updater all go over a tree
+ * the same way: every file under the folder whose name matches one of the
+ * configs, skipping hidden files and symlinked folders, is handed to a
+ * worker on a thread pool. What a worker needs of a config is copied into
+ * a rule up front by rule_func, which returns NULL for a config the caller
+ * has no use for, so the workers never touch a GObject. file_func gets
+ * each matching file, with its path relative to the folder, on the calling
+ * thread and returns the job to run, or NULL when the file needs none; the
+ * paths are only lent to it. job_func then runs every job on the pool.
+ *
+ * Returns the jobs in the order the files were found, for the caller to
+ * collect and free. The rules are freed before it returns.
+ */
+GPtrArray*
+comments_walker_run (const gchar      *folder_path,
+                     GList            *configs,
+                     CommentsRuleFunc  rule_func,
+                     GDestroyNotify    rule_free,
+                     CommentsFileFunc  file_func,
+                     GFunc             job_func,
+                     gpointer          user_data)
+{
+  Walk walk;
+  GThreadPool *pool;
+  guint i;
+
+  walk.configs = configs;
+  walk.rules = get_rules (configs, rule_func, rule_free);
+  walk.file_func = file_func;
+  walk.user_data = user_data;
+  walk.jobs = g_ptr_array_new ();
+
+  collect_jobs (&walk, folder_path, NULL);
+
+  pool = g_thread_pool_new (job_func, user_data, g_get_num_processors (), 
+                            FALSE, NULL);
+
+  for (i = 0; i < walk.jobs->len; i++)
+    g_thread_pool_push (pool, g_ptr_array_index (walk.jobs, i), NULL);
+
+  g_thread_pool_free (pool, FALSE, TRUE);
+
+  g_hash_table_destroy (walk.rules);
+
+  return walk.jobs;
+}
+
+static GHashTable*
+get_rules (GList            *configs,
+           CommentsRuleFunc  rule_func,
+           GDestroyNotify    rule_free)
+{
+  GHashTable *rules;
+
+  rules = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, 
+                                 rule_free);
+
+  while (configs != NULL)
+    {
+      CommentsConfig *config = configs->data;
+      gpointer rule;
+
+      rule = rule_func (config);
+      if (rule != NULL)
+        g_hash_table_insert (rules, config, rule);
+
+      configs = g_list_next (configs);
+    }
+
+  return rules;
+}
+
+/* a file goes by the first config that lists its suffix, as in the editor */
+static void
+collect_jobs (Walk        *walk,
+              const gchar *folder_path,
+              const gchar *relative_path)
+{
+  GDir *dir;
+  const gchar *name;
+
+  dir = g_dir_open (folder_path, 0, NULL);
+  if (dir == NULL)
+    return;
+
+  while ((name = g_dir_read_name (dir)) != NULL)
+    {
+      gchar *file_path;
+      gchar *path;
+
+      /* skip the version control folders and other hidden files */
+      if (name[0] == '.')
+        continue;
+
+      file_path = g_build_filename (folder_path, name, NULL);
+      if (relative_path != NULL)
+        path = g_build_filename (relative_path, name, NULL);
+      else
+        path = g_strdup (name);
+
+      if (g_file_test (file_path, G_FILE_TEST_IS_DIR))
+        {
+          if (!g_file_test (file_path, G_FILE_TEST_IS_SYMLINK))
+            collect_jobs (walk, file_path, path);
+        }
+      else
+        {
+          CommentsConfig *config;
+          gpointer rule = NULL;
+          gpointer job = NULL;
+
+          config = comments_config_find_for_path (walk->configs, name);
+          if (config != NULL)
+            rule = g_hash_table_lookup (walk->rules, config);
+          if (rule != NULL)
+            job = walk->file_func (file_path, path, rule, walk->user_data);
+          if (job != NULL)
+            g_ptr_array_add (walk->jobs, job);
+        }
+
+      g_free (file_path);
+      g_free (path);
+    }
+
+  g_dir_close (dir);
+}